@@ -1,11 +1,30 @@
-﻿#include <iostream>
+﻿#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
 #include <string>
 #include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "class_definitions/DatabasePersistence.hpp"
 #include "handlers/SqlCommandHandler.hpp"
 #include "class_definitions/InputBuffer.hpp"
 #include "types/enums.hpp"
 #include "handlers/MetaCommandHandler.hpp"
+#include "class_definitions/ScriptReader.hpp"
+#ifdef CPPDATABASE_SERVER
+#include <csignal>
+#include <pthread.h>
+#include "class_definitions/Server.hpp"
+#endif
 
 
 // BAZA DANYCH
@@ -29,11 +48,264 @@ void print_tables(const DatabasePersistence& db) {
     std::cout << std::endl;
 }
 
-int main() {
+#ifdef CPPDATABASE_SERVER
+// SIGINT and SIGTERM stop the server. They are blocked before the database
+// starts any thread, so that every thread inherits the mask, and taken by
+// one thread waiting for them.
+sigset_t block_stop_signals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    return signals;
+}
+
+// Serves the database until one of `signals` arrives.
+int run_server(const std::shared_ptr<DatabasePersistence>& db, const std::vector<std::string>& addresses,
+               size_t threads, const sigset_t& signals) {
+    Server server(db, threads);
+    try {
+        for (const auto& address : addresses) {
+            server.listen(address);
+            std::cout << "Listening on " << address << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Serving with " << threads << " worker thread(s). Stop with Ctrl+C." << std::endl;
+
+    std::thread signal_waiter([&] {
+        int received = 0;
+        sigwait(&signals, &received);
+        server.stop();
+    });
+    server.run();
+    // run() also returns on its own when polling fails.
+    pthread_kill(signal_waiter.native_handle(), SIGTERM);
+    signal_waiter.join();
+    std::cout << "Server stopped." << std::endl;
+    return EXIT_SUCCESS;
+}
+#endif
+
+bool is_console_input() {
+#if defined(_WIN32)
+    return _isatty(_fileno(stdin));
+#else
+    return ::isatty(STDIN_FILENO);
+#endif
+}
+
+// Batch mode: runs the statements of a script without prompts and stops at
+// the first one that fails (an open transaction is then rolled back). Results
+// go to stdout in large writes; errors and the timing summary go to stderr.
+int run_script(SqlCommandHandler& sql_handler, DatabasePersistence& db, std::istream& script,
+               const std::string& script_name) {
+    using Clock = std::chrono::steady_clock;
+    const auto input_buffer = std::make_unique<InputBuffer>();
+    ScriptReader reader(script);
+    ScriptReader::Statement statement;
+    size_t executed = 0;
+    Clock::duration slowest{};
+    size_t slowest_line = 0;
+    bool failed = false;
+
+    const auto started = Clock::now();
+    while (reader.next(statement)) {
+        if (statement.text == ".exit") {
+            break;
+        }
+
+        const auto statement_started = Clock::now();
+        input_buffer->set_buffer(std::move(statement.text));
+        std::string error;
+        if (input_buffer->get_buffer_first_char() == '.') {
+            if (MetaCommandHandler::exec_meta_command(input_buffer, db) == MetaCommandResults::UNRECOGNIZED_COMMAND) {
+                error = "Unknown meta command " + input_buffer->get_buffer();
+            }
+        } else if (const auto result = sql_handler.exec_sql_command(input_buffer); result != SqlCommandResults::SUCCESS) {
+            error = sql_handler.error_message(result);
+        }
+        if (!error.empty()) {
+            // std::cerr is tied to std::cout, so the output before the error comes out first.
+            std::cerr << "ERROR: " << script_name << ":" << statement.line << ": " << error << "\n";
+            failed = true;
+            break;
+        }
+
+        executed++;
+        if (const auto took = Clock::now() - statement_started; took > slowest) {
+            slowest = took;
+            slowest_line = statement.line;
+        }
+    }
+    std::cout.flush();
+
+    const auto seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    std::cerr << std::fixed << std::setprecision(3)
+              << (failed ? "Stopped after " : "Executed ") << executed << " statement(s) in " << seconds << " s";
+    if (executed > 0 && seconds > 0) {
+        std::cerr << std::setprecision(0) << " (" << executed / seconds << " statements/s"
+                  << std::setprecision(3) << ", slowest " << std::chrono::duration<double, std::milli>(slowest).count()
+                  << " ms at line " << slowest_line << ")";
+    }
+    std::cerr << ".\n";
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Storage settings given on the command line; unset ones keep the defaults
+// of DatabasePersistence.
+struct StorageSettings {
+    std::optional<FlushPolicy> flush_policy;
+    std::chrono::milliseconds flush_interval{1000};
+    std::optional<size_t> memory_budget;
+    std::optional<ReadMode> read_mode;
+    std::optional<std::chrono::milliseconds> group_commit_window;
+    size_t group_commit_size = 64;
+    std::optional<uint64_t> checkpoint_threshold;
+};
+
+void apply_settings(DatabasePersistence& db, const StorageSettings& settings) {
+    if (settings.flush_policy) {
+        db.set_flush_policy(*settings.flush_policy, settings.flush_interval);
+    }
+    if (settings.memory_budget) {
+        db.set_memory_budget(*settings.memory_budget);
+    }
+    if (settings.read_mode) {
+        db.set_read_mode(*settings.read_mode);
+    }
+    if (settings.group_commit_window) {
+        db.set_group_commit(settings.group_commit_size, *settings.group_commit_window);
+    }
+    if (settings.checkpoint_threshold) {
+        db.set_checkpoint_threshold(*settings.checkpoint_threshold);
+    }
+}
+
+// Whole non-negative number, or nullopt.
+std::optional<size_t> parse_count(const std::string& text) {
+    size_t parsed = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return parsed;
+}
+
+void print_usage(const char* program) {
+    constexpr size_t MIB = 1024 * 1024;
+    std::cerr << "Usage: " << program << " [--file SCRIPT | --listen ADDRESS... [--threads N]] [STORAGE OPTION]...\n"
+              << "  --file SCRIPT     run the statements of SCRIPT (as when it is piped to stdin) and exit\n"
+              << "  --listen ADDRESS  serve clients on HOST:PORT or unix:PATH instead of reading the console\n"
+              << "  --threads N       worker threads of the server\n"
+              << "Storage options:\n"
+              << "  --flush statement|periodic|exit  when changed tables are written back (default statement)\n"
+              << "  --flush-interval MS              time between periodic flushes (default 1000)\n"
+              << "  --memory-budget MIB              memory for resident tables (default "
+              << DatabasePersistence::DEFAULT_CACHE_BUDGET / MIB << ")\n"
+              << "  --read-mode mapped|buffered      how tables larger than the budget are scanned (default mapped)\n"
+              << "  --group-commit-window MS         let commits wait up to MS for a shared fsync (default 0, off)\n"
+              << "  --group-commit-size N            commits that force the fsync sooner (default 64)\n"
+              << "  --checkpoint-threshold MIB       log size that triggers a checkpoint (default "
+              << DatabasePersistence::DEFAULT_CHECKPOINT_THRESHOLD / MIB << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> listen_addresses;
+    std::string script_path;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    StorageSettings settings;
+    for (int i = 1; i < argc; i++) {
+        const std::string argument = argv[i];
+        if (i + 1 == argc) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        const std::string value = argv[++i];
+        const auto count = parse_count(value);
+
+        bool valid = true;
+        if (argument == "--file") {
+            script_path = value;
+        } else if (argument == "--listen") {
+            listen_addresses.push_back(value);
+        } else if (argument == "--threads" && count) {
+            threads = *count;
+        } else if (argument == "--flush" && (value == "statement" || value == "periodic" || value == "exit")) {
+            settings.flush_policy = value == "statement" ? FlushPolicy::PER_STATEMENT
+                                  : value == "periodic" ? FlushPolicy::PERIODIC
+                                  : FlushPolicy::ON_EXIT;
+        } else if (argument == "--flush-interval" && count) {
+            settings.flush_interval = std::chrono::milliseconds(*count);
+        } else if (argument == "--memory-budget" && count) {
+            settings.memory_budget = *count * 1024 * 1024;
+        } else if (argument == "--read-mode" && (value == "mapped" || value == "buffered")) {
+            settings.read_mode = value == "mapped" ? ReadMode::MAPPED : ReadMode::BUFFERED;
+        } else if (argument == "--group-commit-window" && count) {
+            settings.group_commit_window = std::chrono::milliseconds(*count);
+        } else if (argument == "--group-commit-size" && count) {
+            settings.group_commit_size = *count;
+        } else if (argument == "--checkpoint-threshold" && count) {
+            settings.checkpoint_threshold = uint64_t{*count} * 1024 * 1024;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!script_path.empty() && !listen_addresses.empty()) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream script_file;
+    if (!script_path.empty()) {
+        script_file.open(script_path);
+        if (!script_file) {
+            std::cerr << "ERROR: Could not open " << script_path << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    // Statements piped to stdin run as a script too.
+    const bool batch = listen_addresses.empty() && (script_file.is_open() || !is_console_input());
+    if (batch) {
+        // Without the prompt's flushes, output is written in large blocks;
+        // reading stdin must not flush it either.
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+    }
+
+#ifdef CPPDATABASE_SERVER
+    const auto signals = listen_addresses.empty() ? sigset_t{} : block_stop_signals();
+#endif
     const auto input_buffer = std::make_unique<InputBuffer>();
     const auto db = std::make_shared<DatabasePersistence>("./data");
+    apply_settings(*db, settings);
     auto sql_handler = SqlCommandHandler(db);
 
+    if (const auto replayed = sql_handler.recover(); replayed > 0) {
+        std::cout << "Recovered " << replayed << " statement(s) from the write-ahead log.\n";
+    }
+
+    if (!listen_addresses.empty()) {
+#ifdef CPPDATABASE_SERVER
+        return run_server(db, listen_addresses, threads, signals);
+#else
+        std::cerr << "ERROR: This build has no server mode.\n";
+        return EXIT_FAILURE;
+#endif
+    }
+
+    if (batch) {
+        return script_file.is_open() ? run_script(sql_handler, *db, script_file, script_path)
+                                     : run_script(sql_handler, *db, std::cin, "stdin");
+    }
+
     print_tables(*db);
 
     InputBuffer::print_welcome_message();
@@ -47,7 +319,7 @@ int main() {
         }
 
         if (input_buffer->get_buffer_first_char() == '.') {
-            switch (MetaCommandHandler::exec_meta_command(input_buffer)) {
+            switch (MetaCommandHandler::exec_meta_command(input_buffer, *db)) {
                 case MetaCommandResults::SUCCESS:
                     continue;
                 case MetaCommandResults::UNRECOGNIZED_COMMAND:
@@ -56,31 +328,8 @@ int main() {
             }
         }
 
-        switch (sql_handler.exec_sql_command(input_buffer)) {
-            case SqlCommandResults::SUCCESS:
-                break;
-            case SqlCommandResults::UNKNOWN_ERROR:
-                std::cout << "ERROR: Unknown error occurred\n";
-                break;
-            case SqlCommandResults::UNKNOWN_COMMAND:
-                std::cout << "ERROR: Unknown command " <<  input_buffer->get_buffer() << "\n";
-                break;
-            case SqlCommandResults::TABLE_NOT_FOUND:
-                std::cout << "ERROR: Table not found\n";
-                break;
-            case SqlCommandResults::TABLE_ALREADY_EXISTS:
-                std::cout << "ERROR: Table already exists\n";
-                break;
-            case SqlCommandResults::INCORRECT_EXPRESSION:
-                std::cout << "ERROR: Incorrect SQL expression\n";
-                break;
-            case SqlCommandResults::EMPTY_QUERY:
-                std::cout << "ERROR: Empty query\n";
-                break;
-            case SqlCommandResults::TABLE_DOES_NOT_EXIST:
-                std::cout << "ERROR: Table does not exist\n";
-                break;
-            default: ;
+        if (const auto result = sql_handler.exec_sql_command(input_buffer); result != SqlCommandResults::SUCCESS) {
+            std::cout << "ERROR: " << sql_handler.error_message(result) << "\n";
         }
     }
 
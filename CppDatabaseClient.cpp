@@ -0,0 +1,85 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "class_definitions/InputBuffer.hpp"
+#include "class_definitions/Protocol.hpp"
+#include "types/enums.hpp"
+
+// KLIENT BAZY DANYCH
+// Sends statements to a server started with CppDatabase --listen and prints
+// what they return: the statements given as arguments, or else one per line
+// of the console.
+
+// Sends one statement and prints its output. Returns false when it failed.
+bool run_query(int connection, const std::string& statement) {
+    Protocol::write_message(connection, MessageType::QUERY, statement);
+
+    Message reply;
+    while (Protocol::read_message(connection, reply)) {
+        if (reply.type == MessageType::OUTPUT) {
+            std::cout << reply.payload;
+            continue;
+        }
+        if (reply.type != MessageType::DONE || reply.payload.empty()) {
+            break;
+        }
+
+        std::cout << std::flush;
+        if (static_cast<SqlCommandResults>(reply.payload[0]) == SqlCommandResults::SUCCESS) {
+            return true;
+        }
+        std::cout << "ERROR: " << reply.payload.substr(1) << "\n";
+        return false;
+    }
+    throw std::runtime_error("Server closed the connection");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " ADDRESS [STATEMENT]...\n"
+                  << "  ADDRESS is HOST:PORT or unix:PATH, as given to CppDatabase --listen\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const int connection = Protocol::connect(argv[1]);
+
+        if (argc > 2) {
+            bool succeeded = true;
+            for (int i = 2; i < argc; i++) {
+                succeeded = run_query(connection, argv[i]) && succeeded;
+            }
+            ::close(connection);
+            return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        const bool interactive = ::isatty(STDIN_FILENO);
+        const auto input_buffer = std::make_unique<InputBuffer>();
+        while (true) {
+            if (interactive) {
+                InputBuffer::print_ready_query();
+            }
+            input_buffer->read_input();
+            if (!std::cin) {
+                break;
+            }
+            if (input_buffer->is_input_empty()) {
+                continue;
+            }
+
+            run_query(connection, input_buffer->get_buffer());
+            if (input_buffer->get_buffer() == ".exit") {
+                break;
+            }
+        }
+        ::close(connection);
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// Times the WHERE filter kernels with each instruction set the CPU supports.
+//
+//   cmake -S . -B build -DCPPDATABASE_BUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target filter_kernels_benchmark
+//   ./build/filter_kernels_benchmark [rows] [repetitions]
+
+#include "class_definitions/FilterKernels.hpp"
+#include "class_definitions/Table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    struct Operator {
+        WhereOperator op;
+        const char* symbol;
+    };
+
+    constexpr Operator OPERATORS[] = {
+        {WhereOperator::EQUALS, "="},
+        {WhereOperator::GREATER, ">"},
+        {WhereOperator::LESS, "<"},
+        {WhereOperator::GREATER_EQ, ">="},
+        {WhereOperator::LESS_EQ, "<="},
+    };
+
+    // Best of `repetitions`, in nanoseconds per row.
+    template <typename Body>
+    auto time_per_row(size_t rows, int repetitions, Body body) -> double {
+        auto best = std::chrono::nanoseconds::max();
+        for (int i = 0; i < repetitions; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start));
+        }
+        return static_cast<double>(best.count()) / static_cast<double>(rows);
+    }
+
+    auto count_bits(const std::vector<uint64_t>& bitmap) -> size_t {
+        size_t total = 0;
+        for (const auto word : bitmap) {
+            total += static_cast<size_t>(std::popcount(word));
+        }
+        return total;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16'000'000;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<int64_t> distribution(0, 999);
+    std::vector<int64_t> values(rows);
+    std::ranges::generate(values, [&] { return distribution(random); });
+    std::vector<uint64_t> booleans(FilterKernels::words_for(rows));
+    std::ranges::generate(booleans, [&] { return random(); });
+
+    std::vector<uint64_t> selection(FilterKernels::words_for(rows));
+    std::vector<uint64_t> other(FilterKernels::words_for(rows));
+    constexpr int64_t literal = 500;
+
+    std::vector<FilterKernels::Isa> isas{FilterKernels::Isa::SCALAR};
+    for (const auto isa : {FilterKernels::Isa::SSE42, FilterKernels::Isa::AVX2}) {
+        if (isa <= FilterKernels::best_isa()) {
+            isas.push_back(isa);
+        }
+    }
+
+    std::cout << rows << " rows, best of " << repetitions << ", ns/row\n\n";
+    std::cout << std::left << std::setw(18) << "INTEGER";
+    for (const auto isa : isas) {
+        std::cout << std::setw(10) << FilterKernels::isa_name(isa);
+    }
+    std::cout << "speedup\n" << std::fixed << std::setprecision(3);
+
+    for (const auto& [op, symbol] : OPERATORS) {
+        std::cout << std::setw(18) << (std::string("value ") + symbol + " 500");
+        double scalar = 0;
+        double fastest = 0;
+        size_t expected = 0;
+        for (const auto isa : isas) {
+            FilterKernels::set_isa(isa);
+            fastest = time_per_row(rows, repetitions, [&] {
+                FilterKernels::compare_integers(values.data(), rows, op, literal, selection.data());
+            });
+            // Every instruction set must select the same rows.
+            const auto selected = count_bits(selection);
+            if (isa == FilterKernels::Isa::SCALAR) {
+                scalar = fastest;
+                expected = selected;
+            } else if (selected != expected) {
+                std::cerr << "mismatch for " << symbol << " with " << FilterKernels::isa_name(isa) << '\n';
+                return 1;
+            }
+            std::cout << std::setw(10) << fastest;
+        }
+        std::cout << std::setprecision(2) << scalar / fastest << "x\n" << std::setprecision(3);
+    }
+
+    FilterKernels::set_isa(FilterKernels::best_isa());
+    std::cout << "\nBOOLEAN / combine (word at a time)\n";
+    std::cout << std::setw(18) << "flag = TRUE" << time_per_row(rows, repetitions, [&] {
+        FilterKernels::compare_booleans(booleans.data(), rows, WhereOperator::EQUALS, true, selection.data());
+    }) << '\n';
+    FilterKernels::compare_integers(values.data(), rows, WhereOperator::LESS, literal, other.data());
+    std::cout << std::setw(18) << "AND" << time_per_row(rows, repetitions, [&] {
+        FilterKernels::and_into(selection.data(), other.data(), selection.size());
+    }) << '\n';
+    std::cout << std::setw(18) << "OR" << time_per_row(rows, repetitions, [&] {
+        FilterKernels::or_into(selection.data(), other.data(), selection.size());
+    }) << '\n';
+
+    return 0;
+}
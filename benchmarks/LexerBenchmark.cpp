@@ -0,0 +1,111 @@
+// Compares SqlLexer with the istringstream tokenizer it replaced, on long
+// INSERT statements.
+//
+//   cmake -S . -B build -DCPPDATABASE_BUILD_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build --target lexer_benchmark
+//   ./build/lexer_benchmark [values per statement] [statements]
+
+#include "handlers/SqlLexer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    // The previous SqlCommandHandler::tokenize, kept verbatim as the baseline.
+    auto legacy_tokenize(const std::string& query) -> std::vector<std::string> {
+        std::vector<std::string> tokens;
+        std::istringstream iss(query);
+        std::string token;
+
+        while (iss >> token) {
+            token.erase(std::ranges::remove(token, ',').begin(), token.end());
+            token.erase(std::ranges::remove(token, '(').begin(), token.end());
+            token.erase(std::ranges::remove(token, ')').begin(), token.end());
+
+            if (!token.empty()) {
+                std::ranges::transform(token, token.begin(), ::toupper);
+                tokens.push_back(token);
+            }
+        }
+        return tokens;
+    }
+
+    auto make_insert(size_t values, size_t seed) -> std::string {
+        std::string statement = "INSERT INTO measurements (";
+        for (size_t i = 0; i < values; i++) {
+            if (i > 0) {
+                statement += ", ";
+            }
+            switch ((i + seed) % 3) {
+                case 0: statement += std::to_string(i * 7919 + seed); break;
+                case 1: statement += "sensor_" + std::to_string(i); break;
+                case 2: statement += "true"; break;
+            }
+        }
+        return statement + ")";
+    }
+
+    // Best of five passes over all statements, in nanoseconds per statement.
+    template <typename Body>
+    auto time_per_statement(size_t statements, Body body) -> double {
+        auto best = std::chrono::nanoseconds::max();
+        for (int pass = 0; pass < 5; pass++) {
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start));
+        }
+        return static_cast<double>(best.count()) / static_cast<double>(statements);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const size_t values = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+    const size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20'000;
+
+    std::vector<std::string> statements;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        statements.push_back(make_insert(values, i));
+        bytes += statements.back().size();
+    }
+
+    size_t legacy_tokens = 0;
+    const auto legacy = time_per_statement(count, [&] {
+        legacy_tokens = 0;
+        for (const auto& statement : statements) {
+            legacy_tokens += legacy_tokenize(statement).size();
+        }
+    });
+
+    // One token vector reused across statements, as a server loop would.
+    size_t lexer_tokens = 0;
+    SqlTokens tokens;
+    const auto lexer = time_per_statement(count, [&] {
+        lexer_tokens = 0;
+        for (const auto& statement : statements) {
+            tokens.clear();
+            SqlLexer::tokenize(statement, tokens);
+            lexer_tokens += tokens.size();
+        }
+    });
+
+    std::cout << count << " INSERT statements, " << values << " values, "
+              << bytes / count << " bytes each\n\n" << std::fixed << std::setprecision(0);
+    std::cout << std::left << std::setw(12) << "tokenizer" << std::setw(16) << "ns/statement"
+              << std::setw(12) << "MB/s" << "tokens\n";
+    const auto report = [&](const char* label, double ns, size_t total) {
+        std::cout << std::setw(12) << label << std::setw(16) << ns
+                  << std::setw(12) << static_cast<double>(bytes) / count / ns * 1000 << total << '\n';
+    };
+    report("legacy", legacy, legacy_tokens);
+    report("SqlLexer", lexer, lexer_tokens);
+    std::cout << "\nspeedup " << std::setprecision(1) << legacy / lexer << "x\n";
+    return 0;
+}
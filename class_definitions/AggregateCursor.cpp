@@ -0,0 +1,227 @@
+#include "AggregateCursor.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+    auto format_average(int64_t sum, int64_t count) -> std::string {
+        char buffer[32];
+        const auto average = static_cast<double>(sum) / static_cast<double>(count);
+        const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), average);
+        return {buffer, end};
+    }
+}
+
+AggregateCursor::AggregateCursor(std::unique_ptr<Cursor> source, std::vector<size_t> group_by,
+                                 std::vector<AggregateCall> aggregates, std::vector<AggregateOutput> output_columns)
+    : input(std::move(source)),
+      group_columns(std::move(group_by)),
+      calls(std::move(aggregates)),
+      outputs(std::move(output_columns)) {
+    const auto& columns = input->get_columns();
+    for (const auto& item : outputs) {
+        if (!item.is_aggregate) {
+            output.push_back(columns.at(group_columns.at(item.index)));
+            continue;
+        }
+
+        const auto& call = calls.at(item.index);
+        if (call.function == AggregateFunction::COUNT_ROWS) {
+            output.push_back({call_name(call.function, "*"), ColumnType::INTEGER});
+        } else {
+            const auto& column = columns.at(call.column);
+            output.push_back({call_name(call.function, column.name), result_type(call.function, column.type)});
+        }
+    }
+}
+
+auto AggregateCursor::call_name(AggregateFunction function, const std::string& column) -> std::string {
+    switch (function) {
+        case AggregateFunction::COUNT_ROWS:
+        case AggregateFunction::COUNT: return "COUNT(" + column + ")";
+        case AggregateFunction::SUM: return "SUM(" + column + ")";
+        case AggregateFunction::MIN: return "MIN(" + column + ")";
+        case AggregateFunction::MAX: return "MAX(" + column + ")";
+        case AggregateFunction::AVG: return "AVG(" + column + ")";
+    }
+    return column;
+}
+
+auto AggregateCursor::result_type(AggregateFunction function, ColumnType input) -> ColumnType {
+    switch (function) {
+        case AggregateFunction::MIN:
+        case AggregateFunction::MAX: return input;
+        case AggregateFunction::AVG: return ColumnType::TEXT;
+        default: return ColumnType::INTEGER;
+    }
+}
+
+auto AggregateCursor::hash_key(const Tuple& row) const -> uint64_t {
+    const auto& columns = input->get_columns();
+    uint64_t hash = 0;
+    for (const auto column : group_columns) {
+        // Rotate so that (a, b) and (b, a) hash apart.
+        hash = std::rotl(hash, 17) ^ row[column].hash(columns[column].type);
+    }
+    return hash;
+}
+
+auto AggregateCursor::same_key(const Tuple& row, size_t group) const -> bool {
+    const auto& columns = input->get_columns();
+    const auto& key = keys[group];
+    for (size_t i = 0; i < group_columns.size(); i++) {
+        const auto column = group_columns[i];
+        if (row[column].compare(key[i], columns[column].type) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto AggregateCursor::add_group(const Tuple& row) -> size_t {
+    Tuple key;
+    key.reserve(group_columns.size());
+    for (const auto column : group_columns) {
+        key.push_back(row[column]);
+    }
+    keys.push_back(std::move(key));
+    accumulators.resize(accumulators.size() + calls.size());
+    return keys.size() - 1;
+}
+
+auto AggregateCursor::find_group(const Tuple& row) -> size_t {
+    // Keep at most 70% of the slots occupied, like HashIndex.
+    if ((keys.size() + 1) * 10 > slots.size() * 7) {
+        grow();
+    }
+
+    const auto hash = hash_key(row);
+    const auto mask = slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto& slot = slots[i];
+        if (slot.group == EMPTY) {
+            slot = {hash, add_group(row)};
+            return slot.group;
+        }
+        if (slot.hash == hash && same_key(row, slot.group)) {
+            return slot.group;
+        }
+    }
+}
+
+auto AggregateCursor::grow() -> void {
+    std::vector<Slot> old(std::max(slots.size() * 2, MIN_CAPACITY), Slot{});
+    old.swap(slots);
+    const auto mask = slots.size() - 1;
+    for (const auto& slot : old) {
+        if (slot.group == EMPTY) {
+            continue;
+        }
+        auto i = slot.hash & mask;
+        while (slots[i].group != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
+auto AggregateCursor::accumulate(const Tuple& row, size_t group) -> void {
+    const auto& columns = input->get_columns();
+    for (size_t i = 0; i < calls.size(); i++) {
+        const auto& call = calls[i];
+        auto& accumulator = accumulators[group * calls.size() + i];
+        if (call.function == AggregateFunction::COUNT_ROWS) {
+            accumulator.count++;
+            continue;
+        }
+
+        const auto& value = row[call.column];
+        if (value.is_null) {
+            continue;
+        }
+        accumulator.count++;
+        switch (call.function) {
+            case AggregateFunction::SUM:
+            case AggregateFunction::AVG:
+                if (__builtin_add_overflow(accumulator.sum, value.integer, &accumulator.sum)) {
+                    throw std::runtime_error("Integer overflow in " + call_name(call.function, columns[call.column].name));
+                }
+                break;
+            case AggregateFunction::MIN:
+            case AggregateFunction::MAX: {
+                const auto order = value.compare(accumulator.extreme, columns[call.column].type);
+                if (accumulator.extreme.is_null || (call.function == AggregateFunction::MIN ? order < 0 : order > 0)) {
+                    accumulator.extreme = value;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+auto AggregateCursor::aggregate() -> void {
+    aggregated = true;
+    Tuple row;
+    if (group_columns.empty()) {
+        // A global aggregate always has its one row, even over no input.
+        accumulators.resize(calls.size());
+        keys.emplace_back();
+        while (input->next(row)) {
+            accumulate(row, 0);
+        }
+        return;
+    }
+
+    while (input->next(row)) {
+        accumulate(row, find_group(row));
+    }
+}
+
+auto AggregateCursor::result(const Accumulator& accumulator, const AggregateCall& call) const -> Value {
+    Value value;
+    switch (call.function) {
+        case AggregateFunction::COUNT_ROWS:
+        case AggregateFunction::COUNT:
+            value.is_null = false;
+            value.integer = accumulator.count;
+            break;
+        case AggregateFunction::SUM:
+            value.is_null = accumulator.count == 0;
+            value.integer = accumulator.sum;
+            break;
+        case AggregateFunction::AVG:
+            value.is_null = accumulator.count == 0;
+            if (!value.is_null) {
+                value.text = format_average(accumulator.sum, accumulator.count);
+            }
+            break;
+        case AggregateFunction::MIN:
+        case AggregateFunction::MAX:
+            value = accumulator.extreme;
+            break;
+    }
+    return value;
+}
+
+auto AggregateCursor::next(Tuple& row) -> bool {
+    if (!aggregated) {
+        aggregate();
+    }
+    if (position >= keys.size()) {
+        return false;
+    }
+
+    const auto group = position++;
+    row.resize(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const auto& item = outputs[i];
+        row[i] = item.is_aggregate
+            ? result(accumulators[group * calls.size() + item.index], calls[item.index])
+            : keys[group][item.index];
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "class_definitions/Cursor.hpp"
+
+enum class AggregateFunction {
+    COUNT_ROWS, // COUNT(*)
+    COUNT,
+    SUM,
+    MIN,
+    MAX,
+    AVG
+};
+
+struct AggregateCall {
+    AggregateFunction function;
+    size_t column = 0; // input column; unused by COUNT(*)
+};
+
+// One output column: a GROUP BY column or an aggregate call, by position.
+struct AggregateOutput {
+    bool is_aggregate;
+    size_t index; // into the group columns or the calls
+};
+
+// GROUP BY and aggregates over another cursor. Groups live in an
+// open-addressing (linear probing) table of hashes and group numbers; keys
+// and running totals are kept per group, in first-seen order, which is also
+// the output order. Without GROUP BY there is a single group and no hashing.
+//
+// COUNT, SUM and AVG skip NULLs; SUM, MIN, MAX and AVG of no values are NULL.
+// SUM is an INTEGER and throws on overflow, AVG is returned as TEXT. NULL
+// group keys form one group. The input is drained by the first next().
+class AggregateCursor : public Cursor {
+    struct Accumulator {
+        int64_t count = 0;
+        int64_t sum = 0;
+        Value extreme; // MIN / MAX
+    };
+
+    struct Slot {
+        uint64_t hash = 0;
+        size_t group = EMPTY;
+    };
+
+    static constexpr size_t EMPTY = SIZE_MAX;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    std::unique_ptr<Cursor> input;
+    std::vector<size_t> group_columns;
+    std::vector<AggregateCall> calls;
+    std::vector<AggregateOutput> outputs;
+    std::vector<Column> output;
+
+    bool aggregated = false;
+    std::vector<Slot> slots;
+    std::vector<Tuple> keys;                // per group
+    std::vector<Accumulator> accumulators;  // calls.size() per group
+    size_t position = 0;
+
+    [[nodiscard]] auto hash_key(const Tuple& row) const -> uint64_t;
+    [[nodiscard]] auto same_key(const Tuple& row, size_t group) const -> bool;
+    auto find_group(const Tuple& row) -> size_t;
+    auto add_group(const Tuple& row) -> size_t;
+    auto grow() -> void;
+    auto accumulate(const Tuple& row, size_t group) -> void;
+    auto aggregate() -> void;
+    [[nodiscard]] auto result(const Accumulator& accumulator, const AggregateCall& call) const -> Value;
+
+public:
+    AggregateCursor(std::unique_ptr<Cursor> source, std::vector<size_t> group_by, std::vector<AggregateCall> aggregates,
+                    std::vector<AggregateOutput> output_columns);
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return output; }
+    auto next(Tuple& row) -> bool override;
+
+    // Output name of an aggregate, e.g. COUNT(*) or SUM(PRICE).
+    [[nodiscard]] static auto call_name(AggregateFunction function, const std::string& column) -> std::string;
+    // Type of the aggregate's values given the type of its input column.
+    [[nodiscard]] static auto result_type(AggregateFunction function, ColumnType input) -> ColumnType;
+};
@@ -0,0 +1,384 @@
+#include "BTreeIndex.hpp"
+#include "PageFile.hpp"
+#include "Table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    auto store(char* out, uint64_t value, int bytes) -> void {
+        for (int i = 0; i < bytes; i++) out[i] = static_cast<char>(value >> (8 * i) & 0xFF);
+    }
+
+    auto load(const char* in, int bytes) -> uint64_t {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return value;
+    }
+
+    auto integer_key(int64_t value) -> std::string {
+        // Big endian with the sign bit flipped sorts like the signed value.
+        const auto bits = static_cast<uint64_t>(value) ^ (uint64_t{1} << 63);
+        std::string key(8, '\0');
+        for (int i = 0; i < 8; i++) key[i] = static_cast<char>(bits >> (8 * (7 - i)) & 0xFF);
+        return key;
+    }
+
+    auto text_key(std::string_view value) -> std::string {
+        return std::string(value.substr(0, BTreeIndex::MAX_KEY_SIZE));
+    }
+}
+
+auto BTreeIndex::encode_key(const ColumnVector& column, size_t row) -> std::string {
+    switch (column.get_type()) {
+        case ColumnType::INTEGER: return integer_key(column.integer_at(row));
+        case ColumnType::BOOLEAN: return std::string(1, column.boolean_at(row) ? '\1' : '\0');
+        case ColumnType::TEXT: return text_key(column.text_at(row));
+    }
+    return {};
+}
+
+auto BTreeIndex::encode_literal(ColumnType type, std::string_view literal) -> std::string {
+    switch (type) {
+        case ColumnType::INTEGER: return integer_key(ColumnVector::parse_integer(literal));
+        case ColumnType::BOOLEAN: return std::string(1, ColumnVector::parse_boolean(literal) ? '\1' : '\0');
+        case ColumnType::TEXT: return text_key(literal);
+    }
+    return {};
+}
+
+auto BTreeIndex::encoded_size(const Node& node) -> size_t {
+    const size_t fixed = node.is_leaf ? 2 + 8 : 2 + 8 + 4;
+    size_t size = NODE_HEADER_SIZE;
+    for (const auto& entry : node.entries) {
+        size += fixed + entry.key.size();
+    }
+    return size;
+}
+
+auto BTreeIndex::encode_node(const Node& node, char* page) -> void {
+    page[0] = node.is_leaf ? 1 : 0;
+    page[1] = 0;
+    store(page + 2, node.entries.size(), 2);
+    store(page + 4, node.link, 4);
+
+    auto* position = page + NODE_HEADER_SIZE;
+    for (const auto& entry : node.entries) {
+        store(position, entry.key.size(), 2);
+        std::memcpy(position + 2, entry.key.data(), entry.key.size());
+        position += 2 + entry.key.size();
+        store(position, entry.row, 8);
+        position += 8;
+        if (!node.is_leaf) {
+            store(position, entry.child, 4);
+            position += 4;
+        }
+    }
+}
+
+auto BTreeIndex::decode_node(const char* page) -> Node {
+    Node node;
+    node.is_leaf = page[0] != 0;
+    node.link = static_cast<uint32_t>(load(page + 4, 4));
+    const auto count = load(page + 2, 2);
+    node.entries.resize(count);
+
+    const auto* position = page + NODE_HEADER_SIZE;
+    for (auto& entry : node.entries) {
+        const auto key_size = load(position, 2);
+        entry.key.assign(position + 2, key_size);
+        position += 2 + key_size;
+        entry.row = load(position, 8);
+        position += 8;
+        if (!node.is_leaf) {
+            entry.child = static_cast<uint32_t>(load(position, 4));
+            position += 4;
+        }
+    }
+    return node;
+}
+
+auto BTreeIndex::read_node(uint32_t page_id) const -> Node {
+    const auto page = pool->fetch_page(path, page_id);
+    return decode_node(page.data());
+}
+
+auto BTreeIndex::write_node(uint32_t page_id, const Node& node) const -> void {
+    auto page = pool->fetch_page(path, page_id);
+    encode_node(node, page.data());
+    page.mark_dirty();
+}
+
+auto BTreeIndex::less(const std::string& key, uint64_t row, const Entry& entry) -> bool {
+    const auto comparison = key.compare(entry.key);
+    return comparison < 0 || (comparison == 0 && row < entry.row);
+}
+
+auto BTreeIndex::descend(const std::string& key, uint64_t row, std::vector<uint32_t>* path_pages) const -> uint32_t {
+    auto page_id = ROOT_PAGE;
+    while (true) {
+        const auto node = read_node(page_id);
+        if (node.is_leaf) {
+            return page_id;
+        }
+        if (path_pages != nullptr) {
+            path_pages->push_back(page_id);
+        }
+
+        auto child = node.link;
+        for (const auto& entry : node.entries) {
+            if (less(key, row, entry)) {
+                break;
+            }
+            child = entry.child;
+        }
+        page_id = child;
+    }
+}
+
+auto BTreeIndex::mark_modified() -> void {
+    // The on-disk tree stops matching any table image as soon as the first
+    // page could be written back, until persist() stamps it again.
+    if (!modified) {
+        pool->set_lsn(path, INVALID_LSN);
+        pool->write_header(path);
+        modified = true;
+    }
+}
+
+auto BTreeIndex::insert(const ColumnVector& column, size_t row, uint64_t position) -> void {
+    if (column.is_null(row)) {
+        return;
+    }
+    mark_modified();
+
+    auto key = encode_key(column, row);
+    std::vector<uint32_t> parents;
+    auto page_id = descend(key, position, &parents);
+    auto node = read_node(page_id);
+    Entry pending{std::move(key), position, 0};
+
+    while (true) {
+        const auto position = std::ranges::find_if(node.entries, [&pending](const Entry& entry) {
+            return less(pending.key, pending.row, entry);
+        });
+        node.entries.insert(position, std::move(pending));
+        if (encoded_size(node) <= PageFile::PAGE_SIZE) {
+            write_node(page_id, node);
+            return;
+        }
+
+        // Split by bytes so both halves fit even with mixed key sizes.
+        const auto half = encoded_size(node) / 2;
+        size_t middle = 0;
+        for (size_t used = NODE_HEADER_SIZE; middle + 1 < node.entries.size(); middle++) {
+            used += node.entries[middle].key.size() + (node.is_leaf ? 10 : 14);
+            if (used >= half) {
+                middle++;
+                break;
+            }
+        }
+
+        Node right;
+        right.is_leaf = node.is_leaf;
+        Entry separator;
+        if (node.is_leaf) {
+            right.entries.assign(node.entries.begin() + static_cast<std::ptrdiff_t>(middle), node.entries.end());
+            right.link = node.link;
+            separator = {right.entries.front().key, right.entries.front().row, 0};
+        } else {
+            // The middle entry moves up; its child becomes the right node's leftmost.
+            separator = node.entries[middle];
+            right.link = separator.child;
+            right.entries.assign(node.entries.begin() + static_cast<std::ptrdiff_t>(middle) + 1, node.entries.end());
+        }
+        node.entries.resize(middle);
+
+        auto [right_id, right_page] = pool->new_page(path);
+        encode_node(right, right_page.data());
+        right_page.mark_dirty();
+        right_page.release();
+        separator.child = right_id;
+        if (node.is_leaf) {
+            node.link = right_id;
+        }
+
+        if (page_id == ROOT_PAGE) {
+            // The root stays on page 1: its left half moves to a new page.
+            auto [left_id, left_page] = pool->new_page(path);
+            encode_node(node, left_page.data());
+            left_page.mark_dirty();
+            left_page.release();
+
+            Node root;
+            root.is_leaf = false;
+            root.link = left_id;
+            root.entries.push_back(std::move(separator));
+            write_node(ROOT_PAGE, root);
+            return;
+        }
+
+        write_node(page_id, node);
+        page_id = parents.back();
+        parents.pop_back();
+        node = read_node(page_id);
+        pending = std::move(separator);
+    }
+}
+
+auto BTreeIndex::erase(const ColumnVector& column, size_t row) -> void {
+    if (column.is_null(row)) {
+        return;
+    }
+    mark_modified();
+
+    const auto key = encode_key(column, row);
+    const auto page_id = descend(key, row, nullptr);
+    auto node = read_node(page_id);
+    const auto it = std::ranges::find_if(node.entries, [&](const Entry& entry) {
+        return entry.row == row && entry.key == key;
+    });
+    if (it != node.entries.end()) {
+        node.entries.erase(it);
+        write_node(page_id, node);
+    }
+}
+
+auto BTreeIndex::find(ColumnType type, WhereOperator op, std::string_view literal) const -> std::vector<size_t> {
+    std::vector<size_t> rows;
+    find(type, op, literal, [&rows](size_t row) {
+        rows.push_back(row);
+        return true;
+    });
+    return rows;
+}
+
+auto BTreeIndex::find(ColumnType type, WhereOperator op, std::string_view literal,
+                      const std::function<bool(size_t)>& visitor) const -> void {
+    const auto key = encode_literal(type, literal);
+    const bool has_lower = op == WhereOperator::EQUALS || op == WhereOperator::GREATER || op == WhereOperator::GREATER_EQ;
+    const bool has_upper = op == WhereOperator::EQUALS || op == WhereOperator::LESS || op == WhereOperator::LESS_EQ;
+    find_range(has_lower ? std::optional(key) : std::nullopt, has_upper ? std::optional(key) : std::nullopt, visitor);
+}
+
+auto BTreeIndex::find_range(const std::optional<std::string>& lower_key, const std::optional<std::string>& upper_key,
+                            const std::function<bool(size_t)>& visitor) const -> void {
+    // Bounds are inclusive on the key: cut TEXT keys and the strict operators
+    // are settled by the caller's re-check.
+    const std::string lower = lower_key.value_or(std::string());
+
+    auto page_id = descend(lower, 0, nullptr);
+    while (page_id != 0) {
+        const auto node = read_node(page_id);
+        for (const auto& entry : node.entries) {
+            if (less(lower, 0, entry) || (entry.key == lower && entry.row == 0)) {
+                if (upper_key && entry.key.compare(*upper_key) > 0) {
+                    return;
+                }
+                if (!visitor(entry.row)) {
+                    return;
+                }
+            }
+        }
+        page_id = node.link;
+    }
+}
+
+auto BTreeIndex::build(const ColumnVector& column) -> void {
+    std::vector<Entry> entries;
+    entries.reserve(column.size());
+    for (size_t row = 0; row < column.size(); row++) {
+        if (!column.is_null(row)) {
+            entries.push_back({encode_key(column, row), row, 0});
+        }
+    }
+    std::ranges::sort(entries, [](const Entry& a, const Entry& b) { return less(a.key, a.row, b); });
+
+    // Pack one level at a time, bottom up. The first entry of every node
+    // becomes its entry in the level above; the single node of the top level
+    // is the root and goes to page 1.
+    // Internal nodes are packed with the entry of their leftmost child still
+    // in front; it turns into the node's link when the node is written.
+    const auto pack = [](std::vector<Entry>& level_entries, bool is_leaf) {
+        const size_t fixed = is_leaf ? 2 + 8 : 2 + 8 + 4; // as in encoded_size()
+        std::vector<Node> nodes(1);
+        nodes.back().is_leaf = is_leaf;
+        size_t used = NODE_HEADER_SIZE;
+        for (auto& entry : level_entries) {
+            const auto size = fixed + entry.key.size();
+            if (used + size > PageFile::PAGE_SIZE && !nodes.back().entries.empty()) {
+                nodes.emplace_back().is_leaf = is_leaf;
+                used = NODE_HEADER_SIZE;
+            }
+            used += size;
+            nodes.back().entries.push_back(std::move(entry));
+        }
+        return nodes;
+    };
+    const auto finish_internal = [](Node& node) {
+        node.link = node.entries.front().child;
+        node.entries.erase(node.entries.begin());
+    };
+
+    const auto temp_path = path + ".tmp";
+    {
+        auto file = PageFile::create(temp_path, {Column{column_name, column.get_type()}}, INVALID_LSN);
+        file.allocate_page(); // root
+        std::vector<char> page(PageFile::PAGE_SIZE, '\0');
+
+        auto nodes = pack(entries, true);
+        bool is_leaf = true;
+        while (true) {
+            if (nodes.size() == 1) {
+                auto& root = nodes.front();
+                if (!is_leaf) {
+                    finish_internal(root);
+                }
+                encode_node(root, page.data());
+                file.write_page(ROOT_PAGE, page.data());
+                break;
+            }
+
+            std::vector<uint32_t> ids;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                ids.push_back(file.allocate_page());
+            }
+
+            std::vector<Entry> parents;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                auto& node = nodes[i];
+                parents.push_back({node.entries.front().key, node.entries.front().row, ids[i]});
+                if (is_leaf) {
+                    node.link = i + 1 < nodes.size() ? ids[i + 1] : 0;
+                } else {
+                    finish_internal(node);
+                }
+                std::ranges::fill(page, '\0');
+                encode_node(node, page.data());
+                file.write_page(ids[i], page.data());
+            }
+
+            nodes = pack(parents, false);
+            is_leaf = false;
+        }
+        file.write_header();
+        file.flush();
+    }
+
+    pool->discard_file(path);
+    std::filesystem::rename(temp_path, path);
+    modified = true;
+}
+
+auto BTreeIndex::is_current(uint64_t lsn) const -> bool {
+    return lsn != INVALID_LSN && std::filesystem::exists(path) && PageFile::is_page_file(path)
+        && pool->header(path).lsn == lsn;
+}
+
+auto BTreeIndex::persist(uint64_t lsn) -> void {
+    pool->set_lsn(path, lsn);
+    pool->flush_file(path);
+    modified = false;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "class_definitions/BufferPool.hpp"
+#include "class_definitions/ColumnVector.hpp"
+
+enum class WhereOperator;
+
+// Secondary index over one column, stored as a B+tree in its own page file
+// and accessed through the buffer pool.
+//
+// Page 0 is a regular PageFile header (its LSN says which table image the
+// index matches), page 1 is always the root. Nodes:
+//   node:     IS_LEAF (u8) | unused (u8) | COUNT (u16) | LINK (u32) | ENTRY | ENTRY | ...
+//   leaf:     LINK = next leaf (0 = none), ENTRY = KEY_SIZE (u16) | KEY | ROW (u64)
+//   internal: LINK = leftmost child, ENTRY = KEY_SIZE (u16) | KEY | ROW (u64) | CHILD (u32)
+// Entries are ordered by (KEY, ROW), so duplicate values are fine. Keys are
+// byte strings that sort like the values: big-endian INTEGER with the sign bit
+// flipped, one byte per BOOLEAN, TEXT as is (cut to MAX_KEY_SIZE; range scans
+// then return a superset that the caller re-checks). Deleted entries are
+// simply removed from their leaf, nodes are never merged.
+class BTreeIndex {
+public:
+    static constexpr uint64_t INVALID_LSN = UINT64_MAX;
+    static constexpr size_t MAX_KEY_SIZE = 1024;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t row = 0;
+        uint32_t child = 0;
+    };
+
+    struct Node {
+        bool is_leaf = true;
+        uint32_t link = 0;
+        std::vector<Entry> entries;
+    };
+
+    static constexpr uint32_t ROOT_PAGE = 1;
+    static constexpr size_t NODE_HEADER_SIZE = 8;
+
+    std::string name;
+    std::string column_name;
+    std::string path;
+    BufferPool* pool;
+    bool modified = false;
+
+    [[nodiscard]] auto read_node(uint32_t page_id) const -> Node;
+    auto write_node(uint32_t page_id, const Node& node) const -> void;
+    [[nodiscard]] static auto encoded_size(const Node& node) -> size_t;
+    static auto encode_node(const Node& node, char* page) -> void;
+    static auto decode_node(const char* page) -> Node;
+    static auto less(const std::string& key, uint64_t row, const Entry& entry) -> bool;
+    // Leaf that would hold (key, row), with the internal pages on the way down.
+    [[nodiscard]] auto descend(const std::string& key, uint64_t row, std::vector<uint32_t>* path_pages) const -> uint32_t;
+    auto mark_modified() -> void;
+
+public:
+    BTreeIndex(std::string index_name, std::string indexed_column, std::string file_path, BufferPool& buffer_pool)
+        : name(std::move(index_name)), column_name(std::move(indexed_column)), path(std::move(file_path)),
+          pool(&buffer_pool) {}
+
+    [[nodiscard]] auto get_name() const -> const std::string& { return name; }
+    [[nodiscard]] auto get_column_name() const -> const std::string& { return column_name; }
+    [[nodiscard]] auto get_path() const -> const std::string& { return path; }
+
+    // Replaces the index file with one built bottom-up from the whole column.
+    auto build(const ColumnVector& column) -> void;
+    // True when the file exists and was last written for the table at `lsn`.
+    [[nodiscard]] auto is_current(uint64_t lsn) const -> bool;
+    // Writes dirty index pages and stamps the file with the table's LSN.
+    auto persist(uint64_t lsn) -> void;
+
+    // NULL values are not indexed.
+    auto insert(const ColumnVector& column, size_t row) -> void { insert(column, row, row); }
+    // Indexes the value at `row` of `column` as row `position` of the table,
+    // e.g. for rows appended to a data file from a separate batch.
+    auto insert(const ColumnVector& column, size_t row, uint64_t position) -> void;
+    // Call before the value in `row` changes.
+    auto erase(const ColumnVector& column, size_t row) -> void;
+    // Rows whose value may satisfy `value <op> literal`, in key order.
+    [[nodiscard]] auto find(ColumnType type, WhereOperator op, std::string_view literal) const -> std::vector<size_t>;
+    // Same walk, handing each row to `visitor` until it returns false.
+    auto find(ColumnType type, WhereOperator op, std::string_view literal,
+              const std::function<bool(size_t)>& visitor) const -> void;
+    // Rows with a key between the encoded bounds (inclusive; none for an open
+    // end), the same way.
+    auto find_range(const std::optional<std::string>& lower_key, const std::optional<std::string>& upper_key,
+                    const std::function<bool(size_t)>& visitor) const -> void;
+
+    [[nodiscard]] static auto encode_key(const ColumnVector& column, size_t row) -> std::string;
+    [[nodiscard]] static auto encode_literal(ColumnType type, std::string_view literal) -> std::string;
+};
@@ -0,0 +1,248 @@
+#include "BufferPool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+PageHandle::PageHandle(PageHandle&& other) noexcept
+    : pool(other.pool), frame(other.frame), page_data(other.page_data), dirty(other.dirty) {
+    other.pool = nullptr;
+}
+
+PageHandle& PageHandle::operator=(PageHandle&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        frame = other.frame;
+        page_data = other.page_data;
+        dirty = other.dirty;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+PageHandle::~PageHandle() {
+    release();
+}
+
+auto PageHandle::release() -> void {
+    if (pool != nullptr) {
+        pool->unpin(frame, dirty);
+        pool = nullptr;
+        page_data = nullptr;
+    }
+}
+
+BufferPool::BufferPool(size_t frame_count, std::chrono::milliseconds background_interval)
+    : frames(frame_count), writer_interval(background_interval) {
+    if (frame_count == 0) {
+        throw std::runtime_error("Buffer pool needs at least one frame");
+    }
+    for (auto& frame : frames) {
+        frame.data.resize(PageFile::PAGE_SIZE);
+    }
+    writer = std::thread(&BufferPool::background_writer, this);
+}
+
+BufferPool::~BufferPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    writer_signal.notify_all();
+    writer.join();
+
+    try {
+        flush_all();
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: Failed to write back buffered pages: " << e.what() << "\n";
+    }
+}
+
+auto BufferPool::fetch_page(const std::string& path, uint32_t page_id) -> PageHandle {
+    std::lock_guard lock(mutex);
+    const auto key = page_key(path, page_id);
+
+    if (const auto it = page_table.find(key); it != page_table.end()) {
+        auto& frame = frames[it->second];
+        frame.pin_count++;
+        frame.referenced = true;
+        return {this, it->second, frame.data.data()};
+    }
+
+    auto& file = open_file(path);
+    const auto index = acquire_frame();
+    auto& frame = frames[index];
+    file.read_page(page_id, frame.data.data());
+
+    frame.path = path;
+    frame.page_id = page_id;
+    frame.in_use = true;
+    frame.dirty = false;
+    frame.referenced = true;
+    frame.pin_count = 1;
+    page_table[key] = index;
+    return {this, index, frame.data.data()};
+}
+
+auto BufferPool::new_page(const std::string& path) -> std::pair<uint32_t, PageHandle> {
+    std::lock_guard lock(mutex);
+    auto& file = open_file(path);
+    const auto index = acquire_frame();
+    const auto page_id = file.allocate_page();
+
+    auto& frame = frames[index];
+    std::ranges::fill(frame.data, '\0');
+    DataPage(frame.data.data()).init();
+
+    frame.path = path;
+    frame.page_id = page_id;
+    frame.in_use = true;
+    frame.dirty = true;
+    frame.referenced = true;
+    frame.pin_count = 1;
+    page_table[page_key(path, page_id)] = index;
+    return {page_id, PageHandle(this, index, frame.data.data())};
+}
+
+auto BufferPool::header(const std::string& path) -> PageFileHeader {
+    std::lock_guard lock(mutex);
+    return open_file(path).get_header();
+}
+
+auto BufferPool::set_row_count(const std::string& path, uint64_t row_count) -> void {
+    std::lock_guard lock(mutex);
+    open_file(path).set_row_count(row_count);
+}
+
+auto BufferPool::set_lsn(const std::string& path, uint64_t lsn) -> void {
+    std::lock_guard lock(mutex);
+    open_file(path).set_lsn(lsn);
+}
+
+auto BufferPool::write_header(const std::string& path) -> void {
+    std::lock_guard lock(mutex);
+    auto& file = open_file(path);
+    file.write_header();
+    file.flush();
+}
+
+auto BufferPool::flush_file(const std::string& path) -> void {
+    std::lock_guard lock(mutex);
+    for (auto& frame : frames) {
+        if (frame.in_use && frame.dirty && frame.path == path) {
+            write_back(frame);
+        }
+    }
+
+    if (const auto it = files.find(path); it != files.end()) {
+        it->second->write_header();
+        it->second->flush();
+    }
+}
+
+auto BufferPool::flush_all() -> void {
+    std::lock_guard lock(mutex);
+    for (auto& frame : frames) {
+        if (frame.in_use && frame.dirty) {
+            write_back(frame);
+        }
+    }
+
+    for (const auto& [_, file] : files) {
+        file->write_header();
+        file->flush();
+    }
+}
+
+auto BufferPool::discard_file(const std::string& path) -> void {
+    std::lock_guard lock(mutex);
+    for (size_t i = 0; i < frames.size(); i++) {
+        auto& frame = frames[i];
+        if (!frame.in_use || frame.path != path) {
+            continue;
+        }
+        if (frame.pin_count > 0) {
+            throw std::runtime_error("Cannot discard pinned page of " + path);
+        }
+
+        page_table.erase(page_key(frame.path, frame.page_id));
+        // Back to an unused frame; the page buffer is kept.
+        Frame unused;
+        unused.data = std::move(frame.data);
+        frame = std::move(unused);
+    }
+    files.erase(path);
+}
+
+auto BufferPool::unpin(size_t frame, bool dirty) -> void {
+    std::lock_guard lock(mutex);
+    frames[frame].pin_count--;
+    frames[frame].dirty |= dirty;
+}
+
+auto BufferPool::open_file(const std::string& path) -> PageFile& {
+    auto& file = files[path];
+    if (!file) {
+        file = std::make_unique<PageFile>(path);
+    }
+    return *file;
+}
+
+auto BufferPool::acquire_frame() -> size_t {
+    // Two sweeps: the first one may only clear reference bits.
+    for (size_t step = 0; step < 2 * frames.size(); step++) {
+        const auto index = clock_hand;
+        clock_hand = (clock_hand + 1) % frames.size();
+        auto& frame = frames[index];
+
+        if (!frame.in_use) {
+            return index;
+        }
+        if (frame.pin_count > 0) {
+            continue;
+        }
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+
+        if (frame.dirty) {
+            write_back(frame);
+        }
+        page_table.erase(page_key(frame.path, frame.page_id));
+        frame.in_use = false;
+        return index;
+    }
+
+    throw std::runtime_error("Buffer pool exhausted: all pages are pinned");
+}
+
+auto BufferPool::write_back(Frame& frame) -> void {
+    open_file(frame.path).write_page(frame.page_id, frame.data.data());
+    frame.dirty = false;
+}
+
+auto BufferPool::background_writer() -> void {
+    std::unique_lock lock(mutex);
+    while (!stopping) {
+        writer_signal.wait_for(lock, writer_interval, [this] { return stopping; });
+        if (stopping) {
+            break;
+        }
+
+        try {
+            for (auto& frame : frames) {
+                if (frame.in_use && frame.dirty && frame.pin_count == 0) {
+                    write_back(frame);
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: Background page writer failed: " << e.what() << "\n";
+        }
+    }
+}
+
+auto BufferPool::page_key(const std::string& path, uint32_t page_id) -> std::string {
+    return path + "#" + std::to_string(page_id);
+}
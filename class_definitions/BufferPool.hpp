@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "class_definitions/PageFile.hpp"
+
+class BufferPool;
+
+// Pinned page. The frame cannot be evicted while a handle to it exists.
+class PageHandle {
+    BufferPool* pool = nullptr;
+    size_t frame = 0;
+    char* page_data = nullptr;
+    bool dirty = false;
+
+public:
+    PageHandle() = default;
+    PageHandle(BufferPool* owner, size_t frame_index, char* data) : pool(owner), frame(frame_index), page_data(data) {}
+    PageHandle(PageHandle&& other) noexcept;
+    PageHandle& operator=(PageHandle&& other) noexcept;
+    PageHandle(const PageHandle&) = delete;
+    PageHandle& operator=(const PageHandle&) = delete;
+    ~PageHandle();
+
+    [[nodiscard]] auto data() const -> char* { return page_data; }
+    auto mark_dirty() -> void { dirty = true; }
+    auto release() -> void;
+};
+
+// Fixed number of page frames shared by all table files. Pages are replaced
+// with the clock algorithm; dirty pages are written back on eviction, on
+// flush and by a background writer thread.
+class BufferPool {
+    struct Frame {
+        std::vector<char> data;
+        std::string path;
+        uint32_t page_id = 0;
+        bool in_use = false;
+        bool dirty = false;
+        bool referenced = false;
+        int pin_count = 0;
+    };
+
+    std::vector<Frame> frames;
+    std::unordered_map<std::string, size_t> page_table; // path#page -> frame
+    std::unordered_map<std::string, std::unique_ptr<PageFile>> files;
+    size_t clock_hand = 0;
+    std::mutex mutex;
+
+    std::thread writer;
+    std::condition_variable writer_signal;
+    std::chrono::milliseconds writer_interval;
+    bool stopping = false;
+
+public:
+    static constexpr size_t DEFAULT_FRAME_COUNT = 4096;
+
+    explicit BufferPool(size_t frame_count = DEFAULT_FRAME_COUNT,
+                        std::chrono::milliseconds background_interval = std::chrono::milliseconds(200));
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    [[nodiscard]] auto fetch_page(const std::string& path, uint32_t page_id) -> PageHandle;
+    // Appends a fresh, initialised data page to the file and returns it pinned.
+    [[nodiscard]] auto new_page(const std::string& path) -> std::pair<uint32_t, PageHandle>;
+    [[nodiscard]] auto header(const std::string& path) -> PageFileHeader;
+    auto set_row_count(const std::string& path, uint64_t row_count) -> void;
+    auto set_lsn(const std::string& path, uint64_t lsn) -> void;
+    // Writes only the header page, ahead of any buffered data pages.
+    auto write_header(const std::string& path) -> void;
+
+    // Writes dirty pages and the header of one file to disk.
+    auto flush_file(const std::string& path) -> void;
+    auto flush_all() -> void;
+    // Forgets every cached page of a file that was replaced or deleted on disk.
+    auto discard_file(const std::string& path) -> void;
+
+    [[nodiscard]] auto frame_count() const -> size_t { return frames.size(); }
+
+private:
+    friend class PageHandle;
+    auto unpin(size_t frame, bool dirty) -> void;
+    auto open_file(const std::string& path) -> PageFile&;
+    auto acquire_frame() -> size_t;
+    auto write_back(Frame& frame) -> void;
+    auto background_writer() -> void;
+    static auto page_key(const std::string& path, uint32_t page_id) -> std::string;
+};
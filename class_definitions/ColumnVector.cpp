@@ -0,0 +1,252 @@
+#include "ColumnVector.hpp"
+#include "Table.hpp"
+#include "FilterKernels.hpp"
+#include "Predicate.hpp"
+
+#include <charconv>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+    // One tight loop per operator, so the comparison is inlined instead of
+    // being switched on for every row.
+    auto scan_text(const ColumnVector& column, size_t first, size_t count, WhereOperator op,
+                   std::string_view literal, std::vector<uint64_t>& selection) -> void {
+        const auto run = [&](auto compare) {
+            for (size_t i = 0; i < count; i++) {
+                selection[i / 64] |= static_cast<uint64_t>(compare(column.text_at(first + i), literal)) << (i % 64);
+            }
+        };
+
+        switch (op) {
+            case WhereOperator::EQUALS: run(std::equal_to<>()); break;
+            case WhereOperator::GREATER: run(std::greater<>()); break;
+            case WhereOperator::LESS: run(std::less<>()); break;
+            case WhereOperator::GREATER_EQ: run(std::greater_equal<>()); break;
+            case WhereOperator::LESS_EQ: run(std::less_equal<>()); break;
+        }
+    }
+}
+
+auto ColumnVector::set_bit(std::vector<uint64_t>& bits, size_t index, bool value) -> void {
+    if (index / 64 >= bits.size()) {
+        bits.resize(index / 64 + 1, 0);
+    }
+    const auto mask = uint64_t{1} << (index % 64);
+    bits[index / 64] = value ? bits[index / 64] | mask : bits[index / 64] & ~mask;
+}
+
+auto ColumnVector::push_slot(bool valid) -> void {
+    set_bit(validity, count, valid);
+    switch (type) {
+        case ColumnType::INTEGER: integers.push_back(0); break;
+        case ColumnType::BOOLEAN: set_bit(booleans, count, false); break;
+        case ColumnType::TEXT: text_offsets.push_back(text_bytes.size()); break;
+    }
+    count++;
+}
+
+auto ColumnVector::append(std::string_view value) -> void {
+    switch (type) {
+        case ColumnType::INTEGER: append_integer(parse_integer(value)); break;
+        case ColumnType::BOOLEAN: append_boolean(parse_boolean(value)); break;
+        case ColumnType::TEXT: append_text(value); break;
+    }
+}
+
+auto ColumnVector::append_null() -> void {
+    push_slot(false);
+}
+
+auto ColumnVector::append_integer(int64_t value) -> void {
+    push_slot(true);
+    integers.back() = value;
+}
+
+auto ColumnVector::append_boolean(bool value) -> void {
+    push_slot(true);
+    set_bit(booleans, count - 1, value);
+}
+
+auto ColumnVector::append_text(std::string_view value) -> void {
+    text_bytes.append(value);
+    push_slot(true);
+}
+
+auto ColumnVector::extend(const ColumnVector& other) -> void {
+    if (other.type != type) {
+        throw std::runtime_error("Cannot append a column of another type");
+    }
+    if (count % 64 == 0) {
+        // Word-aligned: the bitmaps can be appended whole.
+        validity.resize(count / 64);
+        validity.insert(validity.end(), other.validity.begin(), other.validity.end());
+        if (type == ColumnType::BOOLEAN) {
+            booleans.resize(count / 64);
+            booleans.insert(booleans.end(), other.booleans.begin(), other.booleans.end());
+        }
+    } else {
+        for (size_t i = 0; i < other.count; i++) {
+            set_bit(validity, count + i, get_bit(other.validity, i));
+            if (type == ColumnType::BOOLEAN) {
+                set_bit(booleans, count + i, get_bit(other.booleans, i));
+            }
+        }
+    }
+
+    switch (type) {
+        case ColumnType::INTEGER:
+            integers.insert(integers.end(), other.integers.begin(), other.integers.end());
+            break;
+        case ColumnType::TEXT: {
+            const auto base = text_bytes.size();
+            text_bytes.append(other.text_bytes);
+            text_offsets.reserve(text_offsets.size() + other.count);
+            for (size_t i = 1; i <= other.count; i++) {
+                text_offsets.push_back(base + other.text_offsets[i]);
+            }
+            break;
+        }
+        case ColumnType::BOOLEAN:
+            break;
+    }
+    count += other.count;
+}
+
+auto ColumnVector::set(size_t row, std::string_view value) -> void {
+    switch (type) {
+        case ColumnType::INTEGER:
+            integers[row] = parse_integer(value);
+            break;
+        case ColumnType::BOOLEAN:
+            set_bit(booleans, row, parse_boolean(value));
+            break;
+        case ColumnType::TEXT: {
+            // Splice the new bytes in and shift the offsets of the following rows.
+            const auto begin = text_offsets[row];
+            const auto old_size = text_offsets[row + 1] - begin;
+            text_bytes.replace(begin, old_size, value);
+            const auto delta = static_cast<int64_t>(value.size()) - static_cast<int64_t>(old_size);
+            if (delta != 0) {
+                for (auto i = row + 1; i < text_offsets.size(); i++) {
+                    text_offsets[i] = static_cast<uint64_t>(static_cast<int64_t>(text_offsets[i]) + delta);
+                }
+            }
+            break;
+        }
+    }
+    set_bit(validity, row, true);
+}
+
+auto ColumnVector::to_string(size_t row) const -> std::string {
+    switch (type) {
+        case ColumnType::INTEGER: return std::to_string(integer_at(row));
+        case ColumnType::BOOLEAN: return boolean_at(row) ? "TRUE" : "FALSE";
+        case ColumnType::TEXT: return std::string(text_at(row));
+    }
+    return {};
+}
+
+auto ColumnVector::select(WhereOperator op, const PredicateLiteral& literal, size_t first, size_t rows) const
+    -> std::vector<uint64_t> {
+    if (first % 64 != 0 || first + rows > count) {
+        throw std::out_of_range("Invalid row range for a column scan");
+    }
+
+    std::vector<uint64_t> selection(FilterKernels::words_for(rows), 0);
+    const auto first_word = first / 64;
+    switch (type) {
+        case ColumnType::INTEGER:
+            FilterKernels::compare_integers(integers.data() + first, rows, op, literal.integer, selection.data());
+            break;
+        case ColumnType::BOOLEAN:
+            FilterKernels::compare_booleans(booleans.data() + first_word, rows, op, literal.boolean, selection.data());
+            break;
+        case ColumnType::TEXT:
+            scan_text(*this, first, rows, op, literal.text, selection);
+            break;
+    }
+    // NULL slots hold a zero / empty value that may have matched.
+    FilterKernels::and_into(selection.data(), validity.data() + first_word, selection.size());
+    return selection;
+}
+
+auto ColumnVector::append_from(const ColumnVector& other, size_t row) -> void {
+    if (other.is_null(row)) {
+        append_null();
+        return;
+    }
+    switch (type) {
+        case ColumnType::INTEGER: append_integer(other.integer_at(row)); break;
+        case ColumnType::BOOLEAN: append_boolean(other.boolean_at(row)); break;
+        // Copied first: the view may point into our own buffer.
+        case ColumnType::TEXT: append_text(std::string(other.text_at(row))); break;
+    }
+}
+
+auto ColumnVector::retain(const std::vector<uint8_t>& keep) -> void {
+    size_t kept = 0;
+    std::string kept_bytes;
+    std::vector<uint64_t> kept_offsets{0};
+
+    for (size_t i = 0; i < count; i++) {
+        if (!keep[i]) {
+            continue;
+        }
+
+        set_bit(validity, kept, get_bit(validity, i));
+        switch (type) {
+            case ColumnType::INTEGER: integers[kept] = integers[i]; break;
+            case ColumnType::BOOLEAN: set_bit(booleans, kept, get_bit(booleans, i)); break;
+            case ColumnType::TEXT:
+                kept_bytes.append(text_at(i));
+                kept_offsets.push_back(kept_bytes.size());
+                break;
+        }
+        kept++;
+    }
+
+    count = kept;
+    validity.resize((count + 63) / 64);
+    switch (type) {
+        case ColumnType::INTEGER: integers.resize(count); break;
+        case ColumnType::BOOLEAN: booleans.resize((count + 63) / 64); break;
+        case ColumnType::TEXT:
+            text_bytes = std::move(kept_bytes);
+            text_offsets = std::move(kept_offsets);
+            break;
+    }
+}
+
+auto ColumnVector::clear() -> void {
+    count = 0;
+    validity.clear();
+    integers.clear();
+    booleans.clear();
+    text_offsets.assign(1, 0);
+    text_bytes.clear();
+}
+
+auto ColumnVector::memory_usage() const -> size_t {
+    return sizeof(ColumnVector)
+        + validity.capacity() * sizeof(uint64_t)
+        + integers.capacity() * sizeof(int64_t)
+        + booleans.capacity() * sizeof(uint64_t)
+        + text_offsets.capacity() * sizeof(uint64_t)
+        + text_bytes.capacity();
+}
+
+auto ColumnVector::parse_integer(std::string_view value) -> int64_t {
+    int64_t result = 0;
+    const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+        throw std::runtime_error("Invalid INTEGER value: " + std::string(value));
+    }
+    return result;
+}
+
+auto ColumnVector::parse_boolean(std::string_view value) -> bool {
+    if (value == "TRUE" || value == "true" || value == "1") return true;
+    if (value == "FALSE" || value == "false" || value == "0") return false;
+    throw std::runtime_error("Invalid BOOLEAN value: " + std::string(value));
+}
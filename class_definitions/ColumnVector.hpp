@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "types/enums.hpp"
+
+enum class WhereOperator;
+struct PredicateLiteral;
+
+// Values of one table column, stored contiguously by type:
+//   INTEGER -> int64 per row
+//   BOOLEAN -> one bit per row
+//   TEXT    -> all bytes in one buffer, row i spans [offsets[i], offsets[i + 1])
+// A validity bitmap marks which rows hold a value; NULL rows keep a zero /
+// empty slot so positions stay aligned across columns.
+class ColumnVector {
+    ColumnType type;
+    size_t count = 0;
+    std::vector<uint64_t> validity;
+    std::vector<int64_t> integers;
+    std::vector<uint64_t> booleans;
+    std::vector<uint64_t> text_offsets{0};
+    std::string text_bytes;
+
+    static auto get_bit(const std::vector<uint64_t>& bits, size_t index) -> bool {
+        return bits[index / 64] >> (index % 64) & 1;
+    }
+    static auto set_bit(std::vector<uint64_t>& bits, size_t index, bool value) -> void;
+    auto push_slot(bool valid) -> void;
+
+public:
+    explicit ColumnVector(ColumnType column_type) : type(column_type) {}
+
+    [[nodiscard]] auto get_type() const -> ColumnType { return type; }
+    [[nodiscard]] auto size() const -> size_t { return count; }
+
+    // Parses `value` according to the column type; throws on invalid input.
+    auto append(std::string_view value) -> void;
+    auto append_null() -> void;
+    auto append_integer(int64_t value) -> void;
+    auto append_boolean(bool value) -> void;
+    auto append_text(std::string_view value) -> void;
+    auto set(size_t row, std::string_view value) -> void;
+    // Appends every row of `other`, which must have the same type.
+    auto extend(const ColumnVector& other) -> void;
+    // Appends row `row` of `other` (same type, possibly this column).
+    auto append_from(const ColumnVector& other, size_t row) -> void;
+
+    [[nodiscard]] auto is_null(size_t row) const -> bool { return !get_bit(validity, row); }
+    [[nodiscard]] auto integer_at(size_t row) const -> int64_t { return integers[row]; }
+    [[nodiscard]] auto boolean_at(size_t row) const -> bool { return get_bit(booleans, row); }
+    [[nodiscard]] auto text_at(size_t row) const -> std::string_view {
+        return std::string_view(text_bytes).substr(text_offsets[row], text_offsets[row + 1] - text_offsets[row]);
+    }
+    // Text form of a non-NULL value, as shown to users.
+    [[nodiscard]] auto to_string(size_t row) const -> std::string;
+
+    // Selection bitmap of the rows in [first, first + rows) satisfying
+    // `value <op> literal` (NULL never does): bit i of word i / 64 is row
+    // first + i. `first` must be a multiple of 64. INTEGER and BOOLEAN
+    // columns go through FilterKernels.
+    [[nodiscard]] auto select(WhereOperator op, const PredicateLiteral& literal, size_t first, size_t rows) const
+        -> std::vector<uint64_t>;
+
+    // Keeps only the rows with keep[i] != 0, preserving their order.
+    auto retain(const std::vector<uint8_t>& keep) -> void;
+    auto clear() -> void;
+
+    [[nodiscard]] auto memory_usage() const -> size_t;
+
+    [[nodiscard]] static auto parse_integer(std::string_view value) -> int64_t;
+    [[nodiscard]] static auto parse_boolean(std::string_view value) -> bool;
+};
@@ -0,0 +1,153 @@
+#include "CsvReader.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+auto CsvReader::parse_line(const std::vector<Column>& columns, std::string_view line, std::vector<ColumnVector>& data,
+                           std::vector<Field>& fields) -> void {
+    // Split first, so that a row with the wrong field count is reported as
+    // such rather than as a bad value.
+    size_t field_count = 0;
+    size_t pos = 0;
+    while (true) {
+        if (field_count == columns.size()) {
+            throw std::runtime_error("Expected " + std::to_string(columns.size()) + " fields");
+        }
+        auto& field = fields[field_count++];
+        field.text.clear();
+        field.quoted = pos < line.size() && line[pos] == '"';
+        if (field.quoted) {
+            for (pos++;; pos++) {
+                if (pos >= line.size()) {
+                    throw std::runtime_error("Unterminated quoted field");
+                }
+                if (line[pos] == '"') {
+                    if (pos + 1 < line.size() && line[pos + 1] == '"') {
+                        field.text.push_back('"');
+                        pos++;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                field.text.push_back(line[pos]);
+            }
+            if (pos < line.size() && line[pos] != ',') {
+                throw std::runtime_error("Unexpected character after a quoted field");
+            }
+        } else {
+            const auto end = std::min(line.find(',', pos), line.size());
+            field.text.assign(line.substr(pos, end - pos));
+            pos = end;
+        }
+        if (pos >= line.size()) {
+            break;
+        }
+        pos++; // the comma
+    }
+    if (field_count != columns.size()) {
+        throw std::runtime_error("Expected " + std::to_string(columns.size()) + " fields");
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto& [text, quoted] = fields[i];
+        if (text.empty() && !quoted) {
+            data[i].append_null();
+            continue;
+        }
+        switch (columns[i].type) {
+            case ColumnType::INTEGER: {
+                int64_t value = 0;
+                const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+                if (error != std::errc() || end != text.data() + text.size()) {
+                    throw std::runtime_error("Invalid value for column " + columns[i].name + ": " + text);
+                }
+                data[i].append_integer(value);
+                break;
+            }
+            case ColumnType::BOOLEAN:
+                if (!Table::validate_value(text, ColumnType::BOOLEAN)) {
+                    throw std::runtime_error("Invalid value for column " + columns[i].name + ": " + text);
+                }
+                data[i].append_boolean(ColumnVector::parse_boolean(text));
+                break;
+            case ColumnType::TEXT:
+                data[i].append_text(text);
+                break;
+        }
+    }
+}
+
+auto CsvReader::parse_chunk(const std::vector<Column>& columns, Chunk& chunk) -> void {
+    for (const auto& column : columns) {
+        chunk.data.emplace_back(column.type);
+    }
+    std::vector<Field> fields(columns.size());
+
+    auto text = chunk.text;
+    while (!text.empty()) {
+        const auto end = std::min(text.find('\n'), text.size());
+        auto line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        chunk.lines++;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            parse_line(columns, line, chunk.data, fields);
+        }
+        catch (const std::runtime_error& e) {
+            chunk.error_line = chunk.lines;
+            chunk.error = e.what();
+            return;
+        }
+    }
+}
+
+auto CsvReader::read(std::string_view text, const std::string& source, const Table& schema, bool skip_header)
+    -> Table {
+    size_t header_lines = 0;
+    if (skip_header && !text.empty()) {
+        text.remove_prefix(std::min(text.find('\n'), text.size() - 1) + 1);
+        header_lines = 1;
+    }
+
+    // Chunks end just after a newline, so no line is split.
+    const auto chunk_count =
+        std::clamp<size_t>(text.size() / MIN_CHUNK_BYTES, 1, WorkerPool::shared().get_max_parallelism());
+    std::vector<Chunk> chunks(chunk_count);
+    size_t begin = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        auto end = i + 1 == chunk_count ? text.size() : std::max(begin, text.size() * (i + 1) / chunk_count);
+        end = std::min(text.find('\n', end), text.size());
+        end = std::min(end + 1, text.size());
+        chunks[i].text = text.substr(begin, end - begin);
+        begin = end;
+    }
+
+    const auto& columns = schema.get_columns();
+    WorkerPool::shared().run(chunk_count, [&](size_t chunk) { parse_chunk(columns, chunks[chunk]); });
+
+    auto line = header_lines;
+    for (const auto& chunk : chunks) {
+        if (chunk.error_line != 0) {
+            throw std::runtime_error(source + ":" + std::to_string(line + chunk.error_line) + ": " + chunk.error);
+        }
+        line += chunk.lines;
+    }
+
+    auto data = std::move(chunks[0].data);
+    for (size_t i = 1; i < chunk_count; i++) {
+        for (size_t column = 0; column < data.size(); column++) {
+            data[column].extend(chunks[i].data[column]);
+        }
+        chunks[i].data.clear();
+    }
+    return Table(schema.get_name(), columns, std::move(data));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "class_definitions/Table.hpp"
+
+// Reads a CSV file into typed columns for COPY. One line per row and one
+// field per column, separated by commas. A field may be double-quoted to hold
+// commas, with "" for a quote; an empty unquoted field is NULL. Quoted fields
+// cannot span lines, so the file can be cut into chunks at any newline: the
+// chunks are parsed on the shared WorkerPool, at most one per thread a query
+// may use (numbers with std::from_chars), and concatenated in file order.
+class CsvReader {
+    // Below this many bytes per thread a file is not worth splitting further.
+    static constexpr size_t MIN_CHUNK_BYTES = 1024 * 1024;
+
+    struct Field {
+        std::string text;
+        bool quoted = false; // "" is empty text, an empty unquoted field NULL
+    };
+
+    struct Chunk {
+        std::string_view text;
+        std::vector<ColumnVector> data;
+        size_t lines = 0;
+        // First invalid line within the chunk, counted from 1; 0 when none.
+        size_t error_line = 0;
+        std::string error;
+    };
+
+    static auto parse_chunk(const std::vector<Column>& columns, Chunk& chunk) -> void;
+    static auto parse_line(const std::vector<Column>& columns, std::string_view line, std::vector<ColumnVector>& data,
+                           std::vector<Field>& fields) -> void;
+
+public:
+    // Rows of the CSV `text` as a table with the columns of `schema`. NOT
+    // NULL and primary keys are left to Table::check_rows(). Throws with
+    // `source` and the line of the first invalid row.
+    [[nodiscard]] static auto read(std::string_view text, const std::string& source, const Table& schema,
+                                   bool skip_header) -> Table;
+};
@@ -0,0 +1,313 @@
+#include "Cursor.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    auto mix(uint64_t value) -> uint64_t {
+        // splitmix64 finaliser, as in HashIndex.
+        value += 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    auto project_columns(const std::vector<Column>& columns, const std::vector<size_t>& selected) -> std::vector<Column> {
+        std::vector<Column> output;
+        output.reserve(selected.size());
+        for (const auto column : selected) {
+            output.push_back(columns.at(column));
+        }
+        return output;
+    }
+}
+
+auto Value::to_string(ColumnType type) const -> std::string {
+    if (is_null) {
+        return {};
+    }
+    switch (type) {
+        case ColumnType::INTEGER: return std::to_string(integer);
+        case ColumnType::BOOLEAN: return integer != 0 ? "TRUE" : "FALSE";
+        case ColumnType::TEXT: return text;
+    }
+    return {};
+}
+
+auto Value::compare(const Value& other, ColumnType type) const -> int {
+    if (is_null || other.is_null) {
+        return is_null - other.is_null;
+    }
+    if (type == ColumnType::TEXT) {
+        const auto order = text.compare(other.text);
+        return order < 0 ? -1 : order > 0;
+    }
+    return integer < other.integer ? -1 : integer > other.integer;
+}
+
+auto Value::hash(ColumnType type) const -> uint64_t {
+    if (is_null) {
+        return mix(UINT64_MAX);
+    }
+    if (type == ColumnType::TEXT) {
+        return mix(std::hash<std::string>{}(text));
+    }
+    return mix(static_cast<uint64_t>(integer));
+}
+
+auto ValuesCursor::next(Tuple& row) -> bool {
+    if (position >= rows.size()) {
+        return false;
+    }
+    row = rows[position++];
+    return true;
+}
+
+auto LimitCursor::next(Tuple& row) -> bool {
+    for (; skip > 0; skip--) {
+        if (!input->next(row)) {
+            return false;
+        }
+    }
+    if (remaining == 0 || !input->next(row)) {
+        return false;
+    }
+    remaining--;
+    return true;
+}
+
+TableCursor::TableCursor(std::shared_ptr<const Table> source, std::vector<size_t> columns,
+                         std::optional<Predicate> predicate, const Snapshot& snapshot, const RowLimit& limit)
+    : table(std::move(source)),
+      selected(std::move(columns)),
+      output(project_columns(table->get_columns(), selected)),
+      where(std::move(predicate)),
+      snapshot(snapshot),
+      skip(limit.offset),
+      remaining(limit.count),
+      batch_rows(Table::first_scan_batch(limit.end())) {
+    table->begin_scan();
+    const auto lock = table->read_latch();
+    scan_end = table->get_row_count();
+    if (where) {
+        lookup = table->lookup_rows(*where, snapshot, limit.end());
+    } else if (table->sees_all_rows(snapshot)) {
+        // Every row matches: the offset is a row position.
+        next_batch = std::min(skip, scan_end);
+        skip = 0;
+    }
+}
+
+TableCursor::~TableCursor() {
+    table->end_scan();
+}
+
+auto TableCursor::fill(size_t row, Tuple& out) const -> void {
+    out.resize(selected.size());
+    for (size_t i = 0; i < selected.size(); i++) {
+        const auto& data = table->get_column_data(selected[i]);
+        auto& value = out[i];
+        value.is_null = data.is_null(row);
+        if (value.is_null) {
+            continue;
+        }
+        switch (data.get_type()) {
+            case ColumnType::INTEGER: value.integer = data.integer_at(row); break;
+            case ColumnType::BOOLEAN: value.integer = data.boolean_at(row); break;
+            case ColumnType::TEXT: value.text.assign(data.text_at(row)); break;
+        }
+    }
+}
+
+auto TableCursor::load_batch() -> bool {
+    if (next_batch >= scan_end) {
+        return false;
+    }
+
+    const auto first = next_batch;
+    const auto rows = std::min(batch_rows, scan_end - first);
+    next_batch = first + rows;
+    batch_rows = std::min(batch_rows * 2, Table::max_scan_batch());
+
+    const auto lock = table->read_latch();
+    project_batch(first, table->select_rows(where ? &*where : nullptr, snapshot, first, rows));
+    return true;
+}
+
+auto TableCursor::project_batch(size_t first, const std::vector<uint64_t>& batch) -> void {
+    // Each morsel first learns which of its matches to skip (OFFSET) and how
+    // many to keep (LIMIT), and where in the output they go.
+    constexpr auto MORSEL_WORDS = Table::MORSEL_ROWS / 64;
+    const auto morsels = (batch.size() + MORSEL_WORDS - 1) / MORSEL_WORDS;
+    struct Slice {
+        size_t skip = 0;
+        size_t take = 0;
+        size_t output = 0;
+    };
+    std::vector<Slice> slices(morsels);
+    size_t total = 0;
+    for (size_t morsel = 0; morsel < morsels; morsel++) {
+        size_t matches = 0;
+        const auto end = std::min(batch.size(), (morsel + 1) * MORSEL_WORDS);
+        for (auto word = morsel * MORSEL_WORDS; word < end; word++) {
+            matches += static_cast<size_t>(std::popcount(batch[word]));
+        }
+        auto& slice = slices[morsel];
+        slice.skip = std::min(skip, matches);
+        skip -= slice.skip;
+        slice.take = std::min(matches - slice.skip, remaining - total);
+        slice.output = total;
+        total += slice.take;
+    }
+
+    projected.resize(total);
+    projected_position = 0;
+    WorkerPool::shared().run(morsels, [&](size_t morsel) {
+        auto [to_skip, to_take, output] = slices[morsel];
+        const auto end = std::min(batch.size(), (morsel + 1) * MORSEL_WORDS);
+        for (auto word = morsel * MORSEL_WORDS; word < end && to_take > 0; word++) {
+            for (auto bits = batch[word]; bits != 0 && to_take > 0; bits &= bits - 1) {
+                if (to_skip > 0) {
+                    to_skip--;
+                    continue;
+                }
+                fill(first + word * 64 + static_cast<size_t>(std::countr_zero(bits)), projected[output++]);
+                to_take--;
+            }
+        }
+    });
+}
+
+auto TableCursor::next(Tuple& row) -> bool {
+    if (remaining == 0) {
+        return false;
+    }
+
+    if (lookup) {
+        lookup_position += std::exchange(skip, 0);
+        if (lookup_position >= lookup->size()) {
+            return false;
+        }
+        const auto lock = table->read_latch();
+        fill((*lookup)[lookup_position++], row);
+        remaining--;
+        return true;
+    }
+
+    while (projected_position >= projected.size()) {
+        if (!load_batch()) {
+            return false;
+        }
+    }
+    row = std::move(projected[projected_position++]);
+    remaining--;
+    return true;
+}
+
+PageCursor::PageCursor(BufferPool& buffer_pool, std::string data_path, std::vector<Column> columns,
+                       std::vector<size_t> projection, std::optional<Predicate> predicate, const RowLimit& limit)
+    : schema(std::move(columns)),
+      selected(std::move(projection)),
+      output(project_columns(schema, selected)),
+      where(std::move(predicate)),
+      skip(limit.offset),
+      remaining(limit.count),
+      pool(&buffer_pool),
+      path(std::move(data_path)),
+      header(pool->header(path)),
+      view(schema) {
+    if (header.schema_id != PageFile::schema_id(schema)) {
+        throw std::runtime_error("Data file does not match the schema: " + path);
+    }
+}
+
+PageCursor::PageCursor(std::unique_ptr<MappedFile> file, std::vector<Column> columns,
+                       std::vector<size_t> projection, std::optional<Predicate> predicate, const RowLimit& limit)
+    : schema(std::move(columns)),
+      selected(std::move(projection)),
+      output(project_columns(schema, selected)),
+      where(std::move(predicate)),
+      skip(limit.offset),
+      remaining(limit.count),
+      mapped(std::move(file)),
+      header(PageFile::parse_header(mapped->data(), mapped->size())),
+      view(schema) {
+    if (header.schema_id != PageFile::schema_id(schema)) {
+        throw std::runtime_error("Data file does not match the schema");
+    }
+    if (static_cast<size_t>(header.page_count) * header.page_size > mapped->size()) {
+        throw std::runtime_error("Data file is truncated");
+    }
+    mapped->advise(MappedFile::AccessHint::SEQUENTIAL);
+    mapped->advise(MappedFile::AccessHint::WILLNEED);
+}
+
+auto PageCursor::load_page() -> bool {
+    // Skips empty pages; the previous page is unpinned by the assignment.
+    while (pages ? next_page < pages->size() : page_id + 1 < header.page_count) {
+        page_id = pages ? (*pages)[next_page++] : page_id + 1;
+        const char* data;
+        if (mapped) {
+            data = mapped->data() + static_cast<size_t>(page_id) * header.page_size;
+        } else {
+            page = pool->fetch_page(path, page_id);
+            data = page.data();
+        }
+
+        const DataPageView data_page(data);
+        rows_left = data_page.row_count();
+        position = data_page.rows_begin();
+        if (!where && skip >= rows_left) {
+            skip -= rows_left;
+            continue;
+        }
+        if (rows_left > 0) {
+            return true;
+        }
+    }
+    page.release();
+    return false;
+}
+
+auto PageCursor::next(Tuple& row) -> bool {
+    while (true) {
+        if (remaining == 0) {
+            page.release();
+            return false;
+        }
+        if (rows_left == 0 && !load_page()) {
+            return false;
+        }
+
+        rows_left--;
+        view.reset(position);
+        if (where && !where->matches(view)) {
+            continue;
+        }
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        remaining--;
+
+        row.resize(selected.size());
+        for (size_t i = 0; i < selected.size(); i++) {
+            const auto column = selected[i];
+            auto& value = row[i];
+            value.is_null = view.is_null(column);
+            if (value.is_null) {
+                continue;
+            }
+            switch (schema[column].type) {
+                case ColumnType::INTEGER: value.integer = view.as_integer(column); break;
+                case ColumnType::BOOLEAN: value.integer = view.as_boolean(column); break;
+                case ColumnType::TEXT: value.text.assign(view.as_text(column)); break;
+            }
+        }
+        return true;
+    }
+}
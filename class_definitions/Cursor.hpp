@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "class_definitions/BufferPool.hpp"
+#include "class_definitions/MappedFile.hpp"
+#include "class_definitions/PageFile.hpp"
+#include "class_definitions/Predicate.hpp"
+
+// One value of a result row. INTEGER and BOOLEAN (0 / 1) use `integer`,
+// TEXT uses `text`.
+struct Value {
+    bool is_null = true;
+    int64_t integer = 0;
+    std::string text;
+
+    // Text form as shown to users; empty for NULL.
+    [[nodiscard]] auto to_string(ColumnType type) const -> std::string;
+    // <0, 0 or >0 like strcmp. INTEGER and BOOLEAN compare numerically, TEXT
+    // byte-wise; NULL equals NULL and sorts after every value.
+    [[nodiscard]] auto compare(const Value& other, ColumnType type) const -> int;
+    // Equal values (compare() == 0) hash equally.
+    [[nodiscard]] auto hash(ColumnType type) const -> uint64_t;
+};
+
+using Tuple = std::vector<Value>;
+
+// Pull-based query operator. Each next() produces one row, so a consumer
+// holds only the rows it is working on and can stop at any time. Operators
+// take their input as another Cursor.
+class Cursor {
+public:
+    virtual ~Cursor() = default;
+
+    // Names and types of the values next() produces, in order.
+    [[nodiscard]] virtual auto get_columns() const -> const std::vector<Column>& = 0;
+    // Overwrites `row` with the next row; false once the input is exhausted.
+    virtual auto next(Tuple& row) -> bool = 0;
+};
+
+// Rows already in memory, e.g. a result computed without scanning.
+class ValuesCursor : public Cursor {
+    std::vector<Column> columns;
+    std::vector<Tuple> rows;
+    size_t position = 0;
+
+public:
+    ValuesCursor(std::vector<Column> row_columns, std::vector<Tuple> row_values)
+        : columns(std::move(row_columns)), rows(std::move(row_values)) {}
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return columns; }
+    auto next(Tuple& row) -> bool override;
+};
+
+// LIMIT / OFFSET over a cursor whose scan could not take the limit itself.
+class LimitCursor : public Cursor {
+    std::unique_ptr<Cursor> input;
+    size_t skip;
+    size_t remaining;
+
+public:
+    LimitCursor(std::unique_ptr<Cursor> source, const RowLimit& limit)
+        : input(std::move(source)), skip(limit.offset), remaining(limit.count) {}
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return input->get_columns(); }
+    auto next(Tuple& row) -> bool override;
+};
+
+// Scan of a resident table, as seen by one snapshot. The predicate is
+// evaluated one batch of rows at a time with the filter kernels; when the
+// primary key or an index answers it (Table::lookup_rows) only those rows are
+// visited. A row limit sizes the batches (Table::first_scan_batch) and ends
+// the scan once it is met. Batches of several morsels are filtered in
+// parallel (Table::select_rows), and then the rows the limit lets through are
+// projected in parallel, each morsel into its own slice of the output, so
+// they stay in table order. The table latch is held only while one batch is
+// filtered and projected; rows added after the scan opened are never seen.
+class TableCursor : public Cursor {
+    std::shared_ptr<const Table> table;
+    std::vector<size_t> selected;
+    std::vector<Column> output;
+    std::optional<Predicate> where;
+    Snapshot snapshot;
+    size_t skip;      // matching rows still to pass over (OFFSET)
+    size_t remaining; // rows still to return (LIMIT)
+
+    std::optional<std::vector<size_t>> lookup; // rows from an index, if any
+    size_t lookup_position = 0;
+
+    size_t scan_end = 0;    // rows stored when the scan opened
+    size_t next_batch = 0;  // first row of the next batch
+    size_t batch_rows;      // size of the next batch
+    std::vector<Tuple> projected; // rows of the current batch
+    size_t projected_position = 0;
+
+    auto fill(size_t row, Tuple& out) const -> void;
+    auto load_batch() -> bool;
+    auto project_batch(size_t first, const std::vector<uint64_t>& batch) -> void;
+
+public:
+    TableCursor(std::shared_ptr<const Table> source, std::vector<size_t> columns, std::optional<Predicate> predicate,
+                const Snapshot& snapshot, const RowLimit& limit = {});
+    ~TableCursor() override;
+    TableCursor(const TableCursor&) = delete;
+    TableCursor& operator=(const TableCursor&) = delete;
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return output; }
+    auto next(Tuple& row) -> bool override;
+};
+
+// Scan of a table data file, page by page: through the buffer pool with one
+// page pinned at a time, or straight from a memory mapping. Rows are tested
+// on their encoded form (RowView) and only matching ones are decoded. Without
+// a predicate the OFFSET skips whole pages by their row count. An index can
+// narrow the scan to the pages holding its candidate rows.
+class PageCursor : public Cursor {
+    std::vector<Column> schema;
+    std::vector<size_t> selected;
+    std::vector<Column> output;
+    std::optional<Predicate> where;
+    size_t skip;
+    size_t remaining;
+
+    BufferPool* pool = nullptr;
+    std::string path;
+    std::unique_ptr<MappedFile> mapped;
+    PageFileHeader header;
+
+    uint32_t page_id = 0;
+    std::optional<std::vector<uint32_t>> pages; // the only pages to visit, if restricted
+    size_t next_page = 0;
+    PageHandle page;
+    const char* position = nullptr;
+    uint16_t rows_left = 0;
+    RowView view;
+
+    auto load_page() -> bool;
+
+public:
+    PageCursor(BufferPool& buffer_pool, std::string data_path, std::vector<Column> columns,
+               std::vector<size_t> projection, std::optional<Predicate> predicate, const RowLimit& limit = {});
+    PageCursor(std::unique_ptr<MappedFile> file, std::vector<Column> columns,
+               std::vector<size_t> projection, std::optional<Predicate> predicate, const RowLimit& limit = {});
+    PageCursor(const PageCursor&) = delete;
+    PageCursor& operator=(const PageCursor&) = delete;
+
+    // Visits only these data pages, in ascending order, e.g. those holding
+    // the rows an index found. Call before the first next().
+    auto restrict_to_pages(std::vector<uint32_t> page_ids) -> void { pages = std::move(page_ids); }
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return output; }
+    auto next(Tuple& row) -> bool override;
+};
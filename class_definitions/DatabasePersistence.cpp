@@ -1,7 +1,13 @@
 #include "DatabasePersistence.hpp"
+#include "BTreeIndex.hpp"
+#include "MappedFile.hpp"
+#include "PageFile.hpp"
+#include "Predicate.hpp"
 
 #include <algorithm>
+#include <ranges>
 #include <fstream>
+#include <iostream>
 #include <sstream>
 
 auto DatabasePersistence::save_table_schema(const Table& table) const -> void {
@@ -28,9 +34,6 @@ auto DatabasePersistence::save_table_schema(const Table& table) const -> void {
              << (is_nullable ? "1" : "0") << "\n";
     }
 }
-static auto to_upper(std::string& str) {
-   return  std::ranges::transform(str, str.begin(), ::toupper);
-}
 
 auto DatabasePersistence::string_to_column_type(const std::string& column_type) -> ColumnType {
     if (column_type == "INTEGER") return ColumnType::INTEGER;
@@ -55,23 +58,165 @@ auto DatabasePersistence::column_type_to_string(const ColumnType& type) -> std::
 
 
 auto DatabasePersistence::save_table_data(const Table& table) const -> void {
-    std::ofstream file(get_data_path(table.get_name()));
+    // Write the new image next to the old one and swap it in, so a failed write
+    // never leaves a half-written data file behind.
+    const auto data_path = get_data_path(table.get_name());
+    const auto temp_path = data_path + ".tmp";
+    {
+        auto page_file = PageFile::create(temp_path, table.get_columns(), table.get_lsn());
+        page_file.append_rows(table, 0);
+        page_file.sync();
+    }
+    buffer_pool.discard_file(data_path);
+    std::filesystem::rename(temp_path, data_path);
+    PageFile::sync_directory(db_directory);
+}
+
+auto DatabasePersistence::append_table_data(const Table& table, size_t first_row) const -> void {
+    const auto data_path = get_data_path(table.get_name());
+    if (!PageFile::is_page_file(data_path)) {
+        save_table_data(table);
+        return;
+    }
+
+    append_rows(data_path, table, first_row, table.get_lsn());
+}
+
+auto DatabasePersistence::append_rows(const std::string& data_path, const Table& table, size_t first_row,
+                                      uint64_t lsn) const -> void {
+    const auto row_count = table.get_row_count();
+    if (first_row >= row_count) {
+        return;
+    }
 
-    //Data schema:
+    const auto header = buffer_pool.header(data_path);
+    PageHandle page;
+    if (header.page_count > 1) {
+        page = buffer_pool.fetch_page(data_path, header.page_count - 1);
+    } else {
+        page = buffer_pool.new_page(data_path).second;
+    }
+
+    std::string encoded;
+    const auto committed = Snapshot::latest();
+    uint64_t written = 0;
+    for (auto i = first_row; i < row_count; i++) {
+        if (!table.is_visible(i, committed)) {
+            continue; // removed, or not committed yet
+        }
+        PageFile::encode_row(table, i, encoded);
+        if (encoded.size() + DataPage::HEADER_SIZE > header.page_size) {
+            throw std::runtime_error("Row does not fit into a single page");
+        }
+
+        page.mark_dirty();
+        if (!DataPage(page.data()).append(encoded, header.page_size)) {
+            page = buffer_pool.new_page(data_path).second;
+            DataPage(page.data()).append(encoded, header.page_size);
+        }
+        written++;
+    }
+    page.mark_dirty();
+    page.release();
+
+    buffer_pool.set_row_count(data_path, header.row_count + written);
+    buffer_pool.set_lsn(data_path, lsn);
+    buffer_pool.flush_file(data_path);
+}
+
+auto DatabasePersistence::read_rows(const std::string& data_path, const std::vector<Column>& columns,
+                                    const std::function<bool(Row&&)>& visitor) const -> void {
+    const auto header = buffer_pool.header(data_path);
+    for (uint32_t page_id = 1; page_id < header.page_count; page_id++) {
+        const auto page = buffer_pool.fetch_page(data_path, page_id);
+        const DataPageView data_page(page.data());
+
+        const auto* position = data_page.rows_begin();
+        for (uint16_t i = 0; i < data_page.row_count(); i++) {
+            if (!visitor(PageFile::decode_row(columns, position))) {
+                return;
+            }
+        }
+    }
+}
+
+auto DatabasePersistence::read_row_views(const std::string& data_path, const std::vector<Column>& columns,
+                                         const std::function<bool(const RowView&)>& visitor) const -> void {
+    const auto header = buffer_pool.header(data_path);
+    RowView row(columns);
+    for (uint32_t page_id = 1; page_id < header.page_count; page_id++) {
+        const auto page = buffer_pool.fetch_page(data_path, page_id);
+        const DataPageView data_page(page.data());
+
+        const auto* position = data_page.rows_begin();
+        for (uint16_t i = 0; i < data_page.row_count(); i++) {
+            row.reset(position);
+            if (!visitor(row)) {
+                return;
+            }
+        }
+    }
+}
+
+auto DatabasePersistence::load_legacy_rows(const std::string& data_path, Table& table) -> void {
+    //Legacy data schema:
     //COL_NAME=VALUE|COL_NAME=VALUE...
 
-    for (const auto&[data] : table.get_rows()) {
-        bool first = true;
-        for (const auto& [col, value] : data) {
-            if (!first) file << "|";
-            file << col << "=" << value;
-            first = false;
+    std::ifstream data_file(data_path);
+    std::string line;
+    while (std::getline(data_file, line)) {
+        Row row;
+        std::stringstream string_stream(line);
+        std::string pair;
+
+        while (std::getline(string_stream, pair, '|')) {
+            if (auto pos = pair.find('='); pos != std::string::npos) {
+                std::string col = pair.substr(0, pos);
+                std::string val = pair.substr(pos + 1);
+                row.data[col] = val;
+            }
         }
-        file << "\n";
+
+        table.insert_row(row);
     }
 }
 
+auto DatabasePersistence::convert_legacy_data(const std::string& table_name) const -> bool {
+    const auto data_path = get_data_path(table_name);
+    if (!std::filesystem::exists(data_path) || PageFile::is_page_file(data_path)) {
+        return false;
+    }
+
+    save_table_data(*load_table(table_name));
+    return true;
+}
+
 auto DatabasePersistence::load_table(const std::string& table_name) const -> std::unique_ptr<Table> {
+    auto table = load_schema(table_name);
+
+    const auto data_path = get_data_path(table_name);
+    if (!std::filesystem::exists(data_path)) {
+        return table;
+    }
+
+    if (!PageFile::is_page_file(data_path)) {
+        load_legacy_rows(data_path, *table);
+        return table;
+    }
+
+    if (buffer_pool.header(data_path).schema_id != PageFile::schema_id(table->get_columns())) {
+        throw std::runtime_error("Data file does not match the schema of table: " + table_name);
+    }
+    read_row_views(data_path, table->get_columns(), [&table](const RowView& row) {
+        table->insert_row(row);
+        return true;
+    });
+    table->set_lsn(buffer_pool.header(data_path).lsn);
+
+    return table;
+}
+
+auto DatabasePersistence::load_schema(const std::string& table_name) const -> std::unique_ptr<Table> {
     std::ifstream schema_file(get_schema_path(table_name));
     if (!schema_file.is_open()) {
         throw std::runtime_error("Table does not exist!: " + table_name);
@@ -85,7 +230,7 @@ auto DatabasePersistence::load_table(const std::string& table_name) const -> std
     std::getline(schema_file, col_count_str);
     auto col_count = std::stoul(col_count_str);
 
-    for (auto i = 0; i < col_count; i++) {
+    for (size_t i = 0; i < col_count; i++) {
         std::string line;
         if (!std::getline(schema_file, line)) {
            break;
@@ -111,29 +256,23 @@ auto DatabasePersistence::load_table(const std::string& table_name) const -> std
         table->add_column(column);
     }
 
-    if (std::ifstream data_file(get_data_path(table_name)); data_file.is_open()) {
-        std::string line;
-        while (std::getline(data_file, line)) {
-            Row row;
-            std::stringstream string_stream(line);
-            std::string pair;
-            
-            while (std::getline(string_stream, pair, '|')) {
-                if (auto pos = pair.find('='); pos != std::string::npos) {
-                    std::string col = pair.substr(0, pos);
-                    std::string val = pair.substr(pos + 1);
-                    row.data[col] = val;
-                }
-            }
-            
-            table->insert_row(row);
-        }
-    }
-
     return table;
 }
 
-auto DatabasePersistence::delete_table(const std::string& table_name) const -> void {
+auto DatabasePersistence::delete_table(const std::string& table_name) -> void {
+    wal.sync();
+    schema_version++;
+    cache.erase(table_name);
+    for (const auto& index_name : list_indexes(table_name) | std::views::keys) {
+        buffer_pool.discard_file(get_index_path(table_name, index_name));
+        std::filesystem::remove(get_index_path(table_name, index_name));
+    }
+    std::filesystem::remove(get_index_catalog_path(table_name));
+    {
+        std::lock_guard lock(page_directory_mutex);
+        page_directories.erase(get_data_path(table_name));
+    }
+    buffer_pool.discard_file(get_data_path(table_name));
     std::filesystem::remove(get_schema_path(table_name));
     std::filesystem::remove(get_data_path(table_name));
 }
@@ -148,10 +287,717 @@ auto DatabasePersistence::list_tables() const -> std::vector<std::string> {
     return tables;
 }
 
+DatabasePersistence::~DatabasePersistence() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: Failed to flush tables on shutdown: " << e.what() << "\n";
+    }
+}
+
+auto DatabasePersistence::get_table(const std::string& table_name) -> std::shared_ptr<Table> {
+    if (auto table = cache.find(table_name)) {
+        return table;
+    }
+
+    // Statements reading side by side may both miss; only one loads the table.
+    std::lock_guard lock(load_mutex);
+    if (auto table = cache.find(table_name)) {
+        return table;
+    }
+
+    const bool is_legacy = std::filesystem::exists(get_data_path(table_name))
+        && !PageFile::is_page_file(get_data_path(table_name));
+
+    std::shared_ptr<Table> table = load_table(table_name);
+    if (is_legacy) {
+        // Text files from older versions are converted on first use.
+        save_table_data(*table);
+    }
+    attach_indexes(*table);
+    // Other sessions see the table from here on.
+    cache.insert(table);
+    return table;
+}
+
+auto DatabasePersistence::attach_indexes(Table& table) -> void {
+    for (const auto& [index_name, column_name] : list_indexes(table.get_name())) {
+        auto index = std::make_shared<BTreeIndex>(index_name, column_name,
+                                                  get_index_path(table.get_name(), index_name), buffer_pool);
+        table.add_index(index);
+        // An index written for another image of the table (or never finished)
+        // is rebuilt from the loaded columns.
+        if (!index->is_current(table.get_lsn())) {
+            index->build(table.get_column_data(*table.column_index(column_name)));
+            index->persist(table.get_lsn());
+        }
+    }
+}
+
+auto DatabasePersistence::list_indexes(const std::string& table_name) const
+    -> std::vector<std::pair<std::string, std::string>> {
+    std::vector<std::pair<std::string, std::string>> indexes;
+    std::ifstream catalog(get_index_catalog_path(table_name));
+    std::string line;
+    while (std::getline(catalog, line)) {
+        if (const auto separator = line.find('|'); separator != std::string::npos) {
+            indexes.emplace_back(line.substr(0, separator), line.substr(separator + 1));
+        }
+    }
+    return indexes;
+}
+
+auto DatabasePersistence::save_index_catalog(const std::string& table_name,
+                                             const std::vector<std::pair<std::string, std::string>>& indexes) const -> void {
+    const auto catalog_path = get_index_catalog_path(table_name);
+    if (indexes.empty()) {
+        std::filesystem::remove(catalog_path);
+        return;
+    }
+
+    const auto temp_path = catalog_path + ".tmp";
+    {
+        std::ofstream catalog(temp_path, std::ios::trunc);
+        for (const auto& [index_name, column_name] : indexes) {
+            catalog << index_name << "|" << column_name << "\n";
+        }
+        if (!catalog) {
+            throw std::runtime_error("Could not write index catalog of table: " + table_name);
+        }
+    }
+    std::filesystem::rename(temp_path, catalog_path);
+}
+
+auto DatabasePersistence::create_index(const std::string& index_name, const std::string& table_name,
+                                       const std::string& column_name) -> void {
+    for (const auto& existing_table : list_tables()) {
+        for (const auto& existing : list_indexes(existing_table) | std::views::keys) {
+            if (existing == index_name) {
+                throw std::runtime_error("Index already exists: " + index_name);
+            }
+        }
+    }
+
+    const auto schema = load_schema(table_name);
+    if (!schema->column_index(column_name)) {
+        throw std::runtime_error("Column not found: " + column_name);
+    }
+
+    auto indexes = list_indexes(table_name);
+    indexes.emplace_back(index_name, column_name);
+    save_index_catalog(table_name, indexes);
+
+    if (!fits_in_memory(table_name)) {
+        BTreeIndex index(index_name, column_name, get_index_path(table_name, index_name), buffer_pool);
+        build_file_index(index, *schema);
+        return;
+    }
+    const auto table = get_table(table_name);
+    if (std::ranges::none_of(table->get_indexes(), [&](const auto& index) { return index->get_name() == index_name; })) {
+        const auto index = std::make_shared<BTreeIndex>(index_name, column_name,
+                                                        get_index_path(table_name, index_name), buffer_pool);
+        // Asked outside of the latch, see flush_table().
+        const auto is_dirty = cache.is_dirty(table_name);
+        {
+            const auto lock = table->read_latch();
+            index->build(table->get_column_data(*table->column_index(column_name)));
+            // Unflushed changes and old versions of the table are already in
+            // the new index, so its positions need not match the file.
+            const auto matches_file = !is_dirty && table->sees_all_rows(Snapshot::latest());
+            index->persist(matches_file ? table->get_lsn() : BTreeIndex::INVALID_LSN);
+        }
+        table->add_index(index);
+    }
+}
+
+auto DatabasePersistence::build_file_index(BTreeIndex& index, const Table& schema) -> void {
+    const auto data_path = get_data_path(schema.get_name());
+    const auto& columns = schema.get_columns();
+    const auto column = *schema.column_index(index.get_column_name());
+
+    // Only the indexed column is held in memory.
+    ColumnVector values(columns[column].type);
+    read_row_views(data_path, columns, [&](const RowView& row) {
+        if (row.is_null(column)) {
+            values.append_null();
+            return true;
+        }
+        switch (columns[column].type) {
+            case ColumnType::INTEGER: values.append_integer(row.as_integer(column)); break;
+            case ColumnType::BOOLEAN: values.append_boolean(row.as_boolean(column)); break;
+            case ColumnType::TEXT: values.append_text(row.as_text(column)); break;
+        }
+        return true;
+    });
+    index.build(values);
+    index.persist(buffer_pool.header(data_path).lsn);
+}
+
+auto DatabasePersistence::update_file_indexes(const std::string& table_name, uint64_t previous_lsn,
+                                              const Table* appended, uint64_t first_row) -> void {
+    const auto indexes = list_indexes(table_name);
+    if (indexes.empty()) {
+        return;
+    }
+
+    const auto schema = load_schema(table_name);
+    const auto lsn = buffer_pool.header(get_data_path(table_name)).lsn;
+    for (const auto& [index_name, column_name] : indexes) {
+        BTreeIndex index(index_name, column_name, get_index_path(table_name, index_name), buffer_pool);
+        if (!appended || !index.is_current(previous_lsn)) {
+            build_file_index(index, *schema);
+            continue;
+        }
+
+        // Numbered the way append_rows() wrote them.
+        const auto& column = appended->get_column_data(*appended->column_index(column_name));
+        auto position = first_row;
+        for (size_t row = 0; row < appended->get_row_count(); row++) {
+            if (appended->is_visible(row, Snapshot::latest())) {
+                index.insert(column, row, position++);
+            }
+        }
+        index.persist(lsn);
+    }
+}
+
+auto DatabasePersistence::indexed_pages(const std::string& table_name, const Table& schema, const Predicate& where)
+    -> std::optional<std::vector<uint32_t>> {
+    const auto& clause = where.get_clause();
+    const auto indexes = list_indexes(table_name);
+    if (indexes.empty() || (!clause.is_and && clause.conditions.size() != 1)) {
+        return std::nullopt;
+    }
+
+    // As in Table::lookup_rows, any indexed column of an AND narrows the
+    // candidates; the cursor checks the whole clause on the pages found.
+    const auto data_path = get_data_path(table_name);
+    const auto lsn = buffer_pool.header(data_path).lsn;
+    for (const auto& condition : clause.conditions) {
+        const auto it = std::ranges::find(indexes, condition.column, &std::pair<std::string, std::string>::second);
+        if (it == indexes.end()) {
+            continue;
+        }
+        const BTreeIndex index(it->first, it->second, get_index_path(table_name, it->first), buffer_pool);
+        if (!index.is_current(lsn)) {
+            continue;
+        }
+
+        // Every condition of an AND on the column narrows the key range.
+        const auto type = schema.get_columns()[*schema.column_index(condition.column)].type;
+        std::optional<std::string> lower;
+        std::optional<std::string> upper;
+        for (const auto& bound : clause.conditions) {
+            if (bound.column != condition.column) {
+                continue;
+            }
+            const auto key = BTreeIndex::encode_literal(type, bound.value);
+            if (bound.op != WhereOperator::LESS && bound.op != WhereOperator::LESS_EQ && (!lower || key > *lower)) {
+                lower = key;
+            }
+            if (bound.op != WhereOperator::GREATER && bound.op != WhereOperator::GREATER_EQ && (!upper || key < *upper)) {
+                upper = key;
+            }
+        }
+
+        std::vector<uint32_t> pages;
+        if (lower && upper && *lower > *upper) {
+            return pages;
+        }
+        const auto first_rows = page_directory(data_path);
+        index.find_range(lower, upper, [&](size_t row) {
+            // Data pages are numbered from 1.
+            pages.push_back(static_cast<uint32_t>(std::ranges::upper_bound(*first_rows, row) - first_rows->begin()));
+            return true;
+        });
+        std::ranges::sort(pages);
+        const auto duplicates = std::ranges::unique(pages);
+        pages.erase(duplicates.begin(), duplicates.end());
+        return pages;
+    }
+    return std::nullopt;
+}
+
+auto DatabasePersistence::page_directory(const std::string& data_path)
+    -> std::shared_ptr<const std::vector<uint64_t>> {
+    const auto header = buffer_pool.header(data_path);
+    {
+        std::lock_guard lock(page_directory_mutex);
+        const auto it = page_directories.find(data_path);
+        if (it != page_directories.end() && it->second.lsn == header.lsn && it->second.row_count == header.row_count
+            && it->second.page_count == header.page_count) {
+            return it->second.first_rows;
+        }
+    }
+
+    auto first_rows = std::make_shared<std::vector<uint64_t>>();
+    uint64_t rows = 0;
+    for (uint32_t page_id = 1; page_id < header.page_count; page_id++) {
+        first_rows->push_back(rows);
+        rows += DataPageView(buffer_pool.fetch_page(data_path, page_id).data()).row_count();
+    }
+
+    std::lock_guard lock(page_directory_mutex);
+    page_directories[data_path] = {header.lsn, header.row_count, header.page_count, first_rows};
+    return first_rows;
+}
+
+auto DatabasePersistence::drop_index(const std::string& index_name) -> bool {
+    for (const auto& table_name : list_tables()) {
+        auto indexes = list_indexes(table_name);
+        const auto it = std::ranges::find(indexes, index_name, &std::pair<std::string, std::string>::first);
+        if (it == indexes.end()) {
+            continue;
+        }
+
+        indexes.erase(it);
+        save_index_catalog(table_name, indexes);
+        if (const auto table = cache.peek(table_name)) {
+            table->remove_index(index_name);
+        }
+        buffer_pool.discard_file(get_index_path(table_name, index_name));
+        std::filesystem::remove(get_index_path(table_name, index_name));
+        return true;
+    }
+    return false;
+}
+
+auto DatabasePersistence::create_table(const std::shared_ptr<Table>& table) -> void {
+    wal.flush_to(table->get_lsn());
+    schema_version++;
+    save_table_schema(*table);
+    save_table_data(*table);
+    cache.insert(table);
+}
+
+auto DatabasePersistence::fits_in_memory(const std::string& table_name) const -> bool {
+    if (cache.peek(table_name)) {
+        return true;
+    }
+
+    const auto data_path = get_data_path(table_name);
+    if (!std::filesystem::exists(data_path) || !PageFile::is_page_file(data_path)) {
+        return true;
+    }
+    return std::filesystem::file_size(data_path) * IN_MEMORY_EXPANSION <= cache.get_memory_budget();
+}
+
+auto DatabasePersistence::open_cursor(const std::string& table_name, const std::vector<std::string>& columns,
+                                      std::optional<Predicate> where, const Snapshot& snapshot,
+                                      const RowLimit& limit) -> std::unique_ptr<Cursor> {
+    const bool resident = fits_in_memory(table_name);
+    const std::shared_ptr<Table> table = resident ? get_table(table_name) : load_schema(table_name);
+
+    std::vector<size_t> selected;
+    for (const auto& column : columns) {
+        const auto index = table->column_index(column);
+        if (!index) {
+            throw std::runtime_error("Column not found: " + column);
+        }
+        selected.push_back(*index);
+    }
+
+    if (resident) {
+        return std::make_unique<TableCursor>(table, std::move(selected), std::move(where), snapshot, limit);
+    }
+
+    const auto data_path = get_data_path(table_name);
+    if (where) {
+        if (auto pages = indexed_pages(table_name, *table, *where)) {
+            auto cursor = std::make_unique<PageCursor>(buffer_pool, data_path, table->get_columns(),
+                                                       std::move(selected), std::move(where), limit);
+            cursor->restrict_to_pages(std::move(*pages));
+            return cursor;
+        }
+    }
+    if (read_mode == ReadMode::MAPPED) {
+        // Pages still sitting dirty in the pool would be invisible to the mapping.
+        buffer_pool.flush_file(data_path);
+        return std::make_unique<PageCursor>(std::make_unique<MappedFile>(data_path), table->get_columns(),
+                                            std::move(selected), std::move(where), limit);
+    }
+    return std::make_unique<PageCursor>(buffer_pool, data_path, table->get_columns(), std::move(selected),
+                                        std::move(where), limit);
+}
+
+auto DatabasePersistence::row_count(const std::string& table_name, const Snapshot& snapshot) -> uint64_t {
+    if (const auto table = cache.peek(table_name)) {
+        return table->count_rows(snapshot);
+    }
+
+    const auto data_path = get_data_path(table_name);
+    if (!std::filesystem::exists(get_schema_path(table_name)) || !std::filesystem::exists(data_path)
+        || !PageFile::is_page_file(data_path)) {
+        return get_table(table_name)->count_rows(snapshot);
+    }
+    return buffer_pool.header(data_path).row_count;
+}
+
+auto DatabasePersistence::get_sort_budget() const -> size_t {
+    return std::max(cache.get_memory_budget() / SORT_BUDGET_DIVISOR, MIN_SORT_BUDGET);
+}
+
+auto DatabasePersistence::append_batch(const std::string& table_name, Table rows, uint64_t lsn,
+                                       Transaction& transaction) -> void {
+    if (cache.peek(table_name)) {
+        throw std::runtime_error("Table is resident, insert through the cached table: " + table_name);
+    }
+
+    const auto schema = load_schema(table_name);
+    const auto& columns = schema->get_columns();
+    const auto data_path = get_data_path(table_name);
+    const auto pk = schema->column_index(schema->get_primary_key_column());
+
+    // Only the key column of the stored rows is read, into a hash index.
+    ColumnVector keys(pk ? columns[*pk].type : ColumnType::INTEGER);
+    HashIndex key_index;
+    if (pk && rows.get_row_count() > 0) {
+        read_row_views(data_path, columns, [&](const RowView& row) {
+            switch (columns[*pk].type) {
+                case ColumnType::INTEGER: keys.append_integer(row.as_integer(*pk)); break;
+                case ColumnType::BOOLEAN: keys.append_boolean(row.as_boolean(*pk)); break;
+                case ColumnType::TEXT: keys.append_text(row.as_text(*pk)); break;
+            }
+            return true;
+        });
+        key_index.rebuild(keys);
+    }
+    schema->check_rows(rows, keys, key_index);
+
+    // Rows are appended in place, so they wait for the commit in memory.
+    auto batch = std::make_shared<Table>(std::move(rows));
+    transaction.defer({[this, table_name, data_path, batch, lsn] {
+        const auto previous = buffer_pool.header(data_path);
+        append_rows(data_path, *batch, 0, lsn);
+        update_file_indexes(table_name, previous.lsn, batch.get(), previous.row_count);
+    }, {}});
+}
+
+auto DatabasePersistence::rewrite_rows(const std::string& table_name, const Predicate* where,
+                                       const std::function<bool(Row&)>& transform, uint64_t lsn,
+                                       Transaction& transaction) -> void {
+    if (cache.peek(table_name)) {
+        throw std::runtime_error("Table is resident, modify the cached table instead: " + table_name);
+    }
+
+    const auto schema = load_schema(table_name);
+    const auto& columns = schema->get_columns();
+    const auto data_path = get_data_path(table_name);
+    const auto temp_path = data_path + ".tmp";
+
+    // Streams page by page: input pages come through the buffer pool, output
+    // pages are written straight to the new file, so memory use stays bounded.
+    {
+        auto output = PageFile::create(temp_path, columns, lsn);
+        std::vector<char> page(PageFile::PAGE_SIZE, '\0');
+        auto page_id = output.allocate_page();
+        DataPage(page.data()).init();
+        uint64_t row_count = 0;
+        std::string encoded;
+
+        const auto header = buffer_pool.header(data_path);
+        RowView view(columns);
+        for (uint32_t input_id = 1; input_id < header.page_count; input_id++) {
+            const auto input = buffer_pool.fetch_page(data_path, input_id);
+            const DataPageView data_page(input.data());
+
+            const auto* position = data_page.rows_begin();
+            for (uint16_t i = 0; i < data_page.row_count(); i++) {
+                const auto* const stored = position;
+                view.reset(position);
+                if (where && !where->matches(view)) {
+                    encoded.assign(stored, position);
+                } else {
+                    auto row = view.to_row();
+                    if (!transform(row)) {
+                        continue;
+                    }
+                    PageFile::encode_row(columns, row, encoded);
+                }
+
+                if (!DataPage(page.data()).append(encoded, PageFile::PAGE_SIZE)) {
+                    output.write_page(page_id, page.data());
+                    page_id = output.allocate_page();
+                    std::ranges::fill(page, '\0');
+                    DataPage(page.data()).init();
+                    if (!DataPage(page.data()).append(encoded, PageFile::PAGE_SIZE)) {
+                        throw std::runtime_error("Row does not fit into a single page");
+                    }
+                }
+                row_count++;
+            }
+        }
+
+        output.write_page(page_id, page.data());
+        output.set_row_count(row_count);
+        output.write_header();
+        output.sync();
+    }
+
+    transaction.defer({
+        [this, table_name, data_path, temp_path] {
+            buffer_pool.discard_file(data_path);
+            std::filesystem::rename(temp_path, data_path);
+            PageFile::sync_directory(db_directory);
+            update_file_indexes(table_name, 0, nullptr, 0);
+        },
+        [temp_path] { std::filesystem::remove(temp_path); },
+    });
+}
+
+auto DatabasePersistence::begin_transaction() -> std::unique_ptr<Transaction> {
+    return transactions.begin();
+}
+
+auto DatabasePersistence::log_change(Transaction& transaction, const std::string& table_name,
+                                     const std::string& statement) -> uint64_t {
+    if (replay_lsn) {
+        return *replay_lsn;
+    }
+
+    if (transaction.get_log_transaction() == 0) {
+        // Registered before its first record is written, with an LSN it cannot
+        // be below, so a checkpoint never truncates a record it misses.
+        const auto log_transaction = wal.next_transaction_id();
+        transactions.set_log_transaction(transaction, log_transaction, wal.get_last_lsn() + 1);
+        return wal.append_command(log_transaction, table_name, statement);
+    }
+    return wal.append_command(transaction.get_log_transaction(), table_name, statement);
+}
+
+auto DatabasePersistence::commit_transaction(Transaction& transaction) -> void {
+    // Durable first, then visible: nobody reads a change that a crash could
+    // still take back.
+    uint64_t commit_lsn = 0;
+    if (transaction.get_log_transaction() != 0) {
+        commit_lsn = wal.commit(transaction.get_log_transaction());
+    }
+    transactions.commit(transaction);
+
+    // A group commit may have returned before its record is on disk.
+    if (auto changes = transaction.take_file_changes(); !changes.empty()) {
+        wal.flush_to(commit_lsn);
+        for (const auto& change : changes) {
+            change.apply();
+        }
+    }
+}
+
+auto DatabasePersistence::abort_transaction(Transaction& transaction) -> void {
+    // Records of the transaction stay in the log without a COMMIT and are
+    // ignored by recovery.
+    transactions.abort(transaction);
+    for (const auto& change : transaction.take_file_changes()) {
+        if (change.discard) {
+            change.discard();
+        }
+    }
+}
+
+auto DatabasePersistence::set_group_commit(size_t batch_size, std::chrono::milliseconds window) -> void {
+    wal.set_group_commit(batch_size, window);
+}
+
+auto DatabasePersistence::committed_log_records() const -> std::vector<LogRecord> {
+    return Log::committed_records(Log::read_records(get_log_directory()));
+}
+
+auto DatabasePersistence::table_lsn(const std::string& table_name) -> std::optional<uint64_t> {
+    if (const auto table = cache.peek(table_name)) {
+        return table->get_lsn();
+    }
+    if (!std::filesystem::exists(get_schema_path(table_name))) {
+        return std::nullopt;
+    }
+
+    const auto data_path = get_data_path(table_name);
+    if (!std::filesystem::exists(data_path) || !PageFile::is_page_file(data_path)) {
+        return 0;
+    }
+    return buffer_pool.header(data_path).lsn;
+}
+
+auto DatabasePersistence::begin_replay(uint64_t lsn) -> void {
+    replay_lsn = lsn;
+}
+
+auto DatabasePersistence::end_replay() -> void {
+    replay_lsn.reset();
+}
+
+auto DatabasePersistence::checkpoint() -> void {
+    std::lock_guard lock(maintenance_mutex);
+    write_checkpoint();
+}
+
+auto DatabasePersistence::write_checkpoint() -> void {
+    const auto begin_lsn = wal.get_last_lsn();
+    flush_tables();
+
+    // Everything up to begin_lsn is in the table files now, except for what a
+    // still-open transaction or a table that could not be flushed depends on.
+    // Transactions first: one committing in between has marked its tables
+    // before.
+    auto redo_lsn = begin_lsn + 1;
+    if (const auto transaction_lsn = transactions.oldest_log_lsn()) {
+        redo_lsn = std::min(redo_lsn, *transaction_lsn);
+    }
+    if (const auto dirty_lsn = cache.min_recovery_lsn()) {
+        redo_lsn = std::min(redo_lsn, *dirty_lsn);
+    }
+
+    // Table files are written without fsync between checkpoints; the log
+    // records before redo_lsn are only dropped once the files are on disk.
+    buffer_pool.flush_all();
+    for (const auto& entry : std::filesystem::directory_iterator(db_directory)) {
+        if (entry.is_regular_file()) {
+            PageFile::sync_path(entry.path().string());
+        }
+    }
+    PageFile::sync_directory(db_directory);
+    wal.checkpoint(redo_lsn);
+}
+
+auto DatabasePersistence::set_checkpoint_threshold(uint64_t bytes) -> void {
+    checkpoint_threshold = bytes;
+}
+
+auto DatabasePersistence::mark_dirty(const std::string& table_name, uint64_t lsn) -> void {
+    cache.mark_dirty(table_name, lsn);
+}
+
+auto DatabasePersistence::mark_appended(const std::string& table_name, uint64_t lsn) -> void {
+    cache.mark_appended(table_name, lsn);
+}
+
+auto DatabasePersistence::end_statement() -> void {
+    std::lock_guard lock(maintenance_mutex);
+    switch (flush_policy) {
+        case FlushPolicy::PER_STATEMENT:
+            flush_tables();
+            break;
+        case FlushPolicy::PERIODIC:
+            if (std::chrono::steady_clock::now() - last_flush >= flush_interval) {
+                flush_tables();
+            }
+            break;
+        case FlushPolicy::ON_EXIT:
+            break;
+    }
+
+    cache.collect_garbage(transactions.horizon(), GARBAGE_DIVISOR);
+    enforce_memory_budget();
+    if (!replay_lsn && wal.size_on_disk() > checkpoint_threshold) {
+        write_checkpoint();
+    }
+}
+
+auto DatabasePersistence::flush() -> void {
+    std::lock_guard lock(maintenance_mutex);
+    flush_tables();
+}
+
+auto DatabasePersistence::flush_tables() -> void {
+    wal.sync();
+    for (const auto& table : cache.dirty_tables()) {
+        flush_table(*table);
+    }
+    last_flush = std::chrono::steady_clock::now();
+}
+
+auto DatabasePersistence::set_flush_policy(FlushPolicy policy, std::chrono::milliseconds interval) -> void {
+    flush_policy = policy;
+    flush_interval = interval;
+}
+
+auto DatabasePersistence::set_read_mode(ReadMode mode) -> void {
+    read_mode = mode;
+}
+
+auto DatabasePersistence::set_memory_budget(size_t bytes) -> void {
+    std::lock_guard lock(maintenance_mutex);
+    cache.set_memory_budget(bytes);
+    enforce_memory_budget();
+}
+
+auto DatabasePersistence::flush_table(Table& table) -> void {
+    // Rows written since the last flush are appended by position, so the
+    // file is rewritten when collecting old versions moved them.
+    const auto& table_name = table.get_name();
+    if (table.collect_garbage(transactions.horizon()) > 0) {
+        cache.mark_dirty(table_name, table.get_lsn());
+    }
+
+    // Uncommitted versions never reach the table file; the table stays dirty
+    // until its transactions end.
+    auto flush = cache.begin_flush(table_name);
+    if (!flush) {
+        return;
+    }
+    wal.flush_to(table.get_lsn());
+    const auto row_count = table.get_row_count();
+    if (flush->rewrite) {
+        save_table_data(table);
+    } else {
+        append_table_data(table, flush->persisted_rows);
+    }
+    // Index entries point at row positions, which only match the file when
+    // it holds every version the table still has.
+    const auto matches_file = table.sees_all_rows(Snapshot::latest());
+    for (const auto& index : table.get_indexes()) {
+        index->persist(matches_file ? table.get_lsn() : BTreeIndex::INVALID_LSN);
+    }
+    flush->latch.unlock();
+    cache.end_flush(table_name, flush->generation, row_count);
+}
+
+auto DatabasePersistence::enforce_memory_budget() -> void {
+    const auto horizon = transactions.horizon();
+    cache.evict_clean(horizon);
+    if (!cache.is_over_budget()) {
+        return;
+    }
+
+    // Only dirty tables are left over the budget: write the oldest ones back so
+    // they become evictable.
+    for (const auto& table_name : cache.eviction_candidates()) {
+        if (!cache.is_over_budget()) {
+            break;
+        }
+        if (cache.is_dirty(table_name)) {
+            flush_table(*cache.peek(table_name));
+        }
+        cache.evict_clean(horizon);
+    }
+}
+
 auto DatabasePersistence::get_schema_path(const std::string& table_name) const -> std::string {
     return (std::filesystem::path(db_directory) / (table_name + SCHEMA_EXTENSION)).string();
 }
 
 auto DatabasePersistence::get_data_path(const std::string& table_name) const -> std::string{
     return (std::filesystem::path(db_directory) / (table_name + DATA_EXTENSION)).string();
+}
+
+auto DatabasePersistence::get_index_catalog_path(const std::string& table_name) const -> std::string {
+    return (std::filesystem::path(db_directory) / (table_name + INDEX_CATALOG_EXTENSION)).string();
+}
+
+auto DatabasePersistence::get_index_path(const std::string& table_name, const std::string& index_name) const -> std::string {
+    return (std::filesystem::path(db_directory) / (table_name + "." + index_name + INDEX_EXTENSION)).string();
+}
+
+auto DatabasePersistence::get_temp_directory() const -> std::string {
+    return (std::filesystem::path(db_directory) / TEMP_DIRECTORY).string();
+}
+
+auto DatabasePersistence::get_log_directory() const -> std::string {
+    return db_directory;
+}
+
+auto DatabasePersistence::prepare_directory(const std::string& directory) -> std::string {
+    std::filesystem::create_directories(directory);
+    // Sort runs of statements that never finished.
+    std::filesystem::remove_all(std::filesystem::path(directory) / TEMP_DIRECTORY);
+    return directory;
 }
\ No newline at end of file
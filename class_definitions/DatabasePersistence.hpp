@@ -1,30 +1,223 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <chrono>
 #include <filesystem>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "class_definitions/BufferPool.hpp"
+#include "class_definitions/Cursor.hpp"
+#include "class_definitions/Log.hpp"
 #include "class_definitions/Table.hpp"
+#include "class_definitions/TableCache.hpp"
+#include "class_definitions/Transaction.hpp"
+#include "types/enums.hpp"
 
 class DatabasePersistence {
 private:
     static constexpr auto SCHEMA_EXTENSION = ".schema";
     static constexpr auto DATA_EXTENSION = ".data";
+    static constexpr auto INDEX_CATALOG_EXTENSION = ".indexes";
+    static constexpr auto INDEX_EXTENSION = ".idx";
+    static constexpr auto TEMP_DIRECTORY = "tmp";
+    // Rough ratio between the in-memory size of a table and its data file.
+    static constexpr size_t IN_MEMORY_EXPANSION = 8;
+    // Outside of a flush, removed row versions are collected once they make
+    // up this share of a table.
+    static constexpr size_t GARBAGE_DIVISOR = 8;
+    // Share of the memory budget one sort may buffer before spilling runs.
+    static constexpr size_t SORT_BUDGET_DIVISOR = 4;
+    static constexpr size_t MIN_SORT_BUDGET = 64 * 1024;
     std::string db_directory;
 
+    mutable BufferPool buffer_pool;
+
+    TableCache cache{DEFAULT_CACHE_BUDGET};
+    FlushPolicy flush_policy = FlushPolicy::PER_STATEMENT;
+    ReadMode read_mode = ReadMode::MAPPED;
+    std::chrono::milliseconds flush_interval{1000};
+    std::chrono::steady_clock::time_point last_flush = std::chrono::steady_clock::now();
+
+    Log wal;
+    TransactionManager transactions;
+    uint64_t checkpoint_threshold = DEFAULT_CHECKPOINT_THRESHOLD;
+    std::optional<uint64_t> replay_lsn;
+    std::atomic<uint64_t> schema_version{0};
+
+    // Where the rows of a data file start, page by page, so that row numbers
+    // from an index map to pages. Kept for one image of each file.
+    struct PageDirectory {
+        uint64_t lsn = 0;
+        uint64_t row_count = 0;
+        uint32_t page_count = 0;
+        std::shared_ptr<const std::vector<uint64_t>> first_rows; // of data pages 1, 2, ...
+    };
+    std::mutex page_directory_mutex;
+    std::unordered_map<std::string, PageDirectory> page_directories; // by data path
+
+    std::shared_mutex statement_mutex;
+    std::mutex load_mutex;        // one load of a missing table at a time
+    std::mutex maintenance_mutex; // flushes, checkpoints, collection, eviction
+
+    static auto prepare_directory(const std::string& directory) -> std::string;
+
 public:
-    explicit DatabasePersistence(std::string directory) 
-        : db_directory(std::move(directory)) {
-        std::filesystem::create_directories(db_directory);
-    }
+    static constexpr uint64_t DEFAULT_CHECKPOINT_THRESHOLD = 64 * 1024 * 1024;
+    static constexpr size_t DEFAULT_CACHE_BUDGET = 256 * 1024 * 1024;
+
+    explicit DatabasePersistence(std::string directory, size_t buffer_pool_frames = BufferPool::DEFAULT_FRAME_COUNT)
+        : db_directory(std::move(directory)), buffer_pool(buffer_pool_frames),
+          wal(prepare_directory(db_directory)) {}
+    ~DatabasePersistence();
+
+    DatabasePersistence(const DatabasePersistence&) = delete;
+    DatabasePersistence& operator=(const DatabasePersistence&) = delete;
 
     auto save_table_schema(const Table& table) const -> void;
     auto save_table_data(const Table& table) const -> void;
-    auto delete_table(const std::string& table_name) const -> void;
+    auto append_table_data(const Table& table, size_t first_row) const -> void;
+    auto delete_table(const std::string& table_name) -> void;
     [[nodiscard]] auto load_table(const std::string& table_name) const -> std::unique_ptr<Table>;
+    [[nodiscard]] auto load_schema(const std::string& table_name) const -> std::unique_ptr<Table>;
     [[nodiscard]] auto list_tables() const -> std::vector<std::string>;
+    // Rewrites a text (COL=VALUE) data file in the binary page format.
+    // Returns false when there was nothing to convert.
+    auto convert_legacy_data(const std::string& table_name) const -> bool;
     static auto string_to_column_type(const std::string& column_type) -> ColumnType;
     static auto column_type_to_string(const ColumnType& type) -> std::string;
 
+    // Cached access: tables stay resident between statements and are written
+    // back according to the flush policy.
+    [[nodiscard]] auto get_table(const std::string& table_name) -> std::shared_ptr<Table>;
+    auto create_table(const std::shared_ptr<Table>& table) -> void;
+    // Changes with every table created or deleted, so plans made by any
+    // session can tell they are out of date.
+    [[nodiscard]] auto get_schema_version() const -> uint64_t { return schema_version; }
+
+    // Secondary indexes. The catalog (TABLE.indexes, one NAME|COLUMN per line)
+    // is written immediately. A resident table keeps its index files up to
+    // date and rebuilds stale ones when it is loaded; for a table too large
+    // for memory the streamed changes do, and open_cursor() reads only the
+    // data pages holding the rows an index finds.
+    auto create_index(const std::string& index_name, const std::string& table_name, const std::string& column_name) -> void;
+    // Returns false when no index has that name.
+    auto drop_index(const std::string& index_name) -> bool;
+    [[nodiscard]] auto list_indexes(const std::string& table_name) const -> std::vector<std::pair<std::string, std::string>>;
+    // Streaming access through the buffer pool for tables that should not be
+    // loaded whole. Only valid while the table is not resident in the cache.
+    [[nodiscard]] auto fits_in_memory(const std::string& table_name) const -> bool;
+    // Pull-based scan of `columns` (none when empty) of the rows matching
+    // `where`: over the cached table when it fits in memory, otherwise page
+    // by page from the data file (mapped or through the buffer pool,
+    // following the read mode; an index lookup always goes through the
+    // pool). A resident table is read as `snapshot` sees it. The scan stops
+    // once `limit` is met. Throws on an unknown column.
+    [[nodiscard]] auto open_cursor(const std::string& table_name, const std::vector<std::string>& columns,
+                                   std::optional<Predicate> where, const Snapshot& snapshot,
+                                   const RowLimit& limit = {}) -> std::unique_ptr<Cursor>;
+    // Number of rows `snapshot` sees in the resident table, or else the row
+    // count of the data file header.
+    [[nodiscard]] auto row_count(const std::string& table_name, const Snapshot& snapshot) -> uint64_t;
+    // Scratch space for sort runs; emptied whenever the database is opened.
+    [[nodiscard]] auto get_temp_directory() const -> std::string;
+    [[nodiscard]] auto get_sort_budget() const -> size_t;
+    // Changes to a table that is not resident. They are checked and prepared
+    // right away, but the data file only changes once `transaction` has
+    // committed and its COMMIT record is on disk, so a file never holds a
+    // change that recovery would have to take back.
+    //
+    // Appends every row of `rows` to the data file in one write, after
+    // checking them against the stored primary keys (see Table::check_rows).
+    auto append_batch(const std::string& table_name, Table rows, uint64_t lsn, Transaction& transaction) -> void;
+    // Writes a new image of the data file, swapped in on commit. Rows matching
+    // `where` (all rows without one) are passed to `transform`, which edits
+    // the row in place or returns false to drop it; other rows are copied as
+    // they are stored.
+    auto rewrite_rows(const std::string& table_name, const Predicate* where,
+                      const std::function<bool(Row&)>& transform, uint64_t lsn, Transaction& transaction) -> void;
+
+    // Transactions. Each one reads a snapshot of the resident tables and
+    // writes row versions only it sees until it commits (see Table). Every
+    // change is logged before any table file is written; the returned LSN is
+    // stored with the table so recovery knows which records a file already
+    // contains. Tables holding versions of a transaction in progress are not
+    // written back. Committing makes the changes durable through the log's
+    // COMMIT record and then visible to new snapshots; aborting drops them.
+    // File changes the transaction deferred are applied after its commit.
+    [[nodiscard]] auto begin_transaction() -> std::unique_ptr<Transaction>;
+    auto log_change(Transaction& transaction, const std::string& table_name, const std::string& statement) -> uint64_t;
+    auto commit_transaction(Transaction& transaction) -> void;
+    auto abort_transaction(Transaction& transaction) -> void;
+    auto set_group_commit(size_t batch_size, std::chrono::milliseconds window) -> void;
+    [[nodiscard]] auto committed_log_records() const -> std::vector<LogRecord>;
+    // LSN stored with the table, or nullopt when the table does not exist.
+    [[nodiscard]] auto table_lsn(const std::string& table_name) -> std::optional<uint64_t>;
+    // While replaying, log_change() hands out the LSN of the replayed record
+    // instead of writing a new one.
+    auto begin_replay(uint64_t lsn) -> void;
+    auto end_replay() -> void;
+    // Writes every dirty table back and truncates the log up to the oldest
+    // record recovery still needs. Runs on its own once the log grows past
+    // the checkpoint threshold.
+    auto checkpoint() -> void;
+    auto set_checkpoint_threshold(uint64_t bytes) -> void;
+
+    // Sessions on several threads (see Server) share one database. Queries
+    // and changes to resident tables hold this latch shared and run side by
+    // side: the cache, table loading, the log and the work done after each
+    // statement lock themselves, and the rows of a table are guarded by its
+    // own latch and versions. Statements that create or remove table files,
+    // and changes streamed through the file of a table too large for memory,
+    // hold it exclusively. Outside of a statement nothing is held, so an open
+    // transaction does not keep other sessions waiting.
+    [[nodiscard]] auto statement_latch() -> std::shared_mutex& { return statement_mutex; }
+
+    // After changing a resident table, before committing (see TableCache).
+    auto mark_dirty(const std::string& table_name, uint64_t lsn) -> void;
+    auto mark_appended(const std::string& table_name, uint64_t lsn) -> void;
+    auto end_statement() -> void;
+    auto flush() -> void;
+
+    auto set_flush_policy(FlushPolicy policy, std::chrono::milliseconds interval = std::chrono::milliseconds(1000)) -> void;
+    auto set_memory_budget(size_t bytes) -> void;
+    auto set_read_mode(ReadMode mode) -> void;
+    [[nodiscard]] auto get_flush_policy() const -> FlushPolicy { return flush_policy; }
+    [[nodiscard]] auto get_read_mode() const -> ReadMode { return read_mode; }
+
 private:
+    static auto load_legacy_rows(const std::string& data_path, Table& table) -> void;
+    auto append_rows(const std::string& data_path, const Table& table, size_t first_row, uint64_t lsn) const -> void;
+    auto read_rows(const std::string& data_path, const std::vector<Column>& columns,
+                   const std::function<bool(Row&&)>& visitor) const -> void;
+    auto read_row_views(const std::string& data_path, const std::vector<Column>& columns,
+                        const std::function<bool(const RowView&)>& visitor) const -> void;
+    // flush() and checkpoint() for callers already holding maintenance_mutex.
+    auto flush_tables() -> void;
+    auto write_checkpoint() -> void;
+    auto flush_table(Table& table) -> void;
+    auto attach_indexes(Table& table) -> void;
+    // Indexes of tables that are not resident, read from and kept in line
+    // with the data file.
+    auto build_file_index(BTreeIndex& index, const Table& schema) -> void;
+    // After a streamed change to the data file: rows appended to an image the
+    // indexes matched are added to them, otherwise they are built again.
+    auto update_file_indexes(const std::string& table_name, uint64_t previous_lsn, const Table* appended,
+                             uint64_t first_row) -> void;
+    // Data pages holding the candidate rows of an index that answers `where`,
+    // in file order; nullopt when no current index does.
+    [[nodiscard]] auto indexed_pages(const std::string& table_name, const Table& schema, const Predicate& where)
+        -> std::optional<std::vector<uint32_t>>;
+    // Built from the page headers the first time it is asked for.
+    [[nodiscard]] auto page_directory(const std::string& data_path) -> std::shared_ptr<const std::vector<uint64_t>>;
+    auto save_index_catalog(const std::string& table_name,
+                            const std::vector<std::pair<std::string, std::string>>& indexes) const -> void;
+    auto enforce_memory_budget() -> void;
     [[nodiscard]] auto get_schema_path(const std::string& table_name) const -> std::string;
     [[nodiscard]] auto get_data_path(const std::string& table_name) const -> std::string;
-}; 
\ No newline at end of file
+    [[nodiscard]] auto get_index_catalog_path(const std::string& table_name) const -> std::string;
+    [[nodiscard]] auto get_index_path(const std::string& table_name, const std::string& index_name) const -> std::string;
+    [[nodiscard]] auto get_log_directory() const -> std::string;
+};
@@ -0,0 +1,218 @@
+#include "FilterKernels.hpp"
+#include "Table.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPPDATABASE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    using IntegerKernel = void (*)(const int64_t*, size_t, int64_t, uint64_t*);
+
+    template <WhereOperator Op>
+    inline auto compare(int64_t value, int64_t literal) -> bool {
+        if constexpr (Op == WhereOperator::EQUALS) return value == literal;
+        else if constexpr (Op == WhereOperator::GREATER) return value > literal;
+        else if constexpr (Op == WhereOperator::LESS) return value < literal;
+        else if constexpr (Op == WhereOperator::GREATER_EQ) return value >= literal;
+        else return value <= literal;
+    }
+
+    // Rows [first, count) one at a time, used for the scalar kernel and the
+    // tails of the vector ones. `first` is a multiple of 64.
+    template <WhereOperator Op>
+    auto scalar_kernel_from(const int64_t* values, size_t first, size_t count, int64_t literal, uint64_t* out) -> void {
+        for (auto word = first / 64; word * 64 < count; word++) {
+            const auto end = std::min<size_t>(64, count - word * 64);
+            uint64_t bits = 0;
+            for (size_t bit = 0; bit < end; bit++) {
+                bits |= static_cast<uint64_t>(compare<Op>(values[word * 64 + bit], literal)) << bit;
+            }
+            out[word] = bits;
+        }
+    }
+
+    template <WhereOperator Op>
+    auto scalar_kernel(const int64_t* values, size_t count, int64_t literal, uint64_t* out) -> void {
+        scalar_kernel_from<Op>(values, 0, count, literal, out);
+    }
+
+#ifdef CPPDATABASE_X86_KERNELS
+    // a <op> b for 4 lanes, as a 4-bit mask. Only = and > exist natively; the
+    // other operators swap the operands or invert the result.
+    template <WhereOperator Op>
+    __attribute__((target("avx2"))) inline auto avx2_mask(__m256i values, __m256i literal) -> uint64_t {
+        __m256i result;
+        bool invert = false;
+        if constexpr (Op == WhereOperator::EQUALS) result = _mm256_cmpeq_epi64(values, literal);
+        else if constexpr (Op == WhereOperator::GREATER) result = _mm256_cmpgt_epi64(values, literal);
+        else if constexpr (Op == WhereOperator::LESS) result = _mm256_cmpgt_epi64(literal, values);
+        else if constexpr (Op == WhereOperator::GREATER_EQ) { result = _mm256_cmpgt_epi64(literal, values); invert = true; }
+        else { result = _mm256_cmpgt_epi64(values, literal); invert = true; }
+
+        const auto mask = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(result)));
+        return invert ? ~mask & 0xF : mask;
+    }
+
+    template <WhereOperator Op>
+    __attribute__((target("avx2"))) auto avx2_kernel(const int64_t* values, size_t count, int64_t literal,
+                                                    uint64_t* out) -> void {
+        const auto broadcast = _mm256_set1_epi64x(literal);
+        const auto full_words = count / 64;
+        for (size_t word = 0; word < full_words; word++) {
+            const auto* block = values + word * 64;
+            uint64_t bits = 0;
+            for (size_t lane = 0; lane < 64; lane += 4) {
+                const auto loaded = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + lane));
+                bits |= avx2_mask<Op>(loaded, broadcast) << lane;
+            }
+            out[word] = bits;
+        }
+        scalar_kernel_from<Op>(values, full_words * 64, count, literal, out);
+    }
+
+    template <WhereOperator Op>
+    __attribute__((target("sse4.2"))) inline auto sse_mask(__m128i values, __m128i literal) -> uint64_t {
+        __m128i result;
+        bool invert = false;
+        if constexpr (Op == WhereOperator::EQUALS) result = _mm_cmpeq_epi64(values, literal);
+        else if constexpr (Op == WhereOperator::GREATER) result = _mm_cmpgt_epi64(values, literal);
+        else if constexpr (Op == WhereOperator::LESS) result = _mm_cmpgt_epi64(literal, values);
+        else if constexpr (Op == WhereOperator::GREATER_EQ) { result = _mm_cmpgt_epi64(literal, values); invert = true; }
+        else { result = _mm_cmpgt_epi64(values, literal); invert = true; }
+
+        const auto mask = static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(result)));
+        return invert ? ~mask & 0x3 : mask;
+    }
+
+    template <WhereOperator Op>
+    __attribute__((target("sse4.2"))) auto sse_kernel(const int64_t* values, size_t count, int64_t literal,
+                                                     uint64_t* out) -> void {
+        const auto broadcast = _mm_set1_epi64x(literal);
+        const auto full_words = count / 64;
+        for (size_t word = 0; word < full_words; word++) {
+            const auto* block = values + word * 64;
+            uint64_t bits = 0;
+            for (size_t lane = 0; lane < 64; lane += 2) {
+                const auto loaded = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + lane));
+                bits |= sse_mask<Op>(loaded, broadcast) << lane;
+            }
+            out[word] = bits;
+        }
+        scalar_kernel_from<Op>(values, full_words * 64, count, literal, out);
+    }
+#endif
+
+    auto detect_best_isa() -> FilterKernels::Isa {
+#ifdef CPPDATABASE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return FilterKernels::Isa::AVX2;
+        if (__builtin_cpu_supports("sse4.2")) return FilterKernels::Isa::SSE42;
+#endif
+        return FilterKernels::Isa::SCALAR;
+    }
+
+    std::atomic<FilterKernels::Isa>& selected_isa() {
+        static std::atomic<FilterKernels::Isa> isa{FilterKernels::best_isa()};
+        return isa;
+    }
+
+    template <WhereOperator Op>
+    auto pick_kernel(FilterKernels::Isa isa) -> IntegerKernel {
+#ifdef CPPDATABASE_X86_KERNELS
+        switch (isa) {
+            case FilterKernels::Isa::AVX2: return &avx2_kernel<Op>;
+            case FilterKernels::Isa::SSE42: return &sse_kernel<Op>;
+            case FilterKernels::Isa::SCALAR: break;
+        }
+#endif
+        (void) isa;
+        return &scalar_kernel<Op>;
+    }
+
+    auto integer_kernel(WhereOperator op) -> IntegerKernel {
+        const auto isa = selected_isa().load(std::memory_order_relaxed);
+        switch (op) {
+            case WhereOperator::EQUALS: return pick_kernel<WhereOperator::EQUALS>(isa);
+            case WhereOperator::GREATER: return pick_kernel<WhereOperator::GREATER>(isa);
+            case WhereOperator::LESS: return pick_kernel<WhereOperator::LESS>(isa);
+            case WhereOperator::GREATER_EQ: return pick_kernel<WhereOperator::GREATER_EQ>(isa);
+            case WhereOperator::LESS_EQ: return pick_kernel<WhereOperator::LESS_EQ>(isa);
+        }
+        return &scalar_kernel<WhereOperator::EQUALS>;
+    }
+
+    auto clear_tail(size_t count, uint64_t* out) -> void {
+        if (count % 64 != 0) {
+            out[count / 64] &= (uint64_t{1} << (count % 64)) - 1;
+        }
+    }
+}
+
+auto FilterKernels::compare_integers(const int64_t* values, size_t count, WhereOperator op, int64_t literal,
+                                     uint64_t* out) -> void {
+    integer_kernel(op)(values, count, literal, out);
+}
+
+auto FilterKernels::compare_booleans(const uint64_t* bits, size_t count, WhereOperator op, bool literal,
+                                     uint64_t* out) -> void {
+    // With FALSE < TRUE every operator reduces to one of: the bits, their
+    // complement, all rows or no rows.
+    enum { BITS, INVERTED, ALL, NONE } form;
+    switch (op) {
+        case WhereOperator::EQUALS: form = literal ? BITS : INVERTED; break;
+        case WhereOperator::GREATER: form = literal ? NONE : BITS; break;
+        case WhereOperator::LESS: form = literal ? INVERTED : NONE; break;
+        case WhereOperator::GREATER_EQ: form = literal ? BITS : ALL; break;
+        case WhereOperator::LESS_EQ: form = literal ? ALL : INVERTED; break;
+        default: form = NONE; break;
+    }
+
+    const auto words = words_for(count);
+    for (size_t word = 0; word < words; word++) {
+        switch (form) {
+            case BITS: out[word] = bits[word]; break;
+            case INVERTED: out[word] = ~bits[word]; break;
+            case ALL: out[word] = ~uint64_t{0}; break;
+            case NONE: out[word] = 0; break;
+        }
+    }
+    clear_tail(count, out);
+}
+
+auto FilterKernels::and_into(uint64_t* target, const uint64_t* other, size_t words) -> void {
+    for (size_t word = 0; word < words; word++) {
+        target[word] &= other[word];
+    }
+}
+
+auto FilterKernels::or_into(uint64_t* target, const uint64_t* other, size_t words) -> void {
+    for (size_t word = 0; word < words; word++) {
+        target[word] |= other[word];
+    }
+}
+
+auto FilterKernels::best_isa() -> Isa {
+    static const auto isa = detect_best_isa();
+    return isa;
+}
+
+auto FilterKernels::active_isa() -> Isa {
+    return selected_isa().load(std::memory_order_relaxed);
+}
+
+auto FilterKernels::set_isa(Isa isa) -> void {
+    selected_isa().store(std::min(isa, best_isa()), std::memory_order_relaxed);
+}
+
+auto FilterKernels::isa_name(Isa isa) -> std::string_view {
+    switch (isa) {
+        case Isa::SCALAR: return "scalar";
+        case Isa::SSE42: return "sse4.2";
+        case Isa::AVX2: return "avx2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class WhereOperator;
+
+// Batch comparison kernels for WHERE evaluation. Every kernel writes a
+// selection bitmap: bit i of out[i / 64] is set when row i matches. Bits past
+// `count` in the last word are always cleared, so bitmaps combine with plain
+// word operations.
+//
+// INTEGER comparisons have AVX2 and SSE4.2 versions next to the scalar one;
+// the best one the CPU supports is picked on first use. BOOLEAN columns are
+// already bit-packed and are filtered a word at a time.
+class FilterKernels {
+public:
+    enum class Isa {
+        SCALAR,
+        SSE42,
+        AVX2,
+    };
+
+    static auto compare_integers(const int64_t* values, size_t count, WhereOperator op, int64_t literal,
+                                 uint64_t* out) -> void;
+    static auto compare_booleans(const uint64_t* bits, size_t count, WhereOperator op, bool literal,
+                                 uint64_t* out) -> void;
+
+    static auto and_into(uint64_t* target, const uint64_t* other, size_t words) -> void;
+    static auto or_into(uint64_t* target, const uint64_t* other, size_t words) -> void;
+
+    [[nodiscard]] static auto words_for(size_t count) -> size_t { return (count + 63) / 64; }
+
+    // Widest instruction set usable on this CPU, and the one currently in use.
+    [[nodiscard]] static auto best_isa() -> Isa;
+    [[nodiscard]] static auto active_isa() -> Isa;
+    // Pins the integer kernels to `isa` (capped at best_isa()); for benchmarks.
+    static auto set_isa(Isa isa) -> void;
+    [[nodiscard]] static auto isa_name(Isa isa) -> std::string_view;
+};
@@ -0,0 +1,204 @@
+#include "HashIndex.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+
+namespace {
+    auto mix(uint64_t value) -> uint64_t {
+        // splitmix64 finaliser; spreads sequential keys over the table.
+        value += 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    auto hash_text(std::string_view value) -> uint64_t {
+        return mix(std::hash<std::string_view>{}(value));
+    }
+}
+
+auto HashIndex::hash_value(const ColumnVector& column, size_t row) -> uint64_t {
+    switch (column.get_type()) {
+        case ColumnType::INTEGER: return mix(static_cast<uint64_t>(column.integer_at(row)));
+        case ColumnType::BOOLEAN: return mix(column.boolean_at(row) ? 1 : 0);
+        case ColumnType::TEXT: return hash_text(column.text_at(row));
+    }
+    return 0;
+}
+
+auto HashIndex::find(const ColumnVector& column, std::string_view key) const -> std::optional<size_t> {
+    std::optional<size_t> found;
+    find(column, key, [&found](size_t row) {
+        found = row;
+        return false;
+    });
+    return found;
+}
+
+auto HashIndex::find(const ColumnVector& column, const ColumnVector& keys, size_t key_row) const
+    -> std::optional<size_t> {
+    std::optional<size_t> found;
+    find(column, keys, key_row, [&found](size_t row) {
+        found = row;
+        return false;
+    });
+    return found;
+}
+
+auto HashIndex::find(const ColumnVector& column, std::string_view key,
+                     const std::function<bool(size_t)>& visitor) const -> void {
+    if (slots.empty()) {
+        return;
+    }
+
+    // Parse the key once; every probe then compares typed values.
+    int64_t integer = 0;
+    uint64_t hash = 0;
+    switch (column.get_type()) {
+        case ColumnType::INTEGER:
+            integer = ColumnVector::parse_integer(key);
+            hash = mix(static_cast<uint64_t>(integer));
+            break;
+        case ColumnType::BOOLEAN:
+            integer = ColumnVector::parse_boolean(key) ? 1 : 0;
+            hash = mix(static_cast<uint64_t>(integer));
+            break;
+        case ColumnType::TEXT:
+            hash = hash_text(key);
+            break;
+    }
+
+    for (auto i = hash & mask();; i = (i + 1) & mask()) {
+        const auto& slot = slots[i];
+        if (slot.row == EMPTY) {
+            return;
+        }
+        if (slot.row == DELETED || slot.hash != hash) {
+            continue;
+        }
+
+        bool equal = false;
+        switch (column.get_type()) {
+            case ColumnType::INTEGER: equal = column.integer_at(slot.row) == integer; break;
+            case ColumnType::BOOLEAN: equal = column.boolean_at(slot.row) == (integer != 0); break;
+            case ColumnType::TEXT: equal = column.text_at(slot.row) == key; break;
+        }
+        if (equal && !visitor(slot.row)) {
+            return;
+        }
+    }
+}
+
+auto HashIndex::find(const ColumnVector& column, const ColumnVector& keys, size_t key_row,
+                     const std::function<bool(size_t)>& visitor) const -> void {
+    if (slots.empty()) {
+        return;
+    }
+
+    const auto hash = hash_value(keys, key_row);
+    for (auto i = hash & mask();; i = (i + 1) & mask()) {
+        const auto& slot = slots[i];
+        if (slot.row == EMPTY) {
+            return;
+        }
+        if (slot.row == DELETED || slot.hash != hash) {
+            continue;
+        }
+
+        bool equal = false;
+        switch (column.get_type()) {
+            case ColumnType::INTEGER: equal = column.integer_at(slot.row) == keys.integer_at(key_row); break;
+            case ColumnType::BOOLEAN: equal = column.boolean_at(slot.row) == keys.boolean_at(key_row); break;
+            case ColumnType::TEXT: equal = column.text_at(slot.row) == keys.text_at(key_row); break;
+        }
+        if (equal && !visitor(slot.row)) {
+            return;
+        }
+    }
+}
+
+auto HashIndex::insert(const ColumnVector& column, size_t row) -> void {
+    if (column.is_null(row)) {
+        return;
+    }
+    // Keep at most 70% of the slots occupied, tombstones included.
+    if ((live + deleted + 1) * 10 > slots.size() * 7) {
+        grow();
+    }
+
+    const auto hash = hash_value(column, row);
+    for (auto i = hash & mask();; i = (i + 1) & mask()) {
+        auto& slot = slots[i];
+        if (slot.row == EMPTY || slot.row == DELETED) {
+            deleted -= slot.row == DELETED;
+            slot = {hash, row};
+            live++;
+            return;
+        }
+    }
+}
+
+auto HashIndex::erase(const ColumnVector& column, size_t row) -> void {
+    if (slots.empty() || column.is_null(row)) {
+        return;
+    }
+
+    const auto hash = hash_value(column, row);
+    for (auto i = hash & mask();; i = (i + 1) & mask()) {
+        auto& slot = slots[i];
+        if (slot.row == EMPTY) {
+            return;
+        }
+        if (slot.row == row) {
+            slot.row = DELETED;
+            live--;
+            deleted++;
+            return;
+        }
+    }
+}
+
+auto HashIndex::rebuild(const ColumnVector& column) -> void {
+    clear();
+    size_t capacity = MIN_CAPACITY;
+    while (column.size() * 10 > capacity * 7) {
+        capacity *= 2;
+    }
+    slots.assign(capacity, Slot{});
+    for (size_t row = 0; row < column.size(); row++) {
+        insert(column, row);
+    }
+}
+
+auto HashIndex::clear() -> void {
+    slots.clear();
+    live = 0;
+    deleted = 0;
+}
+
+auto HashIndex::grow() -> void {
+    // Doubles only when live entries need it; a table full of tombstones is
+    // rehashed at the same size.
+    auto capacity = std::max(slots.size(), MIN_CAPACITY);
+    while ((live + 1) * 10 > capacity * 7) {
+        capacity *= 2;
+    }
+
+    std::vector<Slot> old(capacity, Slot{});
+    old.swap(slots);
+    live = 0;
+    deleted = 0;
+    for (const auto& slot : old) {
+        if (slot.row == EMPTY || slot.row == DELETED) {
+            continue;
+        }
+        for (auto i = slot.hash & mask();; i = (i + 1) & mask()) {
+            if (slots[i].row == EMPTY) {
+                slots[i] = slot;
+                live++;
+                break;
+            }
+        }
+    }
+}
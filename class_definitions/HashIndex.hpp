@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "class_definitions/ColumnVector.hpp"
+
+// Open-addressing (linear probing) hash index from the values of one column
+// to row positions. Only hashes and row numbers are stored; keys are compared
+// against the column itself, so the index must be given the same column on
+// every call. Rebuilt from the column when a table is loaded.
+class HashIndex {
+    struct Slot {
+        uint64_t hash = 0;
+        uint64_t row = EMPTY;
+    };
+
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+    static constexpr uint64_t DELETED = UINT64_MAX - 1;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    std::vector<Slot> slots;
+    size_t live = 0;
+    size_t deleted = 0;
+
+    auto grow() -> void;
+    [[nodiscard]] auto mask() const -> size_t { return slots.size() - 1; }
+
+public:
+    // Row holding `key` (given as text, parsed with the column type).
+    [[nodiscard]] auto find(const ColumnVector& column, std::string_view key) const -> std::optional<size_t>;
+    // Row of `column` holding the value of keys[key_row] (same type, not NULL).
+    [[nodiscard]] auto find(const ColumnVector& column, const ColumnVector& keys, size_t key_row) const
+        -> std::optional<size_t>;
+    // Every row holding the key, in no particular order, until `visitor`
+    // returns false. Tables index all versions of a row, so a key may be held
+    // by several rows.
+    auto find(const ColumnVector& column, std::string_view key, const std::function<bool(size_t)>& visitor) const
+        -> void;
+    auto find(const ColumnVector& column, const ColumnVector& keys, size_t key_row,
+              const std::function<bool(size_t)>& visitor) const -> void;
+    // Indexes the value stored in `row`. NULL values are not indexed.
+    auto insert(const ColumnVector& column, size_t row) -> void;
+    // Forgets `row`; call before its value changes.
+    auto erase(const ColumnVector& column, size_t row) -> void;
+    auto rebuild(const ColumnVector& column) -> void;
+    auto clear() -> void;
+
+    [[nodiscard]] auto size() const -> size_t { return live; }
+    [[nodiscard]] auto memory_usage() const -> size_t { return sizeof(HashIndex) + slots.capacity() * sizeof(Slot); }
+
+    [[nodiscard]] static auto hash_value(const ColumnVector& column, size_t row) -> uint64_t;
+};
@@ -0,0 +1,102 @@
+#include "HashJoinCursor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+HashJoinCursor::HashJoinCursor(std::unique_ptr<Cursor> build_input, size_t build_column,
+                               std::unique_ptr<Cursor> probe_input, size_t probe_column,
+                               std::vector<Output> output_columns)
+    : build(std::move(build_input)),
+      probe(std::move(probe_input)),
+      build_key(build_column),
+      probe_key(probe_column),
+      key_type(build->get_columns().at(build_key).type),
+      outputs(std::move(output_columns)) {
+    if (probe->get_columns().at(probe_key).type != key_type) {
+        throw std::runtime_error("Join columns have different types: " + build->get_columns()[build_key].name
+                                 + ", " + probe->get_columns()[probe_key].name);
+    }
+    for (const auto& item : outputs) {
+        output.push_back((item.is_build ? build : probe)->get_columns().at(item.column));
+        output.back().name = item.name;
+    }
+}
+
+auto HashJoinCursor::build_table() -> void {
+    built = true;
+    Tuple row;
+    while (build->next(row)) {
+        if (!row[build_key].is_null) {
+            build_rows.push_back(std::move(row));
+            row = {};
+        }
+    }
+
+    size_t capacity = MIN_CAPACITY;
+    // At most 70% of the slots occupied, like HashIndex.
+    while (build_rows.size() * 10 > capacity * 7) {
+        capacity *= 2;
+    }
+    slots.assign(capacity, Slot{});
+    next_match.assign(build_rows.size(), EMPTY);
+
+    // Rows are linked back to front so every chain lists its rows in input order.
+    const auto mask = capacity - 1;
+    for (auto row_index = build_rows.size(); row_index-- > 0;) {
+        const auto& key = build_rows[row_index][build_key];
+        const auto hash = key.hash(key_type);
+        for (auto i = hash & mask;; i = (i + 1) & mask) {
+            auto& slot = slots[i];
+            if (slot.first == EMPTY) {
+                slot = {hash, row_index};
+                break;
+            }
+            if (slot.hash == hash && build_rows[slot.first][build_key].compare(key, key_type) == 0) {
+                next_match[row_index] = slot.first;
+                slot.first = row_index;
+                break;
+            }
+        }
+    }
+}
+
+auto HashJoinCursor::find(const Value& key, uint64_t hash) const -> size_t {
+    const auto mask = slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        const auto& slot = slots[i];
+        if (slot.first == EMPTY) {
+            return EMPTY;
+        }
+        if (slot.hash == hash && build_rows[slot.first][build_key].compare(key, key_type) == 0) {
+            return slot.first;
+        }
+    }
+}
+
+auto HashJoinCursor::next(Tuple& row) -> bool {
+    if (!built) {
+        build_table();
+    }
+    if (build_rows.empty()) {
+        return false; // nothing can match; the probe side is never read
+    }
+
+    while (match == EMPTY) {
+        if (!probe->next(probe_row)) {
+            return false;
+        }
+        const auto& key = probe_row[probe_key];
+        if (!key.is_null) {
+            match = find(key, key.hash(key_type));
+        }
+    }
+
+    const auto& build_row = build_rows[match];
+    row.resize(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const auto& item = outputs[i];
+        row[i] = item.is_build ? build_row[item.column] : probe_row[item.column];
+    }
+    match = next_match[match];
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "class_definitions/Cursor.hpp"
+
+// Inner equi-join `build.key = probe.key`. The build input (the smaller one)
+// is drained into memory on the first next() and hashed on its key in an
+// open-addressing table; rows with equal keys are chained. The probe input
+// is streamed, so a LIMIT above the join stops the probe scan early. NULL
+// keys never match. Output rows follow the probe order.
+class HashJoinCursor : public Cursor {
+public:
+    // Output column: column `column` of the build (is_build) or probe input,
+    // renamed to `name`.
+    struct Output {
+        bool is_build;
+        size_t column;
+        std::string name;
+    };
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        size_t first = EMPTY; // first build row with this key
+    };
+
+    static constexpr size_t EMPTY = SIZE_MAX;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    std::unique_ptr<Cursor> build;
+    std::unique_ptr<Cursor> probe;
+    size_t build_key;
+    size_t probe_key;
+    ColumnType key_type;
+    std::vector<Output> outputs;
+    std::vector<Column> output;
+
+    bool built = false;
+    std::vector<Tuple> build_rows;
+    std::vector<size_t> next_match; // chain of build rows with the same key
+    std::vector<Slot> slots;
+
+    Tuple probe_row;
+    size_t match = EMPTY; // next build row to join with probe_row
+
+    auto build_table() -> void;
+    [[nodiscard]] auto find(const Value& key, uint64_t hash) const -> size_t;
+
+public:
+    HashJoinCursor(std::unique_ptr<Cursor> build_input, size_t build_column, std::unique_ptr<Cursor> probe_input,
+                   size_t probe_column, std::vector<Output> output_columns);
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return output; }
+    auto next(Tuple& row) -> bool override;
+};
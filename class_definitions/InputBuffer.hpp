@@ -26,7 +26,12 @@ public:
         std::getline(std::cin, buffer);
     }
 
-    [[nodiscard]] auto get_buffer() const -> std::string {
+    // Input that did not come from the console, e.g. a request of a client.
+    auto set_buffer(std::string input) -> void {
+        buffer = std::move(input);
+    }
+
+    [[nodiscard]] auto get_buffer() const -> const std::string& {
         return buffer;
     };
 
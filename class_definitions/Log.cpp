@@ -4,39 +4,448 @@
 
 #include "Log.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
 
-Log::Log() {
-    log_file.open(log_file_name, std::ios::app);
-    if (!log_file.is_open()) {
-        throw std::runtime_error("Log file could not be opened");
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr size_t RECORD_HEADER_SIZE = 4 + 8 + 1 + 8;
+    constexpr size_t CHECKSUM_SIZE = 4;
+    constexpr size_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+    constexpr auto LEGACY_LOG_FILE_NAME = "db.log";
+    constexpr size_t SEGMENT_NAME_SIZE = 3 + 20 + 4; // db.<20 digits>.log
+
+    auto crc32_table() -> const std::array<uint32_t, 256>& {
+        static const auto table = [] {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                }
+                result[i] = value;
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    auto crc32(const char* data, size_t size) -> uint32_t {
+        const auto& table = crc32_table();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    auto put(std::string& out, uint64_t value, int bytes) -> void {
+        for (int i = 0; i < bytes; i++) out.push_back(static_cast<char>(value >> (8 * i) & 0xFF));
+    }
+
+    auto get(const char* in, int bytes) -> uint64_t {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return value;
+    }
+
+    auto sync_file(std::FILE* file) -> void {
+        if (std::fflush(file) != 0) {
+            throw std::runtime_error("Failed to write log file");
+        }
+#if defined(_WIN32)
+        _commit(_fileno(file));
+#else
+        ::fsync(fileno(file));
+#endif
     }
 }
 
+Log::Log(std::string directory) : log_directory(std::move(directory)) {
+    // Logs written before segmentation live in a single db.log file; keep its
+    // records as the first segment.
+    const auto legacy_path = (std::filesystem::path(log_directory) / LEGACY_LOG_FILE_NAME).string();
+    if (std::filesystem::exists(legacy_path)) {
+        std::vector<LogRecord> records;
+        scan(legacy_path, records);
+        if (records.empty()) {
+            std::filesystem::remove(legacy_path);
+        } else {
+            std::filesystem::rename(legacy_path, segment_path(records.front().lsn));
+        }
+    }
+
+    segments = list_segments(log_directory);
+    uint64_t valid_size = 0;
+    for (const auto& [_, path] : segments) {
+        std::vector<LogRecord> records;
+        valid_size = scan(path, records);
+        if (!records.empty()) {
+            next_lsn = records.back().lsn + 1;
+            durable_lsn = records.back().lsn;
+        }
+        for (const auto& record : records) {
+            last_transaction_id = std::max(last_transaction_id, record.transaction_id);
+        }
+    }
+
+    if (segments.empty()) {
+        open_segment(next_lsn);
+        return;
+    }
+
+    // Drop a torn tail left by a crash in the middle of a write. Only the last
+    // segment can have one, older segments were synced before rotating.
+    const auto& active_path = segments.rbegin()->second;
+    if (std::filesystem::file_size(active_path) > valid_size) {
+        std::filesystem::resize_file(active_path, valid_size);
+    }
+    open_segment(segments.rbegin()->first);
+}
+
 Log::~Log() {
-    if (log_file.is_open()) {
-        log_file.close();
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
     }
+    commits_waiting.notify_all();
+    if (window_timer.joinable()) {
+        window_timer.join();
+    }
+
+    if (log_file != nullptr) {
+        try {
+            sync();
+        } catch (const std::exception&) {
+            // Nothing sensible left to do while shutting down.
+        }
+        std::fclose(log_file);
+    }
+}
+
+auto Log::segment_path(uint64_t first_lsn) const -> std::string {
+    char name[32];
+    std::snprintf(name, sizeof(name), "db.%020llu.log", static_cast<unsigned long long>(first_lsn));
+    return (std::filesystem::path(log_directory) / name).string();
 }
 
+auto Log::list_segments(const std::string& directory) -> std::map<uint64_t, std::string> {
+    std::map<uint64_t, std::string> result;
+    if (!std::filesystem::is_directory(directory)) {
+        return result;
+    }
 
-auto Log::get_current_date() -> std::string {
-    const auto now = std::chrono::system_clock::now();
-    const auto date = std::chrono::system_clock::to_time_t(now);
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const auto name = entry.path().filename().string();
+        if (name.size() != SEGMENT_NAME_SIZE || !name.starts_with("db.") || !name.ends_with(".log")) {
+            continue;
+        }
 
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&date), "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+        uint64_t first_lsn = 0;
+        const auto* digits = name.data() + 3;
+        const auto [end, error] = std::from_chars(digits, name.data() + name.size() - 4, first_lsn);
+        if (error == std::errc() && end == name.data() + name.size() - 4) {
+            result.emplace(first_lsn, entry.path().string());
+        }
+    }
+    return result;
 }
 
-auto Log::append_command(const std::string &command) {
-    if (!log_file.is_open()) {
-        throw std::runtime_error("Failed to open log file");
+auto Log::open_segment(uint64_t first_lsn) -> void {
+    const auto path = segment_path(first_lsn);
+    auto* file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+        throw std::runtime_error("Log file could not be opened");
+    }
+    if (log_file != nullptr) {
+        std::fclose(log_file);
     }
 
-    log_file << "[" << get_current_date() << "] " << command << std::endl;
-    log_file.flush();
+    log_file = file;
+    segments[first_lsn] = path;
+    active_segment_size = std::filesystem::file_size(path);
 }
 
+auto Log::encode(LogRecordType type, uint64_t transaction_id, const std::string& table_name,
+                 const std::string& statement, uint64_t redo_lsn) -> uint64_t {
+    std::string payload;
+    if (type == LogRecordType::STATEMENT) {
+        if (statement.size() > UINT32_MAX - table_name.size() - 6) {
+            throw std::runtime_error("Log record too large");
+        }
+        put(payload, table_name.size(), 2);
+        payload += table_name;
+        put(payload, statement.size(), 4);
+        payload += statement;
+    } else if (type == LogRecordType::CHECKPOINT) {
+        put(payload, redo_lsn, 8);
+    }
+
+    const auto lsn = next_lsn++;
+    if (pending.empty()) {
+        pending_first_lsn = lsn;
+    }
+    const auto record_start = pending.size();
+    put(pending, payload.size(), 4);
+    put(pending, lsn, 8);
+    put(pending, static_cast<uint8_t>(type), 1);
+    put(pending, transaction_id, 8);
+    pending += payload;
+    put(pending, crc32(pending.data() + record_start + 4, pending.size() - record_start - 4), 4);
+    return lsn;
+}
+
+auto Log::append_command(uint64_t transaction_id, const std::string& table_name, const std::string& command) -> uint64_t {
+    std::lock_guard lock(mutex);
+    return encode(LogRecordType::STATEMENT, transaction_id, table_name, command);
+}
+
+auto Log::commit(uint64_t transaction_id) -> uint64_t {
+    uint64_t lsn;
+    {
+        std::lock_guard lock(mutex);
+        lsn = encode(LogRecordType::COMMIT, transaction_id, {}, {});
+        pending_commits++;
+
+        if (group_commit_window.count() > 0 && pending_commits < group_commit_size
+            && std::chrono::steady_clock::now() - last_sync < group_commit_window) {
+            commits_waiting.notify_one();
+            return lsn;
+        }
+    }
+
+    flush_to(lsn);
+    return lsn;
+}
+
+auto Log::flush_to(uint64_t lsn) -> void {
+    std::unique_lock lock(mutex);
+    while (durable_lsn < lsn) {
+        if (flushing) {
+            flushed.wait(lock);
+            continue;
+        }
+
+        // Become the leader: write out everything buffered so far, including
+        // records of committers that arrived while the previous fsync ran.
+        flushing = true;
+        std::string batch;
+        batch.swap(pending);
+        const auto batch_lsn = next_lsn - 1;
+        // Start a new segment at a record boundary; the current one was
+        // synced completely by the previous flush.
+        if (!batch.empty() && active_segment_size > 0
+            && (active_segment_size >= segment_size_limit || rotate_requested)) {
+            try {
+                open_segment(pending_first_lsn);
+            } catch (...) {
+                pending.insert(0, batch);
+                flushing = false;
+                flushed.notify_all();
+                throw;
+            }
+        }
+        rotate_requested = false;
+        lock.unlock();
+
+        try {
+            if (!batch.empty() && std::fwrite(batch.data(), 1, batch.size(), log_file) != batch.size()) {
+                throw std::runtime_error("Failed to write log file");
+            }
+            sync_file(log_file);
+        } catch (...) {
+            lock.lock();
+            flushing = false;
+            flushed.notify_all();
+            throw;
+        }
 
+        lock.lock();
+        active_segment_size += batch.size();
+        durable_lsn = batch_lsn;
+        flushing = false;
+        pending_commits = 0;
+        last_sync = std::chrono::steady_clock::now();
+        flushed.notify_all();
+    }
+}
+
+auto Log::sync() -> void {
+    flush_to(get_last_lsn());
+}
+
+auto Log::checkpoint(uint64_t redo_lsn) -> void {
+    uint64_t lsn;
+    {
+        std::lock_guard lock(mutex);
+        // The checkpoint record opens a fresh segment so everything before it
+        // can be removed right away.
+        rotate_requested = true;
+        lsn = encode(LogRecordType::CHECKPOINT, 0, {}, {}, redo_lsn);
+    }
+    flush_to(lsn);
+
+    std::lock_guard lock(mutex);
+    // A segment can go once the next one starts at or before the redo LSN.
+    // The active segment is always kept.
+    for (auto it = segments.begin(); std::next(it) != segments.end();) {
+        if (std::next(it)->first > redo_lsn) {
+            break;
+        }
+        std::filesystem::remove(it->second);
+        it = segments.erase(it);
+    }
+}
+
+auto Log::set_segment_size(uint64_t bytes) -> void {
+    std::lock_guard lock(mutex);
+    segment_size_limit = std::max<uint64_t>(bytes, 1);
+}
+
+auto Log::size_on_disk() -> uint64_t {
+    std::lock_guard lock(mutex);
+    uint64_t total = active_segment_size;
+    for (auto it = segments.begin(); std::next(it) != segments.end(); ++it) {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(it->second, error);
+        total += error ? 0 : size;
+    }
+    return total;
+}
+
+auto Log::set_group_commit(size_t batch_size, std::chrono::milliseconds window) -> void {
+    std::lock_guard lock(mutex);
+    group_commit_size = std::max<size_t>(batch_size, 1);
+    group_commit_window = window;
+    if (window.count() > 0 && !window_timer.joinable()) {
+        window_timer = std::thread(&Log::run_window_timer, this);
+    }
+}
+
+auto Log::run_window_timer() -> void {
+    std::unique_lock lock(mutex);
+    while (!stopping) {
+        if (pending_commits == 0) {
+            commits_waiting.wait(lock);
+            continue;
+        }
+        const auto deadline = last_sync + group_commit_window;
+        if (std::chrono::steady_clock::now() < deadline) {
+            commits_waiting.wait_until(lock, deadline);
+            continue;
+        }
+
+        const auto lsn = next_lsn - 1;
+        lock.unlock();
+        bool failed = false;
+        try {
+            flush_to(lsn);
+        } catch (const std::exception& e) {
+            // The next commit or flush runs into the same error and reports it.
+            std::cerr << "ERROR: Failed to sync the log: " << e.what() << "\n";
+            failed = true;
+        }
+        lock.lock();
+        if (failed) {
+            commits_waiting.wait_for(lock, group_commit_window);
+        }
+    }
+}
+
+auto Log::next_transaction_id() -> uint64_t {
+    std::lock_guard lock(mutex);
+    return ++last_transaction_id;
+}
+
+auto Log::get_last_lsn() -> uint64_t {
+    std::lock_guard lock(mutex);
+    return next_lsn - 1;
+}
+
+auto Log::scan(const std::string& file_name, std::vector<LogRecord>& records) -> uint64_t {
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    uint64_t valid_size = 0;
+    std::string buffer;
+    while (true) {
+        buffer.resize(RECORD_HEADER_SIZE);
+        if (!file.read(buffer.data(), RECORD_HEADER_SIZE)) {
+            break;
+        }
+
+        const auto payload_size = get(buffer.data(), 4);
+        if (payload_size > MAX_PAYLOAD_SIZE) {
+            break;
+        }
+        buffer.resize(RECORD_HEADER_SIZE + payload_size + CHECKSUM_SIZE);
+        if (!file.read(buffer.data() + RECORD_HEADER_SIZE, static_cast<std::streamsize>(payload_size + CHECKSUM_SIZE))) {
+            break;
+        }
+
+        const auto checksum_offset = RECORD_HEADER_SIZE + payload_size;
+        if (crc32(buffer.data() + 4, checksum_offset - 4) != get(buffer.data() + checksum_offset, 4)) {
+            break;
+        }
+
+        LogRecord record;
+        record.lsn = get(buffer.data() + 4, 8);
+        record.type = static_cast<LogRecordType>(buffer[12]);
+        record.transaction_id = get(buffer.data() + 13, 8);
+        if (record.type == LogRecordType::CHECKPOINT) {
+            record.redo_lsn = get(buffer.data() + RECORD_HEADER_SIZE, 8);
+        } else if (record.type == LogRecordType::STATEMENT) {
+            const auto* payload = buffer.data() + RECORD_HEADER_SIZE;
+            const auto table_size = get(payload, 2);
+            record.table_name.assign(payload + 2, table_size);
+            const auto statement_size = get(payload + 2 + table_size, 4);
+            record.statement.assign(payload + 6 + table_size, statement_size);
+        }
+
+        records.push_back(std::move(record));
+        valid_size += buffer.size();
+    }
+    return valid_size;
+}
+
+auto Log::read_records(const std::string& directory) -> std::vector<LogRecord> {
+    std::vector<LogRecord> records;
+    for (const auto& [_, path] : list_segments(directory)) {
+        scan(path, records);
+    }
+    return records;
+}
+
+auto Log::committed_records(const std::vector<LogRecord>& records) -> std::vector<LogRecord> {
+    std::unordered_set<uint64_t> committed;
+    uint64_t redo_lsn = 0;
+    for (const auto& record : records) {
+        if (record.type == LogRecordType::COMMIT) {
+            committed.insert(record.transaction_id);
+        } else if (record.type == LogRecordType::CHECKPOINT) {
+            redo_lsn = record.redo_lsn;
+        }
+    }
+
+    std::vector<LogRecord> result;
+    for (const auto& record : records) {
+        if (record.type == LogRecordType::STATEMENT && record.lsn >= redo_lsn
+            && committed.contains(record.transaction_id)) {
+            result.push_back(record);
+        }
+    }
+    return result;
+}
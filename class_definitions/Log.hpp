@@ -1,19 +1,111 @@
 #ifndef LOG_H
 #define LOG_H
-#include <fstream>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+enum class LogRecordType : uint8_t {
+    STATEMENT = 1,
+    COMMIT = 2,
+    CHECKPOINT = 3,
+};
+
+struct LogRecord {
+    uint64_t lsn = 0;
+    LogRecordType type = LogRecordType::STATEMENT;
+    uint64_t transaction_id = 0;
+    std::string table_name;
+    std::string statement;
+    uint64_t redo_lsn = 0; // CHECKPOINT only
+};
 
+// Write-ahead log.
+//
+// The log is a sequence of segment files db.<FIRST_LSN>.log in the database
+// directory. A new segment is started once the active one exceeds the segment
+// size, and whole segments are removed after a checkpoint.
+//
+// Record layout: PAYLOAD_SIZE (u32) | LSN (u64) | TYPE (u8) | TRANSACTION_ID (u64) | PAYLOAD | CRC32 (u32)
+// STATEMENT payload: TABLE_NAME_SIZE (u16) | TABLE_NAME | STATEMENT_SIZE (u32) | STATEMENT
+// CHECKPOINT payload: REDO_LSN (u64), recovery may start at this LSN
+// The checksum covers everything from LSN to the end of the payload. Reading
+// stops at the first torn or corrupt record.
+//
+// Records are buffered in memory and made durable by flush_to(). Concurrent
+// committers share one fsync (the first waiter writes everything buffered so
+// far); with a group commit window, commits may also return before their fsync
+// and get batched with the following statements. A background thread forces
+// the fsync once the window has passed, so no commit waits longer than that.
 class Log {
 private:
-    std::ofstream log_file;
-    inline auto static log_file_name = "db.log";
-    [[nodiscard]] static auto get_current_date() -> std::string;
+    std::string log_directory;
+    std::map<uint64_t, std::string> segments; // first LSN -> path
+    std::FILE* log_file = nullptr;
+    uint64_t active_segment_size = 0;
+    uint64_t segment_size_limit = 16 * 1024 * 1024;
+
+    std::mutex mutex;
+    std::condition_variable flushed;
+    std::string pending;
+    uint64_t pending_first_lsn = 0;
+    uint64_t next_lsn = 1;
+    uint64_t durable_lsn = 0;
+    uint64_t last_transaction_id = 0;
+    bool flushing = false;
+    bool rotate_requested = false;
+
+    size_t group_commit_size = 1;
+    std::chrono::milliseconds group_commit_window{0};
+    size_t pending_commits = 0;
+    std::chrono::steady_clock::time_point last_sync = std::chrono::steady_clock::now();
+    std::condition_variable commits_waiting;
+    std::thread window_timer; // started with the first group commit window
+    bool stopping = false;
+
+    // Reads valid records and returns the size of the valid prefix of the file.
+    static auto scan(const std::string& file_name, std::vector<LogRecord>& records) -> uint64_t;
+    static auto list_segments(const std::string& directory) -> std::map<uint64_t, std::string>;
+    [[nodiscard]] auto segment_path(uint64_t first_lsn) const -> std::string;
+    auto open_segment(uint64_t first_lsn) -> void;
+    auto encode(LogRecordType type, uint64_t transaction_id, const std::string& table_name,
+                const std::string& statement, uint64_t redo_lsn = 0) -> uint64_t;
+    // Syncs commits that returned early once the window since the last fsync is over.
+    auto run_window_timer() -> void;
 
 public:
-    Log();
+    explicit Log(std::string directory);
     ~Log();
 
-    auto append_command(const std::string &command);
+    // Transaction ids keep growing across restarts, so stale uncommitted records
+    // can never be matched with a new COMMIT.
+    [[nodiscard]] auto next_transaction_id() -> uint64_t;
+    auto append_command(uint64_t transaction_id, const std::string& table_name, const std::string& command) -> uint64_t;
+    auto commit(uint64_t transaction_id) -> uint64_t;
+    // Blocks until every record up to `lsn` is on disk.
+    auto flush_to(uint64_t lsn) -> void;
+    auto sync() -> void;
+
+    // Records that recovery can start at `redo_lsn` and removes the segments
+    // that only hold older records.
+    auto checkpoint(uint64_t redo_lsn) -> void;
+
+    // Commits are forced to disk after `batch_size` commits or once `window`
+    // has passed since the last fsync, whichever comes first.
+    auto set_group_commit(size_t batch_size, std::chrono::milliseconds window) -> void;
+    auto set_segment_size(uint64_t bytes) -> void;
+
+    [[nodiscard]] auto get_last_lsn() -> uint64_t;
+    [[nodiscard]] auto size_on_disk() -> uint64_t;
+    [[nodiscard]] static auto read_records(const std::string& directory) -> std::vector<LogRecord>;
+    // Statement records whose transaction has a COMMIT record, in LSN order,
+    // starting at the redo LSN of the last checkpoint.
+    [[nodiscard]] static auto committed_records(const std::vector<LogRecord>& records) -> std::vector<LogRecord>;
 
     Log(const Log&) = delete;
     Log& operator=(const Log&) = delete;
@@ -0,0 +1,79 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Could not open file for mapping: " + path);
+    }
+
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        throw std::runtime_error("Could not stat file: " + path);
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        return;
+    }
+
+    void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (address == MAP_FAILED) {
+        ::close(descriptor);
+        throw std::runtime_error("Could not map file: " + path);
+    }
+    mapping = static_cast<const char*>(address);
+}
+
+MappedFile::~MappedFile() {
+    if (mapping != nullptr) {
+        ::munmap(const_cast<char*>(mapping), length);
+    }
+    if (descriptor >= 0) {
+        ::close(descriptor);
+    }
+}
+
+auto MappedFile::advise(AccessHint hint) const -> void {
+    if (mapping == nullptr) {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    switch (hint) {
+        case AccessHint::SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case AccessHint::WILLNEED: advice = MADV_WILLNEED; break;
+        case AccessHint::RANDOM: advice = MADV_RANDOM; break;
+    }
+    // Only a hint, failures are harmless.
+    ::madvise(const_cast<char*>(mapping), length, advice);
+}
+
+#else
+#include <fstream>
+
+MappedFile::MappedFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file for mapping: " + path);
+    }
+
+    contents.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+    mapping = contents.data();
+    length = contents.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+auto MappedFile::advise(AccessHint) const -> void {}
+#endif
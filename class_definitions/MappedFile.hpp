@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available, so scans read
+// straight from the page cache without copying into user-space buffers.
+// Other platforms fall back to reading the file into memory once.
+class MappedFile {
+    const char* mapping = nullptr;
+    size_t length = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    int descriptor = -1;
+#else
+    std::vector<char> contents;
+#endif
+
+public:
+    enum class AccessHint {
+        SEQUENTIAL,
+        WILLNEED,
+        RANDOM,
+    };
+
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    auto advise(AccessHint hint) const -> void;
+    [[nodiscard]] auto data() const -> const char* { return mapping; }
+    [[nodiscard]] auto size() const -> size_t { return length; }
+};
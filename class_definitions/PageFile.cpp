@@ -0,0 +1,450 @@
+#include "PageFile.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    auto store_u16(char* out, uint16_t value) -> void {
+        out[0] = static_cast<char>(value & 0xFF);
+        out[1] = static_cast<char>(value >> 8 & 0xFF);
+    }
+
+    auto store_u32(char* out, uint32_t value) -> void {
+        for (int i = 0; i < 4; i++) out[i] = static_cast<char>(value >> (8 * i) & 0xFF);
+    }
+
+    auto store_u64(char* out, uint64_t value) -> void {
+        for (int i = 0; i < 8; i++) out[i] = static_cast<char>(value >> (8 * i) & 0xFF);
+    }
+
+    auto load_u16(const char* in) -> uint16_t {
+        return static_cast<uint16_t>(static_cast<uint8_t>(in[0]) | static_cast<uint8_t>(in[1]) << 8);
+    }
+
+    auto load_u32(const char* in) -> uint32_t {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return value;
+    }
+
+    auto load_u64(const char* in) -> uint64_t {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        return value;
+    }
+
+    auto parse_integer(const std::string& value) -> int64_t {
+        int64_t result = 0;
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+        if (ec != std::errc() || ptr != value.data() + value.size()) {
+            throw std::runtime_error("Invalid INTEGER value: " + value);
+        }
+        return result;
+    }
+
+    auto parse_boolean(const std::string& value) -> uint8_t {
+        if (value == "TRUE" || value == "true" || value == "1") return 1;
+        if (value == "FALSE" || value == "false" || value == "0") return 0;
+        throw std::runtime_error("Invalid BOOLEAN value: " + value);
+    }
+
+    constexpr size_t HEADER_FIELDS_SIZE = 4 + 2 + 4 + 8 + 8 + 4 + 8;
+}
+
+auto DataPageView::row_count() const -> uint16_t {
+    return load_u16(data);
+}
+
+auto DataPageView::used_bytes() const -> uint16_t {
+    return load_u16(data + 2);
+}
+
+auto DataPage::init() -> void {
+    store_u16(writable, 0);
+    store_u16(writable + 2, HEADER_SIZE);
+}
+
+auto DataPage::append(std::string_view encoded_row, size_t page_size) -> bool {
+    const auto used = used_bytes();
+    if (used + encoded_row.size() > page_size) {
+        return false;
+    }
+
+    std::memcpy(writable + used, encoded_row.data(), encoded_row.size());
+    store_u16(writable, row_count() + 1);
+    store_u16(writable + 2, static_cast<uint16_t>(used + encoded_row.size()));
+    return true;
+}
+
+auto RowView::reset(const char*& position) -> void {
+    bitmap = position;
+    position += (columns->size() + 7) / 8;
+
+    for (size_t i = 0; i < columns->size(); i++) {
+        slots[i] = position;
+        switch ((*columns)[i].type) {
+            case ColumnType::INTEGER: position += 8; break;
+            case ColumnType::BOOLEAN: position += 1; break;
+            case ColumnType::TEXT: position += 4 + load_u32(position); break;
+        }
+    }
+}
+
+auto RowView::column_index(std::string_view name) const -> std::optional<size_t> {
+    for (size_t i = 0; i < columns->size(); i++) {
+        if ((*columns)[i].name == name) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+auto RowView::is_null(size_t column) const -> bool {
+    return bitmap[column / 8] >> (column % 8) & 1;
+}
+
+auto RowView::as_integer(size_t column) const -> int64_t {
+    return static_cast<int64_t>(load_u64(slots[column]));
+}
+
+auto RowView::as_boolean(size_t column) const -> bool {
+    return *slots[column] != 0;
+}
+
+auto RowView::as_text(size_t column) const -> std::string_view {
+    return {slots[column] + 4, load_u32(slots[column])};
+}
+
+auto RowView::to_row(const std::vector<std::string>& selected) const -> Row {
+    Row row;
+    for (size_t i = 0; i < columns->size(); i++) {
+        const auto& column = (*columns)[i];
+        if (is_null(i) || (!selected.empty() && std::ranges::find(selected, column.name) == selected.end())) {
+            continue;
+        }
+
+        switch (column.type) {
+            case ColumnType::INTEGER: row.data[column.name] = std::to_string(as_integer(i)); break;
+            case ColumnType::BOOLEAN: row.data[column.name] = as_boolean(i) ? "TRUE" : "FALSE"; break;
+            case ColumnType::TEXT: row.data[column.name] = std::string(as_text(i)); break;
+        }
+    }
+    return row;
+}
+
+PageFile::PageFile(std::string file_path) : path(std::move(file_path)) {
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open data file: " + path);
+    }
+    read_header();
+}
+
+PageFile::PageFile(std::string file_path, std::fstream stream, const PageFileHeader& file_header)
+    : file(std::move(stream)), path(std::move(file_path)), header(file_header) {}
+
+auto PageFile::create(const std::string& file_path, const std::vector<Column>& columns, uint64_t lsn) -> PageFile {
+    std::fstream stream(file_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Could not create data file: " + file_path);
+    }
+
+    PageFileHeader file_header;
+    file_header.version = FORMAT_VERSION;
+    file_header.page_size = PAGE_SIZE;
+    file_header.schema_id = schema_id(columns);
+    file_header.lsn = lsn;
+
+    PageFile page_file(file_path, std::move(stream), file_header);
+    page_file.write_header();
+    return page_file;
+}
+
+auto PageFile::is_page_file(const std::string& file_path) -> bool {
+    std::ifstream stream(file_path, std::ios::binary);
+    char magic[sizeof(MAGIC)] = {};
+    return stream.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+auto PageFile::schema_id(const std::vector<Column>& columns) -> uint64_t {
+    // FNV-1a over column names and types, enough to detect a stale data file.
+    uint64_t hash = 14695981039346656037ULL;
+    const auto mix = [&hash](const std::string_view bytes) {
+        for (const auto byte : bytes) {
+            hash ^= static_cast<uint8_t>(byte);
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    for (const auto& column : columns) {
+        mix(column.name);
+        mix(":");
+        mix(std::to_string(static_cast<int>(column.type)));
+        mix(";");
+    }
+    return hash;
+}
+
+auto PageFile::encode_row(const std::vector<Column>& columns, const Row& row, std::string& out) -> void {
+    out.clear();
+    const auto bitmap_size = (columns.size() + 7) / 8;
+    out.resize(bitmap_size, '\0');
+
+    char buffer[8];
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto& column = columns[i];
+        const auto it = row.data.find(column.name);
+        const bool is_null = it == row.data.end();
+        if (is_null) {
+            out[i / 8] = static_cast<char>(out[i / 8] | 1 << (i % 8));
+        }
+
+        switch (column.type) {
+            case ColumnType::INTEGER:
+                store_u64(buffer, is_null ? 0 : static_cast<uint64_t>(parse_integer(it->second)));
+                out.append(buffer, 8);
+                break;
+            case ColumnType::BOOLEAN:
+                out.push_back(static_cast<char>(is_null ? 0 : parse_boolean(it->second)));
+                break;
+            case ColumnType::TEXT: {
+                const auto length = is_null ? 0 : it->second.size();
+                store_u32(buffer, static_cast<uint32_t>(length));
+                out.append(buffer, 4);
+                if (!is_null) out.append(it->second);
+                break;
+            }
+        }
+    }
+}
+
+auto PageFile::encode_row(const Table& table, size_t row, std::string& out) -> void {
+    const auto& columns = table.get_columns();
+    out.clear();
+    const auto bitmap_size = (columns.size() + 7) / 8;
+    out.resize(bitmap_size, '\0');
+
+    char buffer[8];
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto& data = table.get_column_data(i);
+        const bool is_null = data.is_null(row);
+        if (is_null) {
+            out[i / 8] = static_cast<char>(out[i / 8] | 1 << (i % 8));
+        }
+
+        switch (columns[i].type) {
+            case ColumnType::INTEGER:
+                store_u64(buffer, is_null ? 0 : static_cast<uint64_t>(data.integer_at(row)));
+                out.append(buffer, 8);
+                break;
+            case ColumnType::BOOLEAN:
+                out.push_back(static_cast<char>(!is_null && data.boolean_at(row)));
+                break;
+            case ColumnType::TEXT: {
+                const auto value = is_null ? std::string_view() : data.text_at(row);
+                store_u32(buffer, static_cast<uint32_t>(value.size()));
+                out.append(buffer, 4);
+                out.append(value);
+                break;
+            }
+        }
+    }
+}
+
+auto PageFile::decode_row(const std::vector<Column>& columns, const char*& position) -> Row {
+    Row row;
+    const auto* bitmap = position;
+    position += (columns.size() + 7) / 8;
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto& column = columns[i];
+        const bool is_null = bitmap[i / 8] >> (i % 8) & 1;
+
+        switch (column.type) {
+            case ColumnType::INTEGER:
+                if (!is_null) row.data[column.name] = std::to_string(static_cast<int64_t>(load_u64(position)));
+                position += 8;
+                break;
+            case ColumnType::BOOLEAN:
+                if (!is_null) row.data[column.name] = *position ? "TRUE" : "FALSE";
+                position += 1;
+                break;
+            case ColumnType::TEXT: {
+                const auto length = load_u32(position);
+                position += 4;
+                if (!is_null) row.data[column.name] = std::string(position, length);
+                position += length;
+                break;
+            }
+        }
+    }
+    return row;
+}
+
+auto PageFile::parse_header(const char* buffer, size_t size) -> PageFileHeader {
+    if (size < HEADER_FIELDS_SIZE || std::memcmp(buffer, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a page data file");
+    }
+
+    PageFileHeader parsed;
+    const auto* position = buffer + sizeof(MAGIC);
+    parsed.version = load_u16(position);
+    parsed.page_size = load_u32(position + 2);
+    parsed.schema_id = load_u64(position + 6);
+    parsed.row_count = load_u64(position + 14);
+    parsed.page_count = load_u32(position + 22);
+    // Version 1 headers are zero padded, so the LSN simply reads as 0.
+    parsed.lsn = load_u64(position + 26);
+
+    if (parsed.version > FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported data file version " + std::to_string(parsed.version));
+    }
+    if (parsed.page_size != PAGE_SIZE) {
+        throw std::runtime_error("Unsupported page size in data file");
+    }
+    return parsed;
+}
+
+auto PageFile::read_header() -> void {
+    std::vector<char> buffer(HEADER_FIELDS_SIZE);
+    file.seekg(0);
+    if (!file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+        throw std::runtime_error("Not a page data file: " + path);
+    }
+
+    try {
+        header = parse_header(buffer.data(), buffer.size());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(std::string(e.what()) + ": " + path);
+    }
+}
+
+auto PageFile::write_header() -> void {
+    std::vector<char> buffer(header.page_size, '\0');
+    std::memcpy(buffer.data(), MAGIC, sizeof(MAGIC));
+    auto* position = buffer.data() + sizeof(MAGIC);
+    header.version = FORMAT_VERSION;
+    store_u16(position, header.version);
+    store_u32(position + 2, header.page_size);
+    store_u64(position + 6, header.schema_id);
+    store_u64(position + 14, header.row_count);
+    store_u32(position + 22, header.page_count);
+    store_u64(position + 26, header.lsn);
+    write_page(0, buffer.data());
+}
+
+auto PageFile::read_page(uint32_t page_id, char* buffer) -> void {
+    if (page_id >= header.page_count) {
+        throw std::runtime_error("Page " + std::to_string(page_id) + " out of range in " + path);
+    }
+
+    file.seekg(static_cast<std::streamoff>(page_id) * header.page_size);
+    if (!file.read(buffer, header.page_size)) {
+        throw std::runtime_error("Could not read page " + std::to_string(page_id) + " from " + path);
+    }
+}
+
+auto PageFile::write_page(uint32_t page_id, const char* buffer) -> void {
+    file.seekp(static_cast<std::streamoff>(page_id) * header.page_size);
+    if (!file.write(buffer, header.page_size)) {
+        throw std::runtime_error("Could not write page " + std::to_string(page_id) + " to " + path);
+    }
+}
+
+auto PageFile::allocate_page() -> uint32_t {
+    return header.page_count++;
+}
+
+auto PageFile::flush() -> void {
+    file.flush();
+}
+
+auto PageFile::sync() -> void {
+    flush();
+    if (!file) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    sync_path(path);
+}
+
+auto PageFile::sync_path(const std::string& file_path) -> void {
+#if defined(_WIN32)
+    const auto descriptor = _open(file_path.c_str(), _O_RDWR | _O_BINARY);
+    const bool synced = descriptor >= 0 && _commit(descriptor) == 0;
+    if (descriptor >= 0) _close(descriptor);
+#else
+    const auto descriptor = ::open(file_path.c_str(), O_RDONLY);
+    const bool synced = descriptor >= 0 && ::fsync(descriptor) == 0;
+    if (descriptor >= 0) ::close(descriptor);
+#endif
+    if (!synced) {
+        throw std::runtime_error("Could not sync " + file_path);
+    }
+}
+
+auto PageFile::sync_directory(const std::string& directory) -> void {
+#if !defined(_WIN32)
+    const auto descriptor = ::open(directory.c_str(), O_RDONLY);
+    const bool synced = descriptor >= 0 && ::fsync(descriptor) == 0;
+    if (descriptor >= 0) ::close(descriptor);
+    if (!synced) {
+        throw std::runtime_error("Could not sync directory " + directory);
+    }
+#else
+    (void)directory;
+#endif
+}
+
+auto PageFile::append_rows(const Table& table, size_t first_row) -> void {
+    const auto row_count = table.get_row_count();
+    if (first_row >= row_count) {
+        return;
+    }
+
+    std::vector<char> page(header.page_size);
+    uint32_t page_id;
+    if (header.page_count > 1) {
+        page_id = header.page_count - 1;
+        read_page(page_id, page.data());
+    } else {
+        page_id = allocate_page();
+        DataPage(page.data()).init();
+    }
+
+    std::string encoded;
+    const auto committed = Snapshot::latest();
+    uint64_t written = 0;
+    for (auto i = first_row; i < row_count; i++) {
+        if (!table.is_visible(i, committed)) {
+            continue; // removed, or not committed yet
+        }
+        encode_row(table, i, encoded);
+        if (encoded.size() + DataPage::HEADER_SIZE > header.page_size) {
+            throw std::runtime_error("Row does not fit into a single page");
+        }
+
+        if (!DataPage(page.data()).append(encoded, header.page_size)) {
+            write_page(page_id, page.data());
+            page_id = allocate_page();
+            std::ranges::fill(page, '\0');
+            DataPage(page.data()).init();
+            DataPage(page.data()).append(encoded, header.page_size);
+        }
+        written++;
+    }
+    write_page(page_id, page.data());
+
+    header.row_count += written;
+    write_header();
+    flush();
+}
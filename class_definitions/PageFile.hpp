@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "class_definitions/Table.hpp"
+
+// Binary table data file.
+//
+// Page 0 is the file header, every following page holds rows:
+//   header page: MAGIC | FORMAT_VERSION (u16) | PAGE_SIZE (u32) | SCHEMA_ID (u64) | ROW_COUNT (u64) | PAGE_COUNT (u32)
+//                | LSN (u64, since version 2: last log record contained in the file)
+//   data page:   ROW_COUNT (u16) | USED_BYTES (u16) | ROW | ROW | ...
+//   row:         NULL_BITMAP (1 bit per column) | VALUE | VALUE | ...
+//   value:       INTEGER -> i64, BOOLEAN -> u8, TEXT -> u32 length + bytes
+// INTEGER and BOOLEAN slots are fixed width even when NULL. All numbers are little endian.
+struct PageFileHeader {
+    uint16_t version = 0;
+    uint32_t page_size = 0;
+    uint64_t schema_id = 0;
+    uint64_t row_count = 0;
+    uint32_t page_count = 1;
+    uint64_t lsn = 0;
+};
+
+// Read-only view over one data page buffer.
+class DataPageView {
+protected:
+    const char* data;
+
+public:
+    static constexpr size_t HEADER_SIZE = 4;
+
+    explicit DataPageView(const char* page_data) : data(page_data) {}
+
+    [[nodiscard]] auto row_count() const -> uint16_t;
+    [[nodiscard]] auto used_bytes() const -> uint16_t;
+    [[nodiscard]] auto rows_begin() const -> const char* { return data + HEADER_SIZE; }
+};
+
+// Writable view over one data page buffer.
+class DataPage : public DataPageView {
+    char* writable;
+
+public:
+    explicit DataPage(char* page_data) : DataPageView(page_data), writable(page_data) {}
+
+    auto init() -> void;
+    // Returns false when the encoded row does not fit into the remaining space.
+    auto append(std::string_view encoded_row, size_t page_size) -> bool;
+};
+
+// Zero-copy view of one encoded row. TEXT values point into the underlying
+// buffer, so the view is only valid as long as that buffer is.
+class RowView {
+    const std::vector<Column>* columns = nullptr;
+    const char* bitmap = nullptr;
+    std::vector<const char*> slots;
+
+public:
+    explicit RowView(const std::vector<Column>& row_columns) : columns(&row_columns), slots(row_columns.size()) {}
+
+    // Points the view at the row starting at `position` and advances it past the row.
+    auto reset(const char*& position) -> void;
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& { return *columns; }
+    [[nodiscard]] auto column_index(std::string_view name) const -> std::optional<size_t>;
+    [[nodiscard]] auto is_null(size_t column) const -> bool;
+    [[nodiscard]] auto as_integer(size_t column) const -> int64_t;
+    [[nodiscard]] auto as_boolean(size_t column) const -> bool;
+    [[nodiscard]] auto as_text(size_t column) const -> std::string_view;
+    // Materialises the selected columns (all when empty) as an owning Row.
+    [[nodiscard]] auto to_row(const std::vector<std::string>& selected = {}) const -> Row;
+};
+
+class PageFile {
+    std::fstream file;
+    std::string path;
+    PageFileHeader header;
+
+public:
+    static constexpr char MAGIC[4] = {'C', 'P', 'D', 'B'};
+    static constexpr uint16_t FORMAT_VERSION = 2;
+    static constexpr uint32_t PAGE_SIZE = 8192;
+
+    // Opens an existing page file.
+    explicit PageFile(std::string file_path);
+
+    // Creates (or truncates) a page file for the given schema.
+    static auto create(const std::string& file_path, const std::vector<Column>& columns, uint64_t lsn = 0) -> PageFile;
+    [[nodiscard]] static auto is_page_file(const std::string& file_path) -> bool;
+    [[nodiscard]] static auto schema_id(const std::vector<Column>& columns) -> uint64_t;
+
+    static auto encode_row(const std::vector<Column>& columns, const Row& row, std::string& out) -> void;
+    // Encodes row `row` straight from the typed column vectors of a table.
+    static auto encode_row(const Table& table, size_t row, std::string& out) -> void;
+    // Decodes the row starting at `position` and advances it past the row.
+    static auto decode_row(const std::vector<Column>& columns, const char*& position) -> Row;
+    // Parses a header page; throws when the buffer does not start with MAGIC.
+    static auto parse_header(const char* buffer, size_t size) -> PageFileHeader;
+
+    [[nodiscard]] auto get_header() const -> const PageFileHeader& { return header; }
+    auto read_page(uint32_t page_id, char* buffer) -> void;
+    auto write_page(uint32_t page_id, const char* buffer) -> void;
+    auto allocate_page() -> uint32_t;
+    auto set_row_count(uint64_t row_count) -> void { header.row_count = row_count; }
+    auto set_lsn(uint64_t lsn) -> void { header.lsn = lsn; }
+    auto write_header() -> void;
+    auto flush() -> void;
+    // Flushes and then fsyncs the file, for images that replace another file
+    // or must survive the log records they were written from.
+    auto sync() -> void;
+
+    // fsync of a file written through another stream, and of a directory so a
+    // rename in it is durable (a no-op where directories cannot be synced).
+    static auto sync_path(const std::string& file_path) -> void;
+    static auto sync_directory(const std::string& directory) -> void;
+
+    // Sequential bulk write used for full table images. Only committed rows
+    // are written (see Snapshot::latest).
+    auto append_rows(const Table& table, size_t first_row) -> void;
+
+private:
+    PageFile(std::string file_path, std::fstream stream, const PageFileHeader& file_header);
+    auto read_header() -> void;
+};
@@ -0,0 +1,166 @@
+#include "Predicate.hpp"
+#include "FilterKernels.hpp"
+#include "PageFile.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+    template <WhereOperator Op, typename Value>
+    inline auto compare(const Value& value, const Value& literal) -> bool {
+        if constexpr (Op == WhereOperator::EQUALS) return value == literal;
+        else if constexpr (Op == WhereOperator::GREATER) return value > literal;
+        else if constexpr (Op == WhereOperator::LESS) return value < literal;
+        else if constexpr (Op == WhereOperator::GREATER_EQ) return value >= literal;
+        else return value <= literal;
+    }
+
+    // One instantiation per column type and operator; Predicate::compile picks
+    // the pair for each condition.
+    template <ColumnType Type, WhereOperator Op>
+    struct TermTest {
+        static auto on_view(const RowView& row, size_t column, const PredicateLiteral& literal) -> bool {
+            if (row.is_null(column)) {
+                return false;
+            }
+            if constexpr (Type == ColumnType::INTEGER) return compare<Op>(row.as_integer(column), literal.integer);
+            else if constexpr (Type == ColumnType::BOOLEAN) return compare<Op>(row.as_boolean(column), literal.boolean);
+            else return compare<Op>(row.as_text(column), std::string_view(literal.text));
+        }
+
+        static auto on_column(const ColumnVector& data, size_t row, const PredicateLiteral& literal) -> bool {
+            if (data.is_null(row)) {
+                return false;
+            }
+            if constexpr (Type == ColumnType::INTEGER) return compare<Op>(data.integer_at(row), literal.integer);
+            else if constexpr (Type == ColumnType::BOOLEAN) return compare<Op>(data.boolean_at(row), literal.boolean);
+            else return compare<Op>(data.text_at(row), std::string_view(literal.text));
+        }
+    };
+
+    auto parse_literal(Predicate::Term& term, std::string_view value) -> void {
+        switch (term.type) {
+            case ColumnType::INTEGER: term.literal.integer = ColumnVector::parse_integer(value); break;
+            case ColumnType::BOOLEAN: term.literal.boolean = ColumnVector::parse_boolean(value); break;
+            case ColumnType::TEXT: term.literal.text = value; break;
+        }
+    }
+
+    template <ColumnType Type>
+    auto bind_tests(Predicate::Term& term) -> void {
+        const auto bind = [&term]<WhereOperator Op>() {
+            term.test_view = &TermTest<Type, Op>::on_view;
+            term.test_column = &TermTest<Type, Op>::on_column;
+        };
+
+        switch (term.op) {
+            case WhereOperator::EQUALS: bind.template operator()<WhereOperator::EQUALS>(); break;
+            case WhereOperator::GREATER: bind.template operator()<WhereOperator::GREATER>(); break;
+            case WhereOperator::LESS: bind.template operator()<WhereOperator::LESS>(); break;
+            case WhereOperator::GREATER_EQ: bind.template operator()<WhereOperator::GREATER_EQ>(); break;
+            case WhereOperator::LESS_EQ: bind.template operator()<WhereOperator::LESS_EQ>(); break;
+        }
+    }
+}
+
+auto Predicate::compile(WhereClause where, const std::vector<Column>& columns) -> Predicate {
+    Predicate predicate;
+    predicate.clause = std::move(where);
+
+    for (const auto& condition : predicate.clause.conditions) {
+        const auto it = std::ranges::find_if(columns, [&condition](const Column& column) {
+            return column.name == condition.column;
+        });
+        if (it == columns.end()) {
+            if (predicate.clause.is_and) {
+                predicate.unsatisfiable = true;
+            }
+            continue;
+        }
+
+        Term term;
+        term.column = static_cast<size_t>(it - columns.begin());
+        term.condition = static_cast<size_t>(&condition - predicate.clause.conditions.data());
+        term.type = it->type;
+        term.op = condition.op;
+        switch (it->type) {
+            case ColumnType::INTEGER: bind_tests<ColumnType::INTEGER>(term); break;
+            case ColumnType::BOOLEAN: bind_tests<ColumnType::BOOLEAN>(term); break;
+            case ColumnType::TEXT: bind_tests<ColumnType::TEXT>(term); break;
+        }
+        if (!condition.parameter) {
+            parse_literal(term, condition.value);
+        }
+        predicate.terms.push_back(std::move(term));
+    }
+
+    return predicate;
+}
+
+auto Predicate::bind(const std::vector<std::string>& arguments) -> void {
+    for (auto& condition : clause.conditions) {
+        if (condition.parameter) {
+            if (*condition.parameter >= arguments.size()) {
+                throw std::runtime_error("Missing value for parameter $" + std::to_string(*condition.parameter + 1));
+            }
+            condition.value = arguments[*condition.parameter];
+        }
+    }
+    for (auto& term : terms) {
+        if (clause.conditions[term.condition].parameter) {
+            parse_literal(term, clause.conditions[term.condition].value);
+        }
+    }
+}
+
+auto Predicate::matches(const RowView& row) const -> bool {
+    if (unsatisfiable) {
+        return false;
+    }
+    for (const auto& term : terms) {
+        if (term.test_view(row, term.column, term.literal) != clause.is_and) {
+            return !clause.is_and;
+        }
+    }
+    return clause.is_and;
+}
+
+auto Predicate::matches(const std::vector<ColumnVector>& data, size_t row) const -> bool {
+    if (unsatisfiable) {
+        return false;
+    }
+    for (const auto& term : terms) {
+        if (term.test_column(data[term.column], row, term.literal) != clause.is_and) {
+            return !clause.is_and;
+        }
+    }
+    return clause.is_and;
+}
+
+auto Predicate::select(const std::vector<ColumnVector>& data, size_t first, size_t rows) const
+    -> std::vector<uint64_t> {
+    // Each term yields a selection bitmap, folded in with word-wise AND / OR.
+    const auto words = FilterKernels::words_for(rows);
+    if (unsatisfiable || (terms.empty() && !clause.is_and)) {
+        return std::vector<uint64_t>(words, 0);
+    }
+    if (terms.empty()) {
+        std::vector<uint64_t> all(words, ~uint64_t{0});
+        if (rows % 64 != 0) {
+            all.back() = (uint64_t{1} << (rows % 64)) - 1;
+        }
+        return all;
+    }
+
+    auto matches = data[terms.front().column].select(terms.front().op, terms.front().literal, first, rows);
+    for (size_t i = 1; i < terms.size(); i++) {
+        const auto selection = data[terms[i].column].select(terms[i].op, terms[i].literal, first, rows);
+        if (clause.is_and) {
+            FilterKernels::and_into(matches.data(), selection.data(), words);
+        } else {
+            FilterKernels::or_into(matches.data(), selection.data(), words);
+        }
+    }
+    return matches;
+}
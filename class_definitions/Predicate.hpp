@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "class_definitions/Table.hpp"
+
+// WHERE literal parsed once, according to the type of the column it is compared with.
+struct PredicateLiteral {
+    int64_t integer = 0;
+    bool boolean = false;
+    std::string text;
+};
+
+// A WhereClause bound to one table schema. Column names are resolved to
+// ordinals and literals parsed when the predicate is compiled; each condition
+// keeps pointers to the comparison instantiated for its column type and
+// operator, so evaluating a row does no string work and never switches on
+// the operator.
+class Predicate {
+public:
+    using ViewTest = bool (*)(const RowView& row, size_t column, const PredicateLiteral& literal);
+    using ColumnTest = bool (*)(const ColumnVector& data, size_t row, const PredicateLiteral& literal);
+
+    struct Term {
+        size_t column = 0;
+        size_t condition = 0; // position in the source clause
+        ColumnType type{};
+        WhereOperator op{};
+        PredicateLiteral literal;
+        ViewTest test_view = nullptr;
+        ColumnTest test_column = nullptr;
+    };
+
+private:
+    WhereClause clause;
+    std::vector<Term> terms;
+    // An AND that names a missing column can never match.
+    bool unsatisfiable = false;
+
+public:
+    // Throws when a literal does not parse as the type of its column.
+    // Conditions with a parameter are left unbound until bind().
+    static auto compile(WhereClause where, const std::vector<Column>& columns) -> Predicate;
+    // Fills in the parameters of a compiled predicate; arguments[i] is parameter i.
+    auto bind(const std::vector<std::string>& arguments) -> void;
+
+    // The source clause, for choosing an index.
+    [[nodiscard]] auto get_clause() const -> const WhereClause& { return clause; }
+    [[nodiscard]] auto get_terms() const -> const std::vector<Term>& { return terms; }
+    [[nodiscard]] auto is_and() const -> bool { return clause.is_and; }
+
+    [[nodiscard]] auto matches(const RowView& row) const -> bool;
+    [[nodiscard]] auto matches(const std::vector<ColumnVector>& data, size_t row) const -> bool;
+    // Selection bitmap over rows [first, first + rows) of column-wise data
+    // (see ColumnVector::select).
+    [[nodiscard]] auto select(const std::vector<ColumnVector>& data, size_t first, size_t rows) const
+        -> std::vector<uint64_t>;
+};
@@ -0,0 +1,282 @@
+#include "Protocol.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    auto system_error(const std::string& what) -> std::runtime_error {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    auto send_all(int socket, std::string_view header, std::string_view payload) -> void {
+        std::array<iovec, 2> parts{{
+            {const_cast<char*>(header.data()), header.size()},
+            {const_cast<char*>(payload.data()), payload.size()},
+        }};
+        size_t first = 0;
+        while (first < parts.size()) {
+            msghdr message{};
+            message.msg_iov = parts.data() + first;
+            message.msg_iovlen = parts.size() - first;
+            const auto sent = ::sendmsg(socket, &message, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw system_error("Could not send message");
+            }
+
+            auto left = static_cast<size_t>(sent);
+            while (first < parts.size() && left >= parts[first].iov_len) {
+                left -= parts[first].iov_len;
+                first++;
+            }
+            if (first < parts.size()) {
+                parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + left;
+                parts[first].iov_len -= left;
+            }
+        }
+    }
+
+    // Returns false when the connection is closed before the first byte and
+    // `may_end` is set.
+    auto receive_all(int socket, char* data, size_t size, bool may_end) -> bool {
+        size_t received = 0;
+        while (received < size) {
+            const auto count = ::recv(socket, data + received, size - received, 0);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    // SO_RCVTIMEO ran out.
+                    throw std::runtime_error("Timed out in the middle of a message");
+                }
+                throw system_error("Could not receive message");
+            }
+            if (count == 0) {
+                if (may_end && received == 0) {
+                    return false;
+                }
+                throw std::runtime_error("Connection closed in the middle of a message");
+            }
+            received += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    struct HostPort {
+        std::string host;
+        std::string port;
+    };
+
+    auto split_address(const std::string& address) -> HostPort {
+        HostPort result;
+        std::string rest;
+        if (address.starts_with('[')) {
+            const auto close = address.find(']');
+            if (close == std::string::npos) {
+                throw std::runtime_error("Invalid address: " + address);
+            }
+            result.host = address.substr(1, close - 1);
+            rest = address.substr(close + 1);
+        } else {
+            const auto colon = address.rfind(':');
+            result.host = address.substr(0, colon);
+            rest = colon == std::string::npos ? "" : address.substr(colon);
+        }
+        if (!rest.empty()) {
+            if (rest[0] != ':') {
+                throw std::runtime_error("Invalid address: " + address);
+            }
+            result.port = rest.substr(1);
+        }
+        if (result.port.empty()) {
+            result.port = std::to_string(Protocol::DEFAULT_PORT);
+        }
+        return result;
+    }
+
+    auto unix_address(const std::string& address) -> sockaddr_un {
+        const auto path = address.substr(std::strlen("unix:"));
+        sockaddr_un result{};
+        if (path.empty() || path.size() >= sizeof(result.sun_path)) {
+            throw std::runtime_error("Invalid Unix socket path: " + path);
+        }
+        result.sun_family = AF_UNIX;
+        std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+        return result;
+    }
+
+    // Runs `attempt` on each address HOST:PORT resolves to until one returns
+    // a socket.
+    template <typename Attempt>
+    auto for_resolved(const std::string& address, int flags, Attempt attempt) -> int {
+        const auto [host, port] = split_address(address);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = flags;
+        addrinfo* found = nullptr;
+        if (const auto status = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found);
+            status != 0) {
+            throw std::runtime_error("Could not resolve " + address + ": " + ::gai_strerror(status));
+        }
+
+        int result = -1;
+        int error = 0;
+        for (auto* candidate = found; candidate != nullptr && result < 0; candidate = candidate->ai_next) {
+            result = attempt(*candidate);
+            error = errno;
+        }
+        ::freeaddrinfo(found);
+        if (result < 0) {
+            errno = error;
+            throw system_error("Could not use address " + address);
+        }
+        return result;
+    }
+}
+
+auto Protocol::write_message(int socket, MessageType type, std::string_view payload) -> void {
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+        throw std::runtime_error("Message too large");
+    }
+    const auto size = static_cast<uint32_t>(payload.size());
+    const std::array<char, HEADER_SIZE> header{
+        static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+        static_cast<char>(size >> 8), static_cast<char>(size),
+        static_cast<char>(type),
+    };
+    send_all(socket, {header.data(), header.size()}, payload);
+}
+
+auto Protocol::read_message(int socket, Message& message) -> bool {
+    std::array<unsigned char, HEADER_SIZE> header{};
+    if (!receive_all(socket, reinterpret_cast<char*>(header.data()), header.size(), true)) {
+        return false;
+    }
+
+    const auto size = uint32_t{header[0]} << 24 | uint32_t{header[1]} << 16 | uint32_t{header[2]} << 8 | header[3];
+    if (size > MAX_PAYLOAD_SIZE) {
+        throw std::runtime_error("Message too large");
+    }
+    message.type = static_cast<MessageType>(header[4]);
+    message.payload.resize(size);
+    receive_all(socket, message.payload.data(), size, false);
+    return true;
+}
+
+auto Protocol::listen(const std::string& address) -> int {
+    // Listening sockets are non-blocking: the server accepts until none is left.
+    constexpr int type = SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK;
+    if (is_unix_address(address)) {
+        const auto local = unix_address(address);
+        // A socket file left behind by a server that did not shut down cleanly.
+        if (std::filesystem::is_socket(local.sun_path)) {
+            std::filesystem::remove(local.sun_path);
+        }
+
+        const int socket = ::socket(AF_UNIX, type, 0);
+        if (socket < 0 || ::bind(socket, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0
+            || ::listen(socket, SOMAXCONN) != 0) {
+            const auto error = system_error("Could not listen on " + address);
+            if (socket >= 0) {
+                ::close(socket);
+            }
+            throw error;
+        }
+        return socket;
+    }
+
+    return for_resolved(address, AI_PASSIVE, [](const addrinfo& candidate) {
+        const int socket = ::socket(candidate.ai_family, type, candidate.ai_protocol);
+        if (socket < 0) {
+            return -1;
+        }
+        const int enable = 1;
+        ::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (::bind(socket, candidate.ai_addr, candidate.ai_addrlen) != 0 || ::listen(socket, SOMAXCONN) != 0) {
+            const auto error = errno;
+            ::close(socket);
+            errno = error;
+            return -1;
+        }
+        return socket;
+    });
+}
+
+auto Protocol::connect(const std::string& address) -> int {
+    if (is_unix_address(address)) {
+        const auto local = unix_address(address);
+        const int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket < 0 || ::connect(socket, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+            const auto error = system_error("Could not connect to " + address);
+            if (socket >= 0) {
+                ::close(socket);
+            }
+            throw error;
+        }
+        return socket;
+    }
+
+    return for_resolved(address, 0, [](const addrinfo& candidate) {
+        const int socket = ::socket(candidate.ai_family, SOCK_STREAM | SOCK_CLOEXEC, candidate.ai_protocol);
+        if (socket < 0) {
+            return -1;
+        }
+        if (::connect(socket, candidate.ai_addr, candidate.ai_addrlen) != 0) {
+            const auto error = errno;
+            ::close(socket);
+            errno = error;
+            return -1;
+        }
+        // Queries are small and answered at once; don't hold them back.
+        const int enable = 1;
+        ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        return socket;
+    });
+}
+
+OutputMessageBuffer::OutputMessageBuffer(int connection) : socket(connection) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+auto OutputMessageBuffer::send_buffered() -> bool {
+    const auto size = static_cast<size_t>(pptr() - pbase());
+    if (size > 0 && !failed) {
+        try {
+            Protocol::write_message(socket, MessageType::OUTPUT, {pbase(), size});
+        } catch (const std::exception&) {
+            failed = true;
+        }
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return !failed;
+}
+
+auto OutputMessageBuffer::overflow(int_type character) -> int_type {
+    if (!send_buffered()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(character, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+    return traits_type::not_eof(character);
+}
+
+auto OutputMessageBuffer::sync() -> int {
+    return send_buffered() ? 0 : -1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Messages between the server (see Server) and its clients. Every message is
+// a 4-byte big-endian payload size, a 1-byte type and the payload:
+//
+//   client -> server  QUERY   one statement or meta command, as typed at the prompt
+//   server -> client  OUTPUT  a piece of the text the statement printed
+//                     DONE    result (1 byte, a SqlCommandResults value) | error message
+//
+// Every QUERY is answered by any number of OUTPUT messages and one DONE; the
+// client sends its next query after the DONE. Closing the connection ends
+// the session and rolls back its open transaction.
+enum class MessageType : uint8_t {
+    QUERY = 'Q',
+    OUTPUT = 'O',
+    DONE = 'D',
+};
+
+struct Message {
+    MessageType type = MessageType::QUERY;
+    std::string payload;
+};
+
+struct Protocol {
+    static constexpr size_t HEADER_SIZE = 5;
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+    static constexpr int DEFAULT_PORT = 5433;
+
+    // Throw std::runtime_error when the connection fails.
+    static auto write_message(int socket, MessageType type, std::string_view payload) -> void;
+    // Returns false when the peer closed the connection between messages.
+    static auto read_message(int socket, Message& message) -> bool;
+
+    // Addresses are HOST:PORT (HOST a name, an IPv4 address or an IPv6
+    // address in brackets; PORT defaults to DEFAULT_PORT) or unix:PATH for a
+    // Unix domain socket.
+    [[nodiscard]] static auto listen(const std::string& address) -> int;
+    [[nodiscard]] static auto connect(const std::string& address) -> int;
+    [[nodiscard]] static auto is_unix_address(std::string_view address) -> bool {
+        return address.starts_with("unix:");
+    }
+};
+
+// Stream buffer sending what is written to it as OUTPUT messages of up to
+// CHUNK_SIZE bytes, so a large result reaches the client while it is still
+// being produced. A failed send puts the stream into the bad state.
+class OutputMessageBuffer : public std::streambuf {
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    int socket;
+    std::vector<char> buffer = std::vector<char>(CHUNK_SIZE);
+    bool failed = false;
+
+    auto send_buffered() -> bool;
+
+protected:
+    auto overflow(int_type character) -> int_type override;
+    auto sync() -> int override;
+
+public:
+    explicit OutputMessageBuffer(int connection);
+    [[nodiscard]] auto has_failed() const -> bool { return failed; }
+};
@@ -0,0 +1,101 @@
+#include "ScriptReader.hpp"
+
+namespace {
+    auto is_space(char c) -> bool {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    auto trim_end(std::string& text) -> void {
+        while (!text.empty() && is_space(text.back())) {
+            text.pop_back();
+        }
+    }
+}
+
+auto ScriptReader::read_line() -> bool {
+    if (!std::getline(input, line)) {
+        return false;
+    }
+    // Scripts written on Windows.
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    pos = 0;
+    line_number++;
+    return true;
+}
+
+auto ScriptReader::next(Statement& statement) -> bool {
+    statement.text.clear();
+    bool started = false;
+    bool in_string = false;
+
+    while (true) {
+        if (pos >= line.size()) {
+            if (started) {
+                statement.text += '\n';
+            }
+            if (!read_line()) {
+                break;
+            }
+        }
+
+        if (!started) {
+            while (pos < line.size() && is_space(line[pos])) {
+                pos++;
+            }
+            if (pos >= line.size()) {
+                continue;
+            }
+            if (line.compare(pos, 2, "--") == 0) {
+                pos = line.size();
+                continue;
+            }
+            statement.line = line_number;
+            if (line[pos] == '.') {
+                statement.text = line.substr(pos);
+                pos = line.size();
+                trim_end(statement.text);
+                if (statement.text.ends_with(';')) {
+                    statement.text.pop_back();
+                }
+                return true;
+            }
+            started = true;
+        }
+
+        const auto start = pos;
+        auto end = line.size();
+        bool complete = false;
+        for (; pos < line.size(); pos++) {
+            const auto c = line[pos];
+            if (c == '\'') {
+                in_string = !in_string;
+            } else if (in_string) {
+                continue;
+            } else if (c == ';') {
+                end = pos++;
+                complete = true;
+                break;
+            } else if (c == '-' && pos + 1 < line.size() && line[pos + 1] == '-') {
+                end = pos;
+                pos = line.size();
+                break;
+            }
+        }
+        statement.text.append(line, start, end - start);
+
+        if (complete) {
+            trim_end(statement.text);
+            if (!statement.text.empty()) {
+                return true;
+            }
+            // A stray ';'.
+            started = false;
+        }
+    }
+
+    // The last statement of the script needs no ';'.
+    trim_end(statement.text);
+    return !statement.text.empty();
+}
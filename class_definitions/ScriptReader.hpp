@@ -0,0 +1,30 @@
+#pragma once
+
+#include <istream>
+#include <string>
+
+// Splits a SQL script into statements for batch mode. Statements end with
+// ';' (outside quotes) and may span lines or share one; the last one needs
+// no ';'. A line starting with '.' is a meta command and ends at the end of
+// the line. `--` starts a comment running to the end of the line.
+//
+// The input is read one line at a time, so scripts of any size are streamed.
+class ScriptReader {
+    std::istream& input;
+    std::string line;
+    size_t pos = 0;           // first unread character of `line`
+    size_t line_number = 0;
+
+    auto read_line() -> bool;
+
+public:
+    struct Statement {
+        std::string text; // without the ';'
+        size_t line = 0;  // where it starts, for error messages
+    };
+
+    explicit ScriptReader(std::istream& script) : input(script) {}
+
+    // Returns false at the end of the script.
+    auto next(Statement& statement) -> bool;
+};
@@ -0,0 +1,241 @@
+#include "Server.hpp"
+#include "Protocol.hpp"
+#include "handlers/MetaCommandHandler.hpp"
+#include "handlers/SqlCommandHandler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Server::Session {
+    int socket;
+    OutputMessageBuffer buffer;
+    std::ostream output;
+    SqlCommandHandler handler;
+    std::unique_ptr<InputBuffer> input = std::make_unique<InputBuffer>();
+
+    Session(int connection, std::shared_ptr<DatabasePersistence> db)
+        : socket(connection), buffer(connection), output(&buffer), handler(std::move(db), output) {}
+    ~Session() { ::close(socket); }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+};
+
+Server::Server(std::shared_ptr<DatabasePersistence> database, size_t threads)
+    : db(std::move(database)), thread_count(std::max<size_t>(threads, 1)) {
+    if (::pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        throw std::runtime_error(std::string("Could not create pipe: ") + std::strerror(errno));
+    }
+}
+
+Server::~Server() {
+    for (const auto listener : listeners) {
+        ::close(listener);
+    }
+    for (const auto& path : socket_paths) {
+        ::unlink(path.c_str());
+    }
+    ::close(wake_pipe[0]);
+    ::close(wake_pipe[1]);
+}
+
+auto Server::listen(const std::string& address) -> void {
+    listeners.push_back(Protocol::listen(address));
+    if (Protocol::is_unix_address(address)) {
+        socket_paths.push_back(address.substr(std::strlen("unix:")));
+    }
+}
+
+auto Server::stop() -> void {
+    stopping = true;
+    wake();
+}
+
+auto Server::wake() const -> void {
+    // A full pipe already wakes the poll; nothing to do then.
+    constexpr char signal = 0;
+    [[maybe_unused]] const auto written = ::write(wake_pipe[1], &signal, 1);
+}
+
+auto Server::run() -> void {
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < thread_count; i++) {
+        workers.emplace_back(&Server::worker_loop, this);
+    }
+
+    std::vector<std::shared_ptr<Session>> idle;
+    std::vector<pollfd> polled;
+    while (!stopping) {
+        polled.clear();
+        polled.push_back({wake_pipe[0], POLLIN, 0});
+        for (const auto listener : listeners) {
+            polled.push_back({listener, POLLIN, 0});
+        }
+        for (const auto& session : idle) {
+            polled.push_back({session->socket, POLLIN, 0});
+        }
+        if (::poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "ERROR: Server stopped, poll failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+
+        // Sessions with a query waiting (or a closed connection) go to the
+        // workers; the ones they answered are polled again.
+        std::vector<std::shared_ptr<Session>> still_idle;
+        {
+            std::lock_guard lock(mutex);
+            const auto first_session = 1 + listeners.size();
+            for (size_t i = 0; i < idle.size(); i++) {
+                if (polled[first_session + i].revents != 0) {
+                    ready.push_back(std::move(idle[i]));
+                } else {
+                    still_idle.push_back(std::move(idle[i]));
+                }
+            }
+            if (polled[0].revents != 0) {
+                char drained[64];
+                while (::read(wake_pipe[0], drained, sizeof(drained)) > 0) {}
+                for (auto& session : returned) {
+                    still_idle.push_back(std::move(session));
+                }
+                returned.clear();
+            }
+        }
+        work_available.notify_all();
+        idle = std::move(still_idle);
+
+        for (size_t i = 0; i < listeners.size(); i++) {
+            if (polled[1 + i].revents != 0) {
+                accept_connections(listeners[i], idle);
+            }
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    idle.clear();
+    ready.clear();
+    returned.clear();
+}
+
+auto Server::accept_connections(int listener, std::vector<std::shared_ptr<Session>>& idle) -> void {
+    while (true) {
+        const int connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // EAGAIN: everyone waiting has been accepted.
+            return;
+        }
+
+        // Fails harmlessly on Unix domain sockets.
+        const int enable = 1;
+        ::setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        const timeval send_timeout{static_cast<time_t>(SEND_TIMEOUT.count()), 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        const timeval receive_timeout{static_cast<time_t>(RECEIVE_TIMEOUT.count()), 0};
+        ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+        try {
+            idle.push_back(std::make_shared<Session>(connection, db));
+        } catch (const std::exception& e) {
+            ::close(connection);
+            std::cerr << "WARNING: Could not open session: " << e.what() << "\n";
+        }
+    }
+}
+
+auto Server::worker_loop() -> void {
+    while (true) {
+        std::shared_ptr<Session> session;
+        {
+            std::unique_lock lock(mutex);
+            work_available.wait(lock, [this] { return stopping || !ready.empty(); });
+            if (stopping) {
+                return;
+            }
+            session = std::move(ready.front());
+            ready.pop_front();
+        }
+
+        bool keep = false;
+        try {
+            keep = serve(*session);
+        } catch (const std::exception& e) {
+            std::cerr << "WARNING: Closing connection: " << e.what() << "\n";
+        }
+        if (!keep) {
+            // The last reference: closes the connection and rolls back.
+            session.reset();
+            continue;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            returned.push_back(std::move(session));
+        }
+        wake();
+    }
+}
+
+auto Server::serve(Session& session) const -> bool {
+    Message request;
+    if (!Protocol::read_message(session.socket, request)) {
+        return false;
+    }
+    if (request.type != MessageType::QUERY) {
+        throw std::runtime_error("Unexpected message from client");
+    }
+
+    auto result = SqlCommandResults::SUCCESS;
+    std::string error;
+    session.input->set_buffer(std::move(request.payload));
+    if (session.input->get_buffer() == ".exit") {
+        // Ends the session only; the server keeps running.
+        Protocol::write_message(session.socket, MessageType::DONE, std::string(1, static_cast<char>(result)));
+        return false;
+    }
+    if (session.input->get_buffer_first_char() == '.') {
+        // Meta commands work on the whole database, like CREATE or DROP.
+        std::unique_lock lock(db->statement_latch());
+        try {
+            if (MetaCommandHandler::exec_meta_command(session.input, *db, session.output)
+                == MetaCommandResults::UNRECOGNIZED_COMMAND) {
+                result = SqlCommandResults::UNKNOWN_COMMAND;
+                error = "Unknown meta command " + session.input->get_buffer();
+            }
+        } catch (const std::exception& e) {
+            result = SqlCommandResults::EXECUTION_ERROR;
+            error = e.what();
+        }
+    } else {
+        result = session.handler.exec_sql_command(session.input);
+        error = session.handler.error_message(result);
+    }
+
+    session.output.flush();
+    if (session.buffer.has_failed()) {
+        return false;
+    }
+    Protocol::write_message(session.socket, MessageType::DONE, static_cast<char>(result) + error);
+    return true;
+}
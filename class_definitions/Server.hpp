@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "class_definitions/DatabasePersistence.hpp"
+
+// Serves one database to many clients over TCP and Unix domain sockets (see
+// Protocol). Every connection is a session with its own SqlCommandHandler,
+// so transactions and prepared statements belong to the connection.
+//
+// run() polls the listening sockets and the idle connections. A connection
+// with a query waiting is handed to one of the worker threads, which
+// answers it and gives the connection back, so a few threads serve any
+// number of mostly idle clients. Statements of different sessions run side
+// by side as far as the database allows (see
+// DatabasePersistence::statement_latch).
+class Server {
+    struct Session;
+
+    // A client that stops reading its results is dropped after this long, so
+    // it cannot hold up the statements of other sessions.
+    static constexpr std::chrono::seconds SEND_TIMEOUT{30};
+    // A query is only read once its first bytes have arrived; a client that
+    // stops in the middle of one is dropped after this long, so it cannot
+    // keep a worker thread waiting.
+    static constexpr std::chrono::seconds RECEIVE_TIMEOUT{30};
+
+    std::shared_ptr<DatabasePersistence> db;
+    size_t thread_count;
+    std::vector<int> listeners;
+    std::vector<std::string> socket_paths; // Unix sockets to remove on shutdown
+    int wake_pipe[2] = {-1, -1};
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<std::shared_ptr<Session>> ready;     // a query is waiting
+    std::vector<std::shared_ptr<Session>> returned; // answered, to be polled again
+    std::atomic<bool> stopping{false};
+
+    auto wake() const -> void;
+    auto accept_connections(int listener, std::vector<std::shared_ptr<Session>>& idle) -> void;
+    auto worker_loop() -> void;
+    // Answers one query of the session. Returns false when the session ends.
+    auto serve(Session& session) const -> bool;
+
+public:
+    Server(std::shared_ptr<DatabasePersistence> database, size_t threads);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Opens a listening socket on `address` (see Protocol::listen).
+    auto listen(const std::string& address) -> void;
+    // Serves clients until stop(). Open sessions are closed on return, which
+    // rolls back their transactions.
+    auto run() -> void;
+    // May be called from any thread.
+    auto stop() -> void;
+};
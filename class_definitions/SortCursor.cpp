@@ -0,0 +1,280 @@
+#include "SortCursor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    std::atomic<uint64_t> next_run_id{0};
+
+    template <typename T>
+    auto write_value(std::ofstream& file, T value) -> void {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    auto read_value(std::ifstream& file, T& value) -> bool {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+SortCursor::SortCursor(std::unique_ptr<Cursor> source, size_t sort_column, bool sort_descending,
+                       size_t visible_columns, const RowLimit& row_limit, std::string temp_path, size_t budget)
+    : input(std::move(source)),
+      output(input->get_columns().begin(), input->get_columns().begin() + visible_columns),
+      key(sort_column),
+      key_type(input->get_columns().at(sort_column).type),
+      descending(sort_descending),
+      limit(row_limit),
+      temp_directory(std::move(temp_path)),
+      memory_budget(budget),
+      skip(row_limit.offset),
+      remaining(row_limit.count) {}
+
+SortCursor::~SortCursor() {
+    for (const auto& run : runs) {
+        run->file.close();
+        std::error_code ignored;
+        std::filesystem::remove(run->path, ignored);
+    }
+}
+
+auto SortCursor::before(const SortedRow& a, const SortedRow& b) const -> bool {
+    const auto order = a.values[key].compare(b.values[key], key_type);
+    if (order != 0) {
+        return descending ? order > 0 : order < 0;
+    }
+    return a.sequence < b.sequence;
+}
+
+auto SortCursor::estimate_size(const Tuple& row) -> size_t {
+    auto size = sizeof(SortedRow) + row.capacity() * sizeof(Value);
+    for (const auto& value : row) {
+        size += value.text.capacity();
+    }
+    return size;
+}
+
+auto SortCursor::sort_input() -> void {
+    sorted = true;
+    const auto compare = [this](const SortedRow& a, const SortedRow& b) { return before(a, b); };
+    const bool top_k = limit.end() <= TOP_K_MAX_ROWS;
+
+    size_t buffered_bytes = 0;
+    uint64_t sequence = 0;
+    Tuple values;
+    while (input->next(values)) {
+        SortedRow row{std::move(values), sequence++};
+        values = {};
+        if (top_k) {
+            keep_top(std::move(row));
+            continue;
+        }
+
+        buffered_bytes += estimate_size(row.values);
+        rows.push_back(std::move(row));
+        if (buffered_bytes > memory_budget) {
+            spill();
+            buffered_bytes = 0;
+        }
+    }
+
+    if (top_k) {
+        std::ranges::sort_heap(rows, compare);
+        return;
+    }
+    if (runs.empty()) {
+        std::ranges::sort(rows, compare);
+        return;
+    }
+
+    if (!rows.empty()) {
+        spill();
+    }
+    while (runs.size() > MERGE_WAYS) {
+        auto merged = merge_runs(0, MERGE_WAYS);
+        runs.erase(runs.begin(), runs.begin() + MERGE_WAYS);
+        runs.push_back(std::move(merged));
+    }
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        SortedRow row;
+        if (read_row(*runs[i], row)) {
+            merge_heap.emplace_back(std::move(row), i);
+        }
+    }
+    std::ranges::make_heap(merge_heap, [this](const auto& a, const auto& b) { return before(b.first, a.first); });
+}
+
+auto SortCursor::keep_top(SortedRow&& row) -> void {
+    // Max-heap of the best limit.end() rows seen so far; the front is the
+    // first one to drop.
+    const auto compare = [this](const SortedRow& a, const SortedRow& b) { return before(a, b); };
+    if (rows.size() < limit.end()) {
+        rows.push_back(std::move(row));
+        std::ranges::push_heap(rows, compare);
+    } else if (!rows.empty() && before(row, rows.front())) {
+        std::ranges::pop_heap(rows, compare);
+        rows.back() = std::move(row);
+        std::ranges::push_heap(rows, compare);
+    }
+}
+
+auto SortCursor::spill() -> void {
+    std::ranges::sort(rows, [this](const SortedRow& a, const SortedRow& b) { return before(a, b); });
+
+    std::filesystem::create_directories(temp_directory);
+    auto run = std::make_unique<Run>();
+    run->path = (std::filesystem::path(temp_directory) / ("sort." + std::to_string(next_run_id++) + ".run")).string();
+    {
+        std::ofstream file(run->path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot create sort run: " + run->path);
+        }
+        for (const auto& row : rows) {
+            write_row(file, row);
+        }
+        if (!file.flush()) {
+            throw std::runtime_error("Cannot write sort run: " + run->path);
+        }
+    }
+    run->file.open(run->path, std::ios::binary);
+    runs.push_back(std::move(run));
+
+    rows.clear();
+    rows.shrink_to_fit();
+}
+
+auto SortCursor::merge_runs(size_t first, size_t count) -> std::unique_ptr<Run> {
+    const auto compare = [this](const auto& a, const auto& b) { return before(b.first, a.first); };
+    std::vector<std::pair<SortedRow, size_t>> heap;
+    for (auto i = first; i < first + count; i++) {
+        SortedRow row;
+        if (read_row(*runs[i], row)) {
+            heap.emplace_back(std::move(row), i);
+        }
+    }
+    std::ranges::make_heap(heap, compare);
+
+    auto merged = std::make_unique<Run>();
+    merged->path = (std::filesystem::path(temp_directory) / ("sort." + std::to_string(next_run_id++) + ".run")).string();
+    {
+        std::ofstream file(merged->path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot create sort run: " + merged->path);
+        }
+        while (!heap.empty()) {
+            std::ranges::pop_heap(heap, compare);
+            auto& [row, run] = heap.back();
+            write_row(file, row);
+            if (read_row(*runs[run], row)) {
+                std::ranges::push_heap(heap, compare);
+            } else {
+                heap.pop_back();
+            }
+        }
+        if (!file.flush()) {
+            throw std::runtime_error("Cannot write sort run: " + merged->path);
+        }
+    }
+    merged->file.open(merged->path, std::ios::binary);
+
+    for (auto i = first; i < first + count; i++) {
+        runs[i]->file.close();
+        std::filesystem::remove(runs[i]->path);
+    }
+    return merged;
+}
+
+// Run row: SEQUENCE (u64) | VALUE | VALUE | ...
+// value:   IS_NULL (u8) | INTEGER, BOOLEAN -> i64, TEXT -> u32 length + bytes (absent when NULL)
+auto SortCursor::write_row(std::ofstream& file, const SortedRow& row) const -> void {
+    const auto& columns = input->get_columns();
+    write_value(file, row.sequence);
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto& value = row.values[i];
+        write_value<uint8_t>(file, value.is_null);
+        if (value.is_null) {
+            continue;
+        }
+        if (columns[i].type == ColumnType::TEXT) {
+            write_value(file, static_cast<uint32_t>(value.text.size()));
+            file.write(value.text.data(), static_cast<std::streamsize>(value.text.size()));
+        } else {
+            write_value(file, value.integer);
+        }
+    }
+}
+
+auto SortCursor::read_row(Run& run, SortedRow& row) const -> bool {
+    if (!read_value(run.file, row.sequence)) {
+        return false;
+    }
+
+    const auto& columns = input->get_columns();
+    row.values.resize(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        auto& value = row.values[i];
+        uint8_t is_null = 0;
+        bool complete = read_value(run.file, is_null);
+        value.is_null = is_null != 0;
+        if (complete && !value.is_null) {
+            if (columns[i].type == ColumnType::TEXT) {
+                uint32_t length = 0;
+                complete = read_value(run.file, length);
+                value.text.resize(length);
+                complete = complete && run.file.read(value.text.data(), length);
+            } else {
+                complete = read_value(run.file, value.integer);
+            }
+        }
+        if (!complete) {
+            throw std::runtime_error("Sort run is truncated: " + run.path);
+        }
+    }
+    return true;
+}
+
+auto SortCursor::next_sorted(SortedRow& row) -> bool {
+    if (runs.empty()) {
+        if (position >= rows.size()) {
+            return false;
+        }
+        row = std::move(rows[position++]);
+        return true;
+    }
+
+    if (merge_heap.empty()) {
+        return false;
+    }
+    const auto compare = [this](const auto& a, const auto& b) { return before(b.first, a.first); };
+    std::ranges::pop_heap(merge_heap, compare);
+    auto& [top, run] = merge_heap.back();
+    row = std::move(top);
+    if (read_row(*runs[run], top)) {
+        std::ranges::push_heap(merge_heap, compare);
+    } else {
+        merge_heap.pop_back();
+    }
+    return true;
+}
+
+auto SortCursor::next(Tuple& row) -> bool {
+    if (!sorted) {
+        sort_input();
+    }
+
+    SortedRow sorted_row;
+    while (remaining > 0 && next_sorted(sorted_row)) {
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        remaining--;
+        row = std::move(sorted_row.values);
+        row.resize(output.size());
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "class_definitions/Cursor.hpp"
+
+// ORDER BY column [ASC | DESC] over another cursor. INTEGER and BOOLEAN
+// values compare numerically, TEXT byte-wise; NULL sorts after every value
+// (first with DESC). Rows with equal keys keep their input order.
+//
+// With a LIMIT of at most TOP_K_MAX_ROWS (OFFSET included) only that many
+// rows are kept, in a bounded heap. Otherwise rows are collected up to
+// `memory_budget` bytes; when the input does not fit, every full buffer is
+// sorted and spilled as a run file under `temp_directory`, and the runs are
+// merged MERGE_WAYS at a time. The input is drained by the first next().
+class SortCursor : public Cursor {
+    struct SortedRow {
+        Tuple values;
+        uint64_t sequence; // input position, breaks ties
+    };
+
+    // One spilled run, read back one row at a time.
+    struct Run {
+        std::string path;
+        std::ifstream file;
+    };
+
+    std::unique_ptr<Cursor> input;
+    std::vector<Column> output;
+    size_t key;
+    ColumnType key_type;
+    bool descending;
+    RowLimit limit;
+    std::string temp_directory;
+    size_t memory_budget;
+
+    bool sorted = false;
+    std::vector<SortedRow> rows; // in memory, sorted once the input is drained
+    size_t position = 0;
+    std::vector<std::unique_ptr<Run>> runs;
+    std::vector<std::pair<SortedRow, size_t>> merge_heap; // (row, run)
+    size_t skip;
+    size_t remaining;
+
+    [[nodiscard]] auto before(const SortedRow& a, const SortedRow& b) const -> bool;
+    [[nodiscard]] static auto estimate_size(const Tuple& row) -> size_t;
+    auto sort_input() -> void;
+    auto keep_top(SortedRow&& row) -> void;
+    auto spill() -> void;
+    auto merge_runs(size_t first, size_t count) -> std::unique_ptr<Run>;
+    auto read_row(Run& run, SortedRow& row) const -> bool;
+    auto write_row(std::ofstream& file, const SortedRow& row) const -> void;
+    auto next_sorted(SortedRow& row) -> bool;
+
+public:
+    static constexpr size_t TOP_K_MAX_ROWS = 64 * 1024;
+    static constexpr size_t MERGE_WAYS = 64;
+
+    // `sort_column` indexes the input's columns; only the first
+    // `visible_columns` of them are returned.
+    SortCursor(std::unique_ptr<Cursor> source, size_t sort_column, bool sort_descending, size_t visible_columns,
+               const RowLimit& row_limit, std::string temp_path, size_t budget);
+    ~SortCursor() override;
+    SortCursor(const SortCursor&) = delete;
+    SortCursor& operator=(const SortCursor&) = delete;
+
+    [[nodiscard]] auto get_columns() const -> const std::vector<Column>& override { return output; }
+    auto next(Tuple& row) -> bool override;
+};
@@ -1,8 +1,12 @@
 #include "Table.hpp"
+#include "BTreeIndex.hpp"
+#include "Predicate.hpp"
+#include "PageFile.hpp"
+#include "WorkerPool.hpp"
 #include <stdexcept>
 #include <algorithm>
-
-
+#include <bit>
+#include <charconv>
 
 void Table::add_column(const Column& column) {
     const auto it = std::ranges::find_if(columns,
@@ -27,6 +31,10 @@ void Table::add_column(const Column& column) {
     }
 
     columns.push_back(column);
+    column_data.emplace_back(column.type);
+    for (size_t i = 0; i < row_count; i++) {
+        column_data.back().append_null();
+    }
 }
 
 void Table::set_primary_key(const std::string& column_name) {
@@ -51,8 +59,15 @@ void Table::set_primary_key(const std::string& column_name) {
 
 void Table::insert_row(const Row& row) {
     for (const auto& column : columns) {
-        if (!column.is_nullable && row.data.find(column.name) == row.data.end()) {
-            throw std::runtime_error("Missing required column in row: " + column.name);
+        const auto value = row.data.find(column.name);
+        if (value == row.data.end()) {
+            if (!column.is_nullable) {
+                throw std::runtime_error("Missing required column in row: " + column.name);
+            }
+            continue;
+        }
+        if (!validate_value(value->second, column.type)) {
+            throw std::runtime_error("Invalid value for column " + column.name + ": " + value->second);
         }
     }
 
@@ -62,40 +77,392 @@ void Table::insert_row(const Row& row) {
             throw std::runtime_error("Missing primary key value");
         }
 
-        for (const auto& existing_row : rows) {
-            if (existing_row.data.at(primary_key_column) == pk_value->second) {
-                throw std::runtime_error("Duplicate primary key value: " + pk_value->second);
+        if (primary_key_index.find(column_data[*primary_key_column_index()], pk_value->second)) {
+            throw std::runtime_error("Duplicate primary key value: " + pk_value->second);
+        }
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        const auto value = row.data.find(columns[i].name);
+        if (value == row.data.end()) {
+            column_data[i].append_null();
+        } else {
+            column_data[i].append(value->second);
+        }
+    }
+    add_version(0);
+    index_row(row_count);
+    row_count++;
+}
+
+void Table::insert_row(const RowView& row) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        auto& data = column_data[i];
+        if (row.is_null(i)) {
+            data.append_null();
+            continue;
+        }
+
+        switch (columns[i].type) {
+            case ColumnType::INTEGER: data.append_integer(row.as_integer(i)); break;
+            case ColumnType::BOOLEAN: data.append_boolean(row.as_boolean(i)); break;
+            case ColumnType::TEXT: data.append_text(row.as_text(i)); break;
+        }
+    }
+
+    add_version(0);
+    index_row(row_count);
+    row_count++;
+}
+
+Table::Table(std::string table_name, std::vector<Column> table_columns, std::vector<ColumnVector> data)
+    : name(std::move(table_name)), columns(std::move(table_columns)), column_data(std::move(data)) {
+    if (column_data.size() != columns.size()) {
+        throw std::runtime_error("Column data does not match the columns of table: " + name);
+    }
+    row_count = column_data.empty() ? 0 : column_data.front().size();
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (column_data[i].get_type() != columns[i].type || column_data[i].size() != row_count) {
+            throw std::runtime_error("Column data does not match the columns of table: " + name);
+        }
+        if (columns[i].is_primary_key) {
+            primary_key_column = columns[i].name;
+        }
+    }
+    begin_ts.assign(row_count, 0);
+    end_ts.assign(row_count, Snapshot::NEVER);
+    rebuild_indexes();
+}
+
+Table Table::empty_copy() const {
+    Table copy(name);
+    for (const auto& column : columns) {
+        copy.add_column(column);
+    }
+    return copy;
+}
+
+void Table::check_rows(const Table& rows, const ColumnVector& keys, const HashIndex& key_index) const {
+    check_rows(rows, [&](const ColumnVector& new_keys, size_t row) {
+        return key_index.find(keys, new_keys, row).has_value();
+    });
+}
+
+void Table::check_rows(const Table& rows,
+                       const std::function<bool(const ColumnVector&, size_t)>& key_exists) const {
+    if (rows.columns.size() != columns.size()) {
+        throw std::runtime_error("Rows do not match the columns of table: " + name);
+    }
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (rows.columns[i].type != columns[i].type) {
+            throw std::runtime_error("Rows do not match the columns of table: " + name);
+        }
+        if (columns[i].is_nullable && !columns[i].is_primary_key) {
+            continue;
+        }
+        const auto& data = rows.column_data[i];
+        for (size_t row = 0; row < rows.row_count; row++) {
+            if (data.is_null(row)) {
+                throw std::runtime_error(columns[i].is_primary_key ? "Missing primary key value"
+                                                                   : "Missing required column in row: " + columns[i].name);
             }
         }
     }
 
-    rows.push_back(row);
+    const auto pk = primary_key_column_index();
+    if (!pk) {
+        return;
+    }
+    // New keys are indexed as they are checked, which also catches two equal
+    // keys among the rows themselves.
+    const auto& new_keys = rows.column_data[*pk];
+    HashIndex seen;
+    for (size_t row = 0; row < rows.row_count; row++) {
+        if (key_exists(new_keys, row) || seen.find(new_keys, new_keys, row)) {
+            throw std::runtime_error("Duplicate primary key value: " + new_keys.to_string(row));
+        }
+        seen.insert(new_keys, row);
+    }
+}
+
+void Table::append_rows(const Table& rows, Transaction& transaction) {
+    const std::unique_lock lock(latch->mutex);
+    const auto& snapshot = transaction.get_snapshot();
+    const auto pk = primary_key_column_index();
+    check_rows(rows, [&](const ColumnVector& new_keys, size_t key_row) {
+        bool taken = false;
+        primary_key_index.find(column_data[*pk], new_keys, key_row, [&](size_t row) {
+            taken = holds_key(row, snapshot);
+            return !taken;
+        });
+        return taken;
+    });
+
+    const auto first = row_count;
+    for (size_t i = 0; i < columns.size(); i++) {
+        column_data[i].extend(rows.column_data[i]);
+    }
+    row_count += rows.row_count;
+    for (auto row = first; row < row_count; row++) {
+        add_version(transaction.get_marker());
+        index_row(row);
+    }
+    add_pending(transaction.get_marker(), first, row_count);
+    transaction.touch(shared_from_this());
+}
+
+bool Table::is_settled(size_t row) const {
+    return begin_ts[row] < Snapshot::UNCOMMITTED && end_ts[row] == Snapshot::NEVER;
 }
 
-std::vector<Row> Table::select(const std::vector<std::string>& select_columns,
-                             const std::optional<std::string>& where_condition) {
-    // TODO: Implement WHERE condition parsing
-    std::vector<Row> result;
+void Table::add_version(uint64_t begin) {
+    begin_ts.push_back(begin);
+    end_ts.push_back(Snapshot::NEVER);
+    unsettled += !is_settled(begin_ts.size() - 1);
+}
 
-    if (select_columns.empty()) {
-        return rows;
+void Table::add_pending(uint64_t marker, size_t first, size_t last) {
+    auto& ranges = pending[marker];
+    if (!ranges.empty() && ranges.back().second == first) {
+        ranges.back().second = last;
+    } else {
+        ranges.emplace_back(first, last);
     }
+}
 
-    for (const auto& row : rows) {
-        Row filtered_row;
-        for (const auto& col : select_columns) {
-            auto it = row.data.find(col);
-            if (it != row.data.end()) {
-                filtered_row.data[col] = it->second;
+void Table::end_version(size_t row, Transaction& transaction) {
+    // A version the snapshot sees but that already has an end was removed
+    // by a transaction still running or committed since: it won.
+    if (end_ts[row] != Snapshot::NEVER) {
+        throw std::runtime_error(WRITE_CONFLICT);
+    }
+    unsettled += is_settled(row);
+    end_ts[row] = transaction.get_marker();
+    add_pending(transaction.get_marker(), row, row + 1);
+}
+
+bool Table::holds_key(size_t row, const Snapshot& snapshot) const {
+    const auto begin = begin_ts[row];
+    const auto end = end_ts[row];
+    if (snapshot.sees(begin, end)) {
+        return true;
+    }
+    // Removed by this transaction or by a commit, or never committed at all.
+    if (end == snapshot.writer || begin == Snapshot::NEVER || end < Snapshot::UNCOMMITTED) {
+        return false;
+    }
+    throw std::runtime_error(WRITE_CONFLICT);
+}
+
+void Table::commit_versions(uint64_t marker, uint64_t timestamp) {
+    const std::unique_lock lock(latch->mutex);
+    const auto it = pending.find(marker);
+    if (it == pending.end()) {
+        return;
+    }
+    for (const auto& [first, last] : it->second) {
+        for (auto row = first; row < last; row++) {
+            unsettled += is_settled(row);
+            if (begin_ts[row] == marker) {
+                begin_ts[row] = timestamp;
+            }
+            if (end_ts[row] == marker) {
+                end_ts[row] = timestamp;
+            }
+            unsettled -= is_settled(row);
+        }
+    }
+    newest_commit = timestamp;
+    pending.erase(it);
+}
+
+void Table::abort_versions(uint64_t marker) {
+    const std::unique_lock lock(latch->mutex);
+    const auto it = pending.find(marker);
+    if (it == pending.end()) {
+        return;
+    }
+    for (const auto& [first, last] : it->second) {
+        for (auto row = first; row < last; row++) {
+            unsettled += is_settled(row);
+            if (begin_ts[row] == marker) {
+                // Dead to every snapshot, and collected like a removed version.
+                begin_ts[row] = Snapshot::NEVER;
+                end_ts[row] = 0;
+            } else if (end_ts[row] == marker) {
+                end_ts[row] = Snapshot::NEVER;
             }
+            unsettled -= is_settled(row);
+        }
+    }
+    pending.erase(it);
+}
+
+bool Table::has_pending() const {
+    return !pending.empty();
+}
+
+uint64_t Table::get_newest_commit() const {
+    const std::shared_lock lock(latch->mutex);
+    return newest_commit;
+}
+
+size_t Table::collect_garbage(uint64_t horizon, size_t divisor, size_t* position) {
+    const std::unique_lock lock(latch->mutex);
+    const auto min_rows = std::max<size_t>(divisor == 0 ? 0 : row_count / divisor, 1);
+    if (unsettled < min_rows || !pending.empty() || latch->scans > 0) {
+        return 0;
+    }
+
+    // Removed at or before the horizon (aborted versions end at 0).
+    std::vector<uint8_t> keep(row_count, 1);
+    size_t removed = 0;
+    for (size_t row = 0; row < row_count; row++) {
+        if (end_ts[row] <= horizon) {
+            keep[row] = 0;
+            removed++;
+        }
+    }
+    if (removed < min_rows) {
+        return 0;
+    }
+
+    for (auto& data : column_data) {
+        data.retain(keep);
+    }
+    size_t kept = 0;
+    unsettled = 0;
+    for (size_t row = 0; row < row_count; row++) {
+        if (position && row == *position) {
+            *position = kept;
+            position = nullptr;
+        }
+        if (keep[row]) {
+            begin_ts[kept] = begin_ts[row];
+            end_ts[kept] = end_ts[row];
+            unsettled += !is_settled(kept);
+            kept++;
         }
-        result.push_back(filtered_row);
     }
+    if (position && *position >= row_count) {
+        *position = kept;
+    }
+    begin_ts.resize(kept);
+    end_ts.resize(kept);
+    row_count = kept;
+
+    // Positions after the first removed row have shifted.
+    rebuild_indexes();
+    return removed;
+}
+
+bool Table::sees_all_rows(const Snapshot& snapshot) const {
+    return unsettled == 0 && newest_commit <= snapshot.read_ts;
+}
+
+size_t Table::count_rows(const Snapshot& snapshot) const {
+    const std::shared_lock lock(latch->mutex);
+    if (sees_all_rows(snapshot)) {
+        return row_count;
+    }
+    size_t count = 0;
+    for (size_t row = 0; row < row_count; row++) {
+        count += is_visible(row, snapshot);
+    }
+    return count;
+}
+
+void Table::index_row(size_t row) {
+    if (const auto pk = primary_key_column_index()) {
+        primary_key_index.insert(column_data[*pk], row);
+    }
+    for (const auto& index : indexes) {
+        index->insert(column_data[*column_index(index->get_column_name())], row);
+    }
+}
 
+void Table::rebuild_indexes() {
+    if (const auto pk = primary_key_column_index()) {
+        primary_key_index.rebuild(column_data[*pk]);
+    }
+    for (const auto& index : indexes) {
+        index->build(column_data[*column_index(index->get_column_name())]);
+    }
+}
+
+void Table::add_index(const std::shared_ptr<BTreeIndex>& index) {
+    if (!column_index(index->get_column_name())) {
+        throw std::runtime_error("Column not found: " + index->get_column_name());
+    }
+    indexes.push_back(index);
+}
+
+void Table::remove_index(const std::string& index_name) {
+    std::erase_if(indexes, [&index_name](const auto& index) { return index->get_name() == index_name; });
+}
+
+void Table::set_lsn(uint64_t log_sequence_number) {
+    auto current = latch->lsn.load();
+    while (current < log_sequence_number && !latch->lsn.compare_exchange_weak(current, log_sequence_number)) {
+    }
+}
+
+size_t Table::get_memory_usage() const {
+    const std::shared_lock lock(latch->mutex);
+    size_t size = sizeof(Table) + primary_key_index.memory_usage()
+        + (begin_ts.capacity() + end_ts.capacity()) * sizeof(uint64_t);
+    for (const auto& data : column_data) {
+        size += data.memory_usage();
+    }
+    return size;
+}
+
+std::optional<size_t> Table::column_index(std::string_view column_name) const {
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].name == column_name) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> Table::primary_key_column_index() const {
+    return primary_key_column.empty() ? std::nullopt : column_index(primary_key_column);
+}
+
+std::vector<size_t> Table::resolve_columns(const std::vector<std::string>& names) const {
+    std::vector<size_t> result;
+    if (names.empty()) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            result.push_back(i);
+        }
+        return result;
+    }
+
+    for (const auto& column_name : names) {
+        if (const auto index = column_index(column_name)) {
+            result.push_back(*index);
+        }
+    }
     return result;
 }
 
-void Table::update(const std::string& column, const std::string& value, const std::string& where_condition) {
+Row Table::make_row(size_t row, const std::vector<size_t>& selected) const {
+    Row result;
+    for (const auto column : selected) {
+        if (!column_data[column].is_null(row)) {
+            result.data[columns[column].name] = column_data[column].to_string(row);
+        }
+    }
+    return result;
+}
+
+Row Table::get_row(size_t row) const {
+    return make_row(row, resolve_columns({}));
+}
+
+void Table::update(const std::string& column, const std::string& value, const Predicate* where,
+                   Transaction& transaction) {
     // Sprawdź czy kolumna istnieje
     auto it = std::find_if(columns.begin(), columns.end(),
         [&column](const Column& col) {
@@ -105,43 +472,87 @@ void Table::update(const std::string& column, const std::string& value, const st
     if (it == columns.end()) {
         throw std::runtime_error("Kolumna nie istnieje: " + column);
     }
+    if (!validate_value(value, it->type)) {
+        throw std::runtime_error("Invalid value for column " + column + ": " + value);
+    }
 
-    // Parsuj warunek WHERE
-    if (where_condition.empty()) {
-        // Jeśli nie ma warunku WHERE, zaktualizuj wszystkie wiersze
-        for (auto& row : rows) {
-            row.data[column] = value;
-        }
+    const std::unique_lock lock(latch->mutex);
+    const auto& snapshot = transaction.get_snapshot();
+    const auto rows = find_rows(where, snapshot);
+    if (rows.empty()) {
         return;
     }
-
-    // Format warunku WHERE: "ID = 2"
-    size_t pos = where_condition.find('=');
-    if (pos == std::string::npos) {
-        throw std::runtime_error("Nieprawidłowy warunek WHERE");
+    // Everything is checked before the first version changes.
+    for (const auto row : rows) {
+        if (end_ts[row] != Snapshot::NEVER) {
+            throw std::runtime_error(WRITE_CONFLICT);
+        }
+    }
+    const auto target = static_cast<size_t>(it - columns.begin());
+    if (column == primary_key_column) {
+        if (rows.size() > 1) {
+            throw std::runtime_error("Duplicate primary key value: " + value);
+        }
+        primary_key_index.find(column_data[target], value, [&](size_t row) {
+            if (row != rows.front() && holds_key(row, snapshot)) {
+                throw std::runtime_error("Duplicate primary key value: " + value);
+            }
+            return true;
+        });
     }
 
-    std::string where_column = where_condition.substr(0, pos);
-    std::string where_value = where_condition.substr(pos + 1);
-
-    // Usuń białe znaki
-    where_column.erase(0, where_column.find_first_not_of(" "));
-    where_column.erase(where_column.find_last_not_of(" ") + 1);
-    where_value.erase(0, where_value.find_first_not_of(" "));
-    where_value.erase(where_value.find_last_not_of(" ") + 1);
+    // Aktualizuj tylko wiersze spełniające warunek: each gets a new version
+    // and the old one ends with the transaction.
+    const auto first = row_count;
+    for (const auto row : rows) {
+        end_version(row, transaction);
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (i == target) {
+                column_data[i].append(value);
+            } else {
+                column_data[i].append_from(column_data[i], row);
+            }
+        }
+        add_version(transaction.get_marker());
+        index_row(row_count);
+        row_count++;
+    }
+    add_pending(transaction.get_marker(), first, row_count);
+    transaction.touch(shared_from_this());
+}
 
-    // Aktualizuj tylko wiersze spełniające warunek
-    for (auto& row : rows) {
-        auto where_it = row.data.find(where_column);
-        if (where_it != row.data.end() && where_it->second == where_value) {
-            row.data[column] = value;
+void Table::delete_rows(const Predicate* where, Transaction& transaction) {
+    const std::unique_lock lock(latch->mutex);
+    const auto rows = find_rows(where, transaction.get_snapshot());
+    if (rows.empty()) {
+        return;
+    }
+    for (const auto row : rows) {
+        if (end_ts[row] != Snapshot::NEVER) {
+            throw std::runtime_error(WRITE_CONFLICT);
         }
     }
+    // The rows stay in place until no snapshot sees them any more.
+    for (const auto row : rows) {
+        end_version(row, transaction);
+    }
+    transaction.touch(shared_from_this());
 }
 
-void Table::delete_rows(const std::string& where_condition) {
-    // TODO: Implement WHERE condition parsing
-    rows.clear();
+bool Table::validate_value(const std::string& value, ColumnType type) {
+    switch (type) {
+        case ColumnType::INTEGER: {
+            int64_t parsed = 0;
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+            return ec == std::errc() && ptr == value.data() + value.size();
+        }
+        case ColumnType::BOOLEAN:
+            return value == "TRUE" || value == "FALSE" || value == "true" || value == "false"
+                || value == "1" || value == "0";
+        case ColumnType::TEXT:
+            return true;
+    }
+    return false;
 }
 
 auto Table::string_to_column_type(const std::string& type_str) -> ColumnType {
@@ -160,67 +571,157 @@ auto Table::column_type_to_string(ColumnType type) -> std::string {
     }
 }
 
-std::vector<Row> Table::select_where(const std::vector<std::string>& columns, const WhereClause& where) {
-    std::vector<Row> result;
-    
-    for (const auto& row : rows) {
-        bool matches = where.is_and;
+size_t Table::first_scan_batch(size_t max_rows) {
+    if (max_rows >= max_scan_batch()) {
+        return max_scan_batch();
+    }
+    return std::max<size_t>(1024, (max_rows + 63) / 64 * 64);
+}
 
-        for (const auto& condition : where.conditions) {
-            auto it = row.data.find(condition.column);
-            if (it == row.data.end()) {
-                if (where.is_and) {
-                    matches = false;
-                    break;
+size_t Table::max_scan_batch() {
+    return std::max(SCAN_BATCH_ROWS, MORSEL_ROWS * WorkerPool::shared().get_max_parallelism());
+}
+
+std::vector<uint64_t> Table::select_rows(const Predicate* predicate, const Snapshot& snapshot, size_t first,
+                                         size_t rows) const {
+    const bool filter_versions = !sees_all_rows(snapshot);
+    const auto select = [&](size_t from, size_t count) {
+        std::vector<uint64_t> matches;
+        if (predicate) {
+            matches = predicate->select(column_data, from, count);
+        } else {
+            matches.assign((count + 63) / 64, ~uint64_t{0});
+            if (count % 64 != 0) {
+                matches.back() = (uint64_t{1} << (count % 64)) - 1;
+            }
+        }
+        if (filter_versions) {
+            for (size_t i = 0; i < count; i++) {
+                if (!is_visible(from + i, snapshot)) {
+                    matches[i / 64] &= ~(uint64_t{1} << (i % 64));
                 }
-                continue;
             }
+        }
+        return matches;
+    };
 
-            const std::string& row_value = it->second;
-            bool condition_matches = false;
-
-            switch (condition.op) {
-                case WhereOperator::EQUALS:
-                    condition_matches = (row_value == condition.value);
-                    break;
-                case WhereOperator::GREATER:
-                    condition_matches = (std::stoi(row_value) > std::stoi(condition.value));
-                    break;
-                case WhereOperator::LESS:
-                    condition_matches = (std::stoi(row_value) < std::stoi(condition.value));
-                    break;
-                case WhereOperator::GREATER_EQ:
-                    condition_matches = (std::stoi(row_value) >= std::stoi(condition.value));
-                    break;
-                case WhereOperator::LESS_EQ:
-                    condition_matches = (std::stoi(row_value) <= std::stoi(condition.value));
-                    break;
+    const auto morsels = (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+    if (morsels <= 1) {
+        return select(first, rows);
+    }
+
+    std::vector<uint64_t> selection((rows + 63) / 64, 0);
+    WorkerPool::shared().run(morsels, [&](size_t morsel) {
+        const auto offset = morsel * MORSEL_ROWS;
+        const auto matches = select(first + offset, std::min(MORSEL_ROWS, rows - offset));
+        std::ranges::copy(matches, selection.begin() + static_cast<std::ptrdiff_t>(offset / 64));
+    });
+    return selection;
+}
+
+std::vector<size_t> Table::find_rows(const Predicate* predicate, const Snapshot& snapshot, size_t max_rows) const {
+    if (predicate) {
+        if (auto rows = lookup_rows(*predicate, snapshot, max_rows)) {
+            return std::move(*rows);
+        }
+    }
+
+    std::vector<size_t> result;
+    size_t first = 0;
+    auto batch_rows = first_scan_batch(max_rows);
+    while (first < row_count && result.size() < max_rows) {
+        const auto rows = std::min(batch_rows, row_count - first);
+        const auto matches = select_rows(predicate, snapshot, first, rows);
+        for (size_t word = 0; word < matches.size(); word++) {
+            for (auto bits = matches[word]; bits != 0 && result.size() < max_rows; bits &= bits - 1) {
+                result.push_back(first + word * 64 + static_cast<size_t>(std::countr_zero(bits)));
             }
+        }
+        first += rows;
+        batch_rows = std::min(batch_rows * 2, max_scan_batch());
+    }
+    return result;
+}
 
-            if (where.is_and) {
-                matches &= condition_matches;  // AND
-                if (!matches) break;  // optymalizacja dla AND
-            } else {
-                matches |= condition_matches;  // OR
-                if (matches) break;   // optymalizacja dla OR
+std::optional<std::vector<size_t>> Table::lookup_rows(const Predicate& predicate, const Snapshot& snapshot,
+                                                      size_t max_rows) const {
+    if (max_rows == 0) {
+        return std::vector<size_t>{};
+    }
+    const auto& where = predicate.get_clause();
+    // With AND any primary key equality pins the result to at most one row
+    // (a snapshot sees one version of it); with OR that only holds when it is
+    // the only condition.
+    const auto pk = primary_key_column_index();
+    if (pk && (where.is_and || where.conditions.size() == 1)) {
+        for (const auto& condition : where.conditions) {
+            if (condition.column != primary_key_column || condition.op != WhereOperator::EQUALS) {
+                continue;
             }
+
+            std::vector<size_t> rows;
+            primary_key_index.find(column_data[*pk], condition.value, [&](size_t row) {
+                if (!is_visible(row, snapshot)) {
+                    return true;
+                }
+                if (predicate.matches(column_data, row)) {
+                    rows.push_back(row);
+                }
+                return false;
+            });
+            return rows;
         }
-        
-        if (matches) {
-            if (columns.empty()) {
-                result.push_back(row);
-            } else {
-                Row filtered_row;
-                for (const auto& col : columns) {
-                    auto it = row.data.find(col);
-                    if (it != row.data.end()) {
-                        filtered_row.data[col] = it->second;
-                    }
+    }
+
+    if (indexes.empty() || (!where.is_and && where.conditions.size() != 1)) {
+        return std::nullopt;
+    }
+
+    // Any indexed condition of an AND narrows the candidates; the rest of the
+    // clause is checked on those rows only.
+    for (const auto& condition : where.conditions) {
+        const auto it = std::ranges::find_if(indexes, [&condition](const auto& index) {
+            return index->get_column_name() == condition.column;
+        });
+        if (it == indexes.end()) {
+            continue;
+        }
+
+        const auto column = *column_index(condition.column);
+        std::vector<size_t> rows;
+        if (condition.op == WhereOperator::EQUALS) {
+            // Equal keys are ordered by row, so the walk can stop at the limit.
+            (*it)->find(columns[column].type, condition.op, condition.value, [&](size_t row) {
+                if (is_visible(row, snapshot) && predicate.matches(column_data, row)) {
+                    rows.push_back(row);
                 }
-                result.push_back(filtered_row);
+                return rows.size() < max_rows;
+            });
+            return rows;
+        }
+
+        auto candidates = (*it)->find(columns[column].type, condition.op, condition.value);
+        std::ranges::sort(candidates);
+        for (const auto row : candidates) {
+            if (rows.size() == max_rows) {
+                break;
+            }
+            if (is_visible(row, snapshot) && predicate.matches(column_data, row)) {
+                rows.push_back(row);
             }
         }
+        return rows;
+    }
+    return std::nullopt;
+}
+
+Row Table::project(const Row& row, const std::vector<std::string>& columns) {
+    Row filtered_row;
+    for (const auto& col : columns) {
+        auto it = row.data.find(col);
+        if (it != row.data.end()) {
+            filtered_row.data[col] = it->second;
+        }
     }
-    
-    return result;
-}
\ No newline at end of file
+    return filtered_row;
+}
@@ -4,8 +4,17 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <cstdint>
 #include <optional>
+#include <limits>
+#include <string_view>
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
 #include <types/enums.hpp>
+#include "class_definitions/ColumnVector.hpp"
+#include "class_definitions/HashIndex.hpp"
+#include "class_definitions/Transaction.hpp"
 
 struct Column
 {
@@ -15,11 +24,17 @@ struct Column
     bool is_nullable = true;
 };
 
+// Owning row of text values keyed by column name. Tables keep their data in
+// typed column vectors; Row is only used to pass values in and out.
 struct Row
 {
     std::unordered_map<std::string, std::string> data;
 };
 
+class RowView;
+class BTreeIndex;
+class Predicate;
+
 enum class WhereOperator {
     EQUALS,
     GREATER,
@@ -32,6 +47,8 @@ struct WhereCondition {
     std::string column;
     WhereOperator op;
     std::string value;
+    // Set for a prepared statement placeholder; the value is bound on execution.
+    std::optional<size_t> parameter;
 };
 
 struct WhereClause {
@@ -39,38 +56,198 @@ struct WhereClause {
     bool is_and = false;
 };
 
-class Table
+// LIMIT / OFFSET: matching rows to skip, then the most rows to return.
+struct RowLimit {
+    size_t offset = 0;
+    size_t count = std::numeric_limits<size_t>::max();
+
+    // Matching rows a scan has to find before it can stop.
+    [[nodiscard]] size_t end() const {
+        return count > std::numeric_limits<size_t>::max() - offset ? std::numeric_limits<size_t>::max() : offset + count;
+    }
+};
+
+// Rows are versioned (MVCC): every stored row is one version of a row,
+// created and removed at the commit timestamps kept next to it (see
+// Snapshot). An update appends a new version and ends the old one, a delete
+// only ends it, and each reader filters the versions by its snapshot. Old
+// versions stay until collect_garbage() finds no snapshot that still sees
+// them. Two transactions changing the same row conflict: the second one to
+// try fails at once (first writer wins).
+//
+// Readers hold the latch shared while they look at one batch of rows and
+// writers hold it exclusively for one change, so a long scan and a stream of
+// inserts only ever wait for each other briefly. Row positions are stable
+// while a scan is open (begin_scan / end_scan).
+class Table : public std::enable_shared_from_this<Table>
 {
     std::string name;
     std::vector<Column> columns;
-    std::vector<Row> rows;
+    std::vector<ColumnVector> column_data; // parallel to columns
+    size_t row_count = 0;
     std::string primary_key_column;
+    HashIndex primary_key_index; // every version, so a key may map to several rows
+    std::vector<std::shared_ptr<BTreeIndex>> indexes; // secondary, see CREATE INDEX
+
+    std::vector<uint64_t> begin_ts; // per row: commit that created it, or a writer marker
+    std::vector<uint64_t> end_ts;   // per row: commit that removed it, a marker or NEVER
+    // Rows changed by transactions still in progress, as [first, last)
+    // ranges by writer marker.
+    std::unordered_map<uint64_t, std::vector<std::pair<size_t, size_t>>> pending;
+    size_t unsettled = 0;       // versions that are not simply committed and live
+    uint64_t newest_commit = 0; // latest timestamp stamped on a version
+
+    struct Latch {
+        std::shared_mutex mutex;
+        std::atomic<size_t> scans{0};
+        std::atomic<uint64_t> lsn{0}; // last write-ahead log record applied to this table
+    };
+    std::unique_ptr<Latch> latch = std::make_unique<Latch>();
 
 private:
-    static bool validate_value(const std::string& value, ColumnType type);
+    // Positions of the first `max_rows` rows visible to `snapshot` that match
+    // the predicate (all visible rows without one), from lookup_rows() or a
+    // scan that stops once it has found them.
+    [[nodiscard]] std::vector<size_t> find_rows(const Predicate* predicate, const Snapshot& snapshot,
+                                                size_t max_rows = std::numeric_limits<size_t>::max()) const;
+    [[nodiscard]] std::optional<size_t> primary_key_column_index() const;
+    void index_row(size_t row);
+    // Versions: a committed, live row is settled.
+    [[nodiscard]] bool is_settled(size_t row) const;
+    void add_version(uint64_t begin);
+    void add_pending(uint64_t marker, size_t first, size_t last);
+    // Ends the visible version `row` for the transaction; throws when another
+    // transaction has changed the row since the snapshot was taken.
+    void end_version(size_t row, Transaction& transaction);
+    // Whether version `row` keeps the transaction from using its primary key:
+    // true when the transaction sees it. Throws when a concurrent transaction
+    // has added or is removing the key.
+    [[nodiscard]] bool holds_key(size_t row, const Snapshot& snapshot) const;
+    void check_rows(const Table& rows, const std::function<bool(const ColumnVector&, size_t)>& key_exists) const;
+    void rebuild_indexes();
+    [[nodiscard]] std::vector<size_t> resolve_columns(const std::vector<std::string>& names) const;
+    [[nodiscard]] Row make_row(size_t row, const std::vector<size_t>& selected) const;
     static std::string column_type_to_string(ColumnType type);
     static ColumnType string_to_column_type(const std::string& type_str);
 
 public:
+    // Rows filtered per batch by scans. A scan with a row limit starts with a
+    // batch sized to the limit and doubles it while it needs more rows.
+    static constexpr size_t SCAN_BATCH_ROWS = 64 * 1024;
+    [[nodiscard]] static size_t first_scan_batch(size_t max_rows);
+    // Rows per task of a parallel scan (see WorkerPool). A multiple of 64, so
+    // the selection bitmaps of consecutive morsels simply concatenate.
+    static constexpr size_t MORSEL_ROWS = 16 * 1024;
+    // Largest scan batch: SCAN_BATCH_ROWS, or one morsel per thread a query
+    // may use when that is more.
+    [[nodiscard]] static size_t max_scan_batch();
+
+    // A transaction changed a row that another one changed first.
+    static constexpr auto WRITE_CONFLICT = "Could not serialize access: row changed by a concurrent transaction";
+
     explicit Table(std::string table_name) : name(std::move(table_name)) {}
+    // Table over already typed column data, one vector per column, e.g. rows
+    // parsed by COPY. NOT NULL and primary keys are checked when the rows are
+    // appended to a stored table, not here.
+    Table(std::string table_name, std::vector<Column> table_columns, std::vector<ColumnVector> data);
 
     void add_column(const Column &column);
     void set_primary_key(const std::string &column_name);
-    void add_foreign_key(const std::string &column_name,
-                         const std::string &foreign_table,
-                         const std::string &foreign_column);
 
+    // Rows added outside of any transaction, visible to every snapshot: for
+    // tables being built, e.g. a batch of rows to insert.
     void insert_row(const Row &row);
-    std::vector<Row> select(const std::vector<std::string> &columns,
-                            const std::optional<std::string> &where_condition = std::nullopt);
+    // Appends a row read back from a data file; values were validated when written.
+    void insert_row(const RowView &row);
+    // Appends every row of `rows` (a table with the same columns) as versions
+    // of `transaction`, all or none: the rows are checked against the
+    // versions it sees (see check_rows) before anything changes.
+    void append_rows(const Table &rows, Transaction &transaction);
+    // Throws unless `rows` can be appended to a table whose primary keys are
+    // `keys`, indexed by `key_index`: NOT NULL columns hold values and every
+    // primary key is present, new and unique within `rows`.
+    void check_rows(const Table &rows, const ColumnVector &keys, const HashIndex &key_index) const;
+    // Same name and columns, no rows.
+    [[nodiscard]] Table empty_copy() const;
+    // Change the rows matching `where` (all rows without one).
     void update(const std::string &column,
                 const std::string &value,
-                const std::string &where_condition);
-    void delete_rows(const std::string &where_condition);
-    std::vector<Row> select_where(const std::vector<std::string>& columns, const WhereClause& where);
+                const Predicate *where,
+                Transaction &transaction);
+    void delete_rows(const Predicate *where, Transaction &transaction);
+
+    // Stamps the versions written by the transaction with `marker` with its
+    // commit timestamp.
+    void commit_versions(uint64_t marker, uint64_t timestamp);
+    // Drops the versions the transaction created and revives those it ended.
+    void abort_versions(uint64_t marker);
+    // The caller holds the latch.
+    [[nodiscard]] bool has_pending() const;
+    // Removes the versions no snapshot from `horizon` on can see, once they
+    // make up at least one `divisor`-th of the stored rows (any number with
+    // 0), no transaction has versions in progress and no scan is open. Rows
+    // move, so the indexes are rebuilt; a row position passed as `position`
+    // (such as the end of the rows already written) moves with them. Returns
+    // the number of rows removed.
+    size_t collect_garbage(uint64_t horizon, size_t divisor = 0, size_t* position = nullptr);
+    // Latest commit timestamp stamped on a version; a copy of the table
+    // loaded again from its file is only the same for snapshots from then on.
+    [[nodiscard]] uint64_t get_newest_commit() const;
+
+    // Row-level helpers shared with the streaming (buffer pool) paths.
+    static Row project(const Row& row, const std::vector<std::string>& columns);
+    static bool validate_value(const std::string& value, ColumnType type);
+
+    // Secondary indexes are kept up to date by every change to the table.
+    void add_index(const std::shared_ptr<BTreeIndex>& index);
+    void remove_index(const std::string& index_name);
+    [[nodiscard]] const std::vector<std::shared_ptr<BTreeIndex>>& get_indexes() const { return indexes; }
+
+    // Readers take the latch shared around every use of the row data below
+    // (lookup_rows, select_rows, get_column_data, ...); the methods that
+    // change the table take it exclusively themselves.
+    [[nodiscard]] std::shared_lock<std::shared_mutex> read_latch() const { return std::shared_lock(latch->mutex); }
+    // An open scan keeps collect_garbage() from moving rows under it.
+    void begin_scan() const { ++latch->scans; }
+    void end_scan() const { --latch->scans; }
+
+    // Visible matching rows in ascending order when the predicate can be
+    // answered without a scan: an equality on the primary key (hash index) or
+    // a condition on a column with a B+tree index. nullopt otherwise. At most
+    // `max_rows` are returned; an equality walks the index only that far.
+    [[nodiscard]] std::optional<std::vector<size_t>> lookup_rows(
+        const Predicate& predicate, const Snapshot& snapshot,
+        size_t max_rows = std::numeric_limits<size_t>::max()) const;
+
+    // Selection bitmap of the rows in [first, first + rows) visible to
+    // `snapshot` that match `predicate` (every visible row when null; see
+    // Predicate::select), filtered one morsel per task in parallel. `first`
+    // must be a multiple of 64.
+    [[nodiscard]] std::vector<uint64_t> select_rows(const Predicate* predicate, const Snapshot& snapshot,
+                                                    size_t first, size_t rows) const;
+    // Whether `snapshot` sees every stored row, so row positions can stand in
+    // for visible rows.
+    [[nodiscard]] bool sees_all_rows(const Snapshot& snapshot) const;
+    [[nodiscard]] bool is_visible(size_t row, const Snapshot& snapshot) const {
+        return snapshot.sees(begin_ts[row], end_ts[row]);
+    }
+    // Rows `snapshot` sees; takes the latch itself.
+    [[nodiscard]] size_t count_rows(const Snapshot& snapshot) const;
+
+    [[nodiscard]] std::optional<size_t> column_index(std::string_view column_name) const;
+    // Materialises one row; NULL values are left out like in a stored Row.
+    [[nodiscard]] Row get_row(size_t row) const;
     // Gettery
     [[nodiscard]] const std::string &get_name() const { return name; }
     [[nodiscard]] const std::vector<Column> &get_columns() const { return columns; }
-    [[nodiscard]] const std::vector<Row> &get_rows() const { return rows; }
+    [[nodiscard]] const ColumnVector &get_column_data(size_t column) const { return column_data[column]; }
+    [[nodiscard]] const std::vector<ColumnVector> &get_column_vectors() const { return column_data; }
+    // Stored row versions, including removed ones not collected yet.
+    [[nodiscard]] size_t get_row_count() const { return row_count; }
     [[nodiscard]] const std::string &get_primary_key_column() const { return primary_key_column; }
+    [[nodiscard]] size_t get_memory_usage() const;
+    [[nodiscard]] uint64_t get_lsn() const { return latch->lsn; }
+    // Never moves back: statements of several sessions may change the table
+    // and finish out of log order.
+    void set_lsn(uint64_t log_sequence_number);
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "TableCache.hpp"
+
+#include <algorithm>
+
+auto TableCache::find(const std::string& table_name) -> std::shared_ptr<Table> {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    if (it == entries.end()) {
+        return nullptr;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lru_position);
+    return it->second.table;
+}
+
+auto TableCache::peek(const std::string& table_name) const -> std::shared_ptr<Table> {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    return it == entries.end() ? nullptr : it->second.table;
+}
+
+auto TableCache::insert(const std::shared_ptr<Table>& table) -> void {
+    std::lock_guard lock(mutex);
+    const auto& table_name = table->get_name();
+    if (const auto it = entries.find(table_name); it != entries.end()) {
+        it->second.table = table;
+        lru.splice(lru.begin(), lru, it->second.lru_position);
+        return;
+    }
+
+    lru.push_front(table_name);
+    entries.emplace(table_name, Entry{table, false, false, table->get_row_count(), 0, 0, lru.begin()});
+}
+
+auto TableCache::erase(const std::string& table_name) -> void {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    if (it == entries.end()) {
+        return;
+    }
+
+    lru.erase(it->second.lru_position);
+    entries.erase(it);
+}
+
+auto TableCache::mark_dirty(const std::string& table_name, uint64_t lsn) -> void {
+    std::lock_guard lock(mutex);
+    if (const auto it = entries.find(table_name); it != entries.end()) {
+        // Changes may be marked out of log order.
+        it->second.recovery_lsn = it->second.dirty ? std::min(it->second.recovery_lsn, lsn) : lsn;
+        it->second.dirty = true;
+        it->second.needs_rewrite = true;
+        it->second.generation++;
+    }
+}
+
+auto TableCache::mark_appended(const std::string& table_name, uint64_t lsn) -> void {
+    std::lock_guard lock(mutex);
+    if (const auto it = entries.find(table_name); it != entries.end()) {
+        it->second.recovery_lsn = it->second.dirty ? std::min(it->second.recovery_lsn, lsn) : lsn;
+        it->second.dirty = true;
+        it->second.generation++;
+    }
+}
+
+auto TableCache::is_dirty(const std::string& table_name) const -> bool {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    return it != entries.end() && it->second.dirty;
+}
+
+auto TableCache::begin_flush(const std::string& table_name) -> std::optional<Flush> {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+
+    // With the latch held no change can start, and every committed one is
+    // already marked.
+    auto latch = it->second.table->read_latch();
+    if (it->second.table->has_pending()) {
+        return std::nullopt;
+    }
+    return Flush{std::move(latch), it->second.needs_rewrite, it->second.persisted_rows, it->second.generation};
+}
+
+auto TableCache::end_flush(const std::string& table_name, uint64_t generation, size_t row_count) -> void {
+    std::lock_guard lock(mutex);
+    const auto it = entries.find(table_name);
+    if (it == entries.end()) {
+        return;
+    }
+
+    it->second.persisted_rows = row_count;
+    if (it->second.generation == generation) {
+        it->second.dirty = false;
+        it->second.needs_rewrite = false;
+    }
+}
+
+auto TableCache::collect_garbage(uint64_t horizon, size_t divisor) -> void {
+    std::lock_guard lock(mutex);
+    for (auto& [_, entry] : entries) {
+        if (entry.dirty && !entry.needs_rewrite) {
+            continue;
+        }
+        // A change not marked yet is still in progress, and the table refuses
+        // to collect, so the file of a clean table keeps matching its rows.
+        entry.table->collect_garbage(horizon, divisor, &entry.persisted_rows);
+    }
+}
+
+auto TableCache::dirty_tables() const -> std::vector<std::shared_ptr<Table>> {
+    std::lock_guard lock(mutex);
+    std::vector<std::shared_ptr<Table>> result;
+    for (const auto& [_, entry] : entries) {
+        if (entry.dirty) {
+            result.push_back(entry.table);
+        }
+    }
+    return result;
+}
+
+auto TableCache::tables() const -> std::vector<std::shared_ptr<Table>> {
+    std::lock_guard lock(mutex);
+    std::vector<std::shared_ptr<Table>> result;
+    for (const auto& [_, entry] : entries) {
+        result.push_back(entry.table);
+    }
+    return result;
+}
+
+auto TableCache::min_recovery_lsn() const -> std::optional<uint64_t> {
+    std::lock_guard lock(mutex);
+    std::optional<uint64_t> result;
+    for (const auto& [_, entry] : entries) {
+        if (entry.dirty && (!result || entry.recovery_lsn < *result)) {
+            result = entry.recovery_lsn;
+        }
+    }
+    return result;
+}
+
+auto TableCache::eviction_candidates() const -> std::vector<std::string> {
+    std::lock_guard lock(mutex);
+    return {lru.rbegin(), lru.rend()};
+}
+
+auto TableCache::evict_clean(uint64_t horizon) -> void {
+    std::lock_guard lock(mutex);
+    auto it = lru.end();
+    while (total_usage() > memory_budget && it != lru.begin()) {
+        --it;
+        // Only the cache owns the table then, and no one can take it from
+        // the cache while its mutex is held.
+        const auto& entry = entries.at(*it);
+        if (entry.dirty || entry.table.use_count() > 1 || entry.table->get_newest_commit() > horizon) {
+            continue;
+        }
+
+        entries.erase(*it);
+        it = lru.erase(it);
+    }
+}
+
+auto TableCache::memory_usage() const -> size_t {
+    std::lock_guard lock(mutex);
+    return total_usage();
+}
+
+auto TableCache::is_over_budget() const -> bool {
+    std::lock_guard lock(mutex);
+    return total_usage() > memory_budget;
+}
+
+auto TableCache::set_memory_budget(size_t budget) -> void {
+    std::lock_guard lock(mutex);
+    memory_budget = budget;
+}
+
+auto TableCache::get_memory_budget() const -> size_t {
+    std::lock_guard lock(mutex);
+    return memory_budget;
+}
+
+auto TableCache::total_usage() const -> size_t {
+    size_t total = 0;
+    for (const auto& [_, entry] : entries) {
+        total += entry.table->get_memory_usage();
+    }
+    return total;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "class_definitions/Table.hpp"
+
+// Resident set of loaded tables. Keeps tables alive between statements,
+// remembers which ones have unsaved changes and evicts clean tables in LRU
+// order once the memory budget is exceeded. Safe to use from several
+// threads; every method takes the cache's mutex, and those that look at
+// a table take its latch after it.
+//
+// Statements of several sessions change tables side by side, each marking
+// its table after the change and before it commits. A flush reads the marks
+// and the rows under the table latch (begin_flush), so a change it writes is
+// always one it has seen marked, and it only clears marks nobody added to
+// while it was writing (end_flush).
+class TableCache {
+    struct Entry {
+        std::shared_ptr<Table> table;
+        bool dirty = false;
+        bool needs_rewrite = false;
+        size_t persisted_rows = 0; // rows already present in the data file
+        uint64_t recovery_lsn = 0; // first change not yet in the data file
+        uint64_t generation = 0;   // counts the marks
+        std::list<std::string>::iterator lru_position;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru; // front = most recently used
+    size_t memory_budget;
+    mutable std::mutex mutex;
+
+    [[nodiscard]] auto total_usage() const -> size_t;
+
+public:
+    explicit TableCache(size_t budget) : memory_budget(budget) {}
+
+    [[nodiscard]] auto find(const std::string& table_name) -> std::shared_ptr<Table>;
+    [[nodiscard]] auto peek(const std::string& table_name) const -> std::shared_ptr<Table>;
+    auto insert(const std::shared_ptr<Table>& table) -> void;
+    auto erase(const std::string& table_name) -> void;
+
+    // Rows were changed or removed by the change logged at `lsn`, the data
+    // file has to be rewritten.
+    auto mark_dirty(const std::string& table_name, uint64_t lsn) -> void;
+    // Rows were only added at the end, the data file can be appended to.
+    auto mark_appended(const std::string& table_name, uint64_t lsn) -> void;
+    [[nodiscard]] auto is_dirty(const std::string& table_name) const -> bool;
+    [[nodiscard]] auto dirty_tables() const -> std::vector<std::shared_ptr<Table>>;
+
+    struct Flush {
+        std::shared_lock<std::shared_mutex> latch; // the table's, held shared
+        bool rewrite = false;
+        size_t persisted_rows = 0;
+        uint64_t generation = 0;
+    };
+    // Latches the table for writing it back. nullopt when it is not cached or
+    // a transaction still has versions in it; uncommitted versions never
+    // reach the data file.
+    [[nodiscard]] auto begin_flush(const std::string& table_name) -> std::optional<Flush>;
+    // The data file now holds the first `row_count` rows. The table is clean
+    // unless it was marked again since begin_flush.
+    auto end_flush(const std::string& table_name, uint64_t generation, size_t row_count) -> void;
+    // Removes old row versions from the tables that have one `divisor`-th of
+    // them or more (see Table::collect_garbage). Tables with appended rows
+    // not written yet are skipped: those rows are found by position.
+    auto collect_garbage(uint64_t horizon, size_t divisor) -> void;
+    [[nodiscard]] auto tables() const -> std::vector<std::shared_ptr<Table>>;
+    // Oldest LSN any dirty table still depends on, or nullopt when all are clean.
+    [[nodiscard]] auto min_recovery_lsn() const -> std::optional<uint64_t>;
+
+    // Tables in least-recently-used order, oldest first.
+    [[nodiscard]] auto eviction_candidates() const -> std::vector<std::string>;
+    // Only tables whose commits are all at or before `horizon` (the oldest
+    // snapshot in use) go: loaded again, their rows count as committed from
+    // the start. Tables a statement is using stay.
+    auto evict_clean(uint64_t horizon) -> void;
+
+    [[nodiscard]] auto memory_usage() const -> size_t;
+    [[nodiscard]] auto is_over_budget() const -> bool;
+    auto set_memory_budget(size_t budget) -> void;
+    [[nodiscard]] auto get_memory_budget() const -> size_t;
+};
@@ -0,0 +1,75 @@
+#include "Transaction.hpp"
+#include "Table.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+auto Transaction::touch(const std::shared_ptr<Table>& table) -> void {
+    if (std::ranges::find(written, table) == written.end()) {
+        written.push_back(table);
+    }
+}
+
+auto TransactionManager::begin() -> std::unique_ptr<Transaction> {
+    std::lock_guard lock(mutex);
+    const auto id = next_id++;
+    const auto read_ts = last_commit.load();
+    active.emplace(id, Active{read_ts, 0});
+    return std::make_unique<Transaction>(id, read_ts);
+}
+
+auto TransactionManager::set_log_transaction(Transaction& transaction, uint64_t log_transaction,
+                                             uint64_t first_lsn) -> void {
+    std::lock_guard lock(mutex);
+    transaction.log_transaction = log_transaction;
+    active[transaction.id].first_lsn = first_lsn;
+}
+
+auto TransactionManager::commit(Transaction& transaction) -> void {
+    std::lock_guard commit_lock(commit_mutex);
+    const auto timestamp = last_commit.load() + 1;
+    for (const auto& table : transaction.written) {
+        table->commit_versions(transaction.get_marker(), timestamp);
+    }
+    {
+        std::lock_guard lock(mutex);
+        if (!transaction.written.empty()) {
+            last_commit = timestamp;
+        }
+        active.erase(transaction.id);
+    }
+    transaction.written.clear();
+}
+
+auto TransactionManager::abort(Transaction& transaction) -> void {
+    for (const auto& table : transaction.written) {
+        table->abort_versions(transaction.get_marker());
+    }
+    transaction.written.clear();
+    finish(transaction);
+}
+
+auto TransactionManager::finish(const Transaction& transaction) -> void {
+    std::lock_guard lock(mutex);
+    active.erase(transaction.id);
+}
+
+auto TransactionManager::horizon() const -> uint64_t {
+    std::lock_guard lock(mutex);
+    auto oldest = last_commit.load();
+    for (const auto& [read_ts, first_lsn] : active | std::views::values) {
+        oldest = std::min(oldest, read_ts);
+    }
+    return oldest;
+}
+
+auto TransactionManager::oldest_log_lsn() const -> std::optional<uint64_t> {
+    std::lock_guard lock(mutex);
+    std::optional<uint64_t> oldest;
+    for (const auto& [read_ts, first_lsn] : active | std::views::values) {
+        if (first_lsn != 0) {
+            oldest = std::min(oldest.value_or(first_lsn), first_lsn);
+        }
+    }
+    return oldest;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class Table;
+
+// What one transaction sees of the row versions of a table. Every version
+// carries the commit timestamps of the transactions that created and removed
+// it (see Table); until then it carries the writer's marker instead, which
+// has the top bit set and so lies after every timestamp.
+struct Snapshot {
+    static constexpr uint64_t UNCOMMITTED = uint64_t{1} << 63;
+    // End of a version nobody removed, begin of one whose writer aborted.
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    uint64_t read_ts = 0;          // commits up to this one are visible
+    uint64_t writer = UNCOMMITTED; // marker of its own versions; never stored alone
+
+    [[nodiscard]] bool sees(uint64_t begin, uint64_t end) const {
+        return (begin <= read_ts || begin == writer) && end > read_ts && end != writer;
+    }
+    [[nodiscard]] static bool is_marker(uint64_t timestamp) {
+        return timestamp >= UNCOMMITTED && timestamp != NEVER;
+    }
+    // Every committed version and nothing in progress: what table files hold.
+    [[nodiscard]] static Snapshot latest() { return {UNCOMMITTED - 1, UNCOMMITTED}; }
+};
+
+// One transaction of a session: a single statement, or BEGIN ... COMMIT.
+// Reads see the snapshot taken when it began plus its own changes.
+class Transaction {
+    friend class TransactionManager;
+
+    uint64_t id;
+    Snapshot snapshot;
+    bool is_explicit = false;
+    uint64_t log_transaction = 0; // write-ahead log transaction, once it logged a change
+    std::vector<std::shared_ptr<Table>> written; // tables holding its versions
+
+public:
+    // A change to a table file that is not resident (see
+    // DatabasePersistence::append_batch). It is prepared during the statement
+    // and applied only once the transaction has committed.
+    struct FileChange {
+        std::function<void()> apply;
+        std::function<void()> discard; // on abort, may be empty
+    };
+
+private:
+    std::vector<FileChange> file_changes;
+
+public:
+    Transaction(uint64_t transaction_id, uint64_t read_ts)
+        : id(transaction_id), snapshot{read_ts, Snapshot::UNCOMMITTED | transaction_id} {}
+
+    [[nodiscard]] auto get_snapshot() const -> const Snapshot& { return snapshot; }
+    [[nodiscard]] auto get_marker() const -> uint64_t { return snapshot.writer; }
+    [[nodiscard]] auto get_log_transaction() const -> uint64_t { return log_transaction; }
+    // Explicit transactions (BEGIN) outlive the statement that opened them.
+    [[nodiscard]] auto get_explicit() const -> bool { return is_explicit; }
+    auto set_explicit(bool value) -> void { is_explicit = value; }
+    // Remembers a table the transaction wrote versions to, so that committing
+    // or aborting can settle them.
+    auto touch(const std::shared_ptr<Table>& table) -> void;
+    auto defer(FileChange change) -> void { file_changes.push_back(std::move(change)); }
+    [[nodiscard]] auto take_file_changes() -> std::vector<FileChange> { return std::exchange(file_changes, {}); }
+};
+
+// Hands out snapshots and commit timestamps. Commits are serialised: each
+// one stamps its versions with the next timestamp before that timestamp is
+// published, so a snapshot never sees part of a transaction. Write conflicts
+// are found by the writers themselves (first writer wins, see Table).
+class TransactionManager {
+    struct Active {
+        uint64_t read_ts = 0;
+        uint64_t first_lsn = 0; // first log record, 0 until it logs one
+    };
+
+    mutable std::mutex mutex;
+    std::mutex commit_mutex;
+    std::atomic<uint64_t> last_commit{0};
+    uint64_t next_id = 1;
+    std::map<uint64_t, Active> active;
+
+    auto finish(const Transaction& transaction) -> void;
+
+public:
+    [[nodiscard]] auto begin() -> std::unique_ptr<Transaction>;
+    // Records the log transaction the first change of `transaction` opened.
+    auto set_log_transaction(Transaction& transaction, uint64_t log_transaction, uint64_t first_lsn) -> void;
+    auto commit(Transaction& transaction) -> void;
+    // Drops every version the transaction created and restores the ones it
+    // removed.
+    auto abort(Transaction& transaction) -> void;
+
+    // Oldest snapshot still in use: versions removed at or before it are
+    // invisible to every transaction and may be collected.
+    [[nodiscard]] auto horizon() const -> uint64_t;
+    // First log record of the oldest open transaction that logged anything.
+    [[nodiscard]] auto oldest_log_lsn() const -> std::optional<uint64_t>;
+};
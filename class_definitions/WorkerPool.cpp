@@ -0,0 +1,104 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t thread_count) : max_parallelism(std::max<size_t>(thread_count, 1)) {
+    // The caller of run() is the first worker of its job.
+    for (size_t i = 1; i < thread_count; i++) {
+        threads.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+auto WorkerPool::shared() -> WorkerPool& {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+auto WorkerPool::set_max_parallelism(size_t parallelism) -> void {
+    max_parallelism = std::max<size_t>(parallelism, 1);
+}
+
+auto WorkerPool::work(Job& job) -> void {
+    for (auto task = job.next_task++; task < job.tasks; task = job.next_task++) {
+        try {
+            (*job.body)(task);
+        }
+        catch (...) {
+            std::lock_guard lock(mutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+            job.next_task = job.tasks;
+        }
+    }
+}
+
+auto WorkerPool::worker_loop() -> void {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        const auto job = jobs.front();
+        if (--job->open_slots == 0) {
+            jobs.pop_front();
+        }
+        job->active++;
+
+        lock.unlock();
+        work(*job);
+        lock.lock();
+
+        if (--job->active == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+auto WorkerPool::run(size_t tasks, const std::function<void(size_t)>& body) -> void {
+    const auto helpers = std::min({max_parallelism.load() - 1, tasks > 0 ? tasks - 1 : 0, threads.size()});
+    if (helpers == 0) {
+        for (size_t task = 0; task < tasks; task++) {
+            body(task);
+        }
+        return;
+    }
+
+    const auto job = std::make_shared<Job>();
+    job->body = &body;
+    job->tasks = tasks;
+    job->open_slots = helpers;
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(job);
+    }
+    for (size_t i = 0; i < helpers; i++) {
+        wake.notify_one();
+    }
+
+    work(*job);
+
+    // Pool threads that have not picked the job up yet no longer need to.
+    std::unique_lock lock(mutex);
+    if (job->open_slots > 0) {
+        std::erase(jobs, job);
+        job->open_slots = 0;
+    }
+    finished.wait(lock, [&job] { return job->active == 0; });
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
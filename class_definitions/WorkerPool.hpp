@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads shared by every query. run() hands out numbered tasks (morsels of
+// a scan) to whoever is free: the calling thread works on its own job as
+// well, and at most `max_parallelism - 1` pool threads join it, so one query
+// never uses more threads than the cap however many queries run at once.
+class WorkerPool {
+    struct Job {
+        const std::function<void(size_t)>* body = nullptr;
+        size_t tasks = 0;
+        std::atomic<size_t> next_task{0};
+        // Guarded by the pool mutex.
+        size_t open_slots = 0; // pool threads that may still join
+        size_t active = 0;     // pool threads working on the job
+        std::exception_ptr error;
+    };
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::deque<std::shared_ptr<Job>> jobs;
+    bool stopping = false;
+    std::atomic<size_t> max_parallelism;
+
+    auto work(Job& job) -> void;
+    auto worker_loop() -> void;
+
+public:
+    explicit WorkerPool(size_t thread_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The process-wide pool, one thread per hardware thread.
+    [[nodiscard]] static auto shared() -> WorkerPool&;
+
+    // Runs body(0) ... body(tasks - 1) and returns once all are done. Tasks
+    // may run in any order and concurrently; the first exception thrown by
+    // one is rethrown here (the remaining tasks are skipped).
+    auto run(size_t tasks, const std::function<void(size_t)>& body) -> void;
+
+    // Threads one query may use, its own included; 1 runs everything on the
+    // calling thread. Defaults to the hardware thread count.
+    auto set_max_parallelism(size_t parallelism) -> void;
+    [[nodiscard]] auto get_max_parallelism() const -> size_t { return max_parallelism; }
+};
@@ -5,16 +5,55 @@
 #include <iostream>
 #include <cstdlib>
 
+#include "../class_definitions/DatabasePersistence.hpp"
 #include "../class_definitions/InputBuffer.hpp"
+#include "../class_definitions/WorkerPool.hpp"
 #include "../types/enums.hpp"
 
 struct MetaCommandHandler {
-	static auto exec_meta_command(const std::unique_ptr<InputBuffer>& input_buffer) -> MetaCommandResults {
+	static auto exec_meta_command(const std::unique_ptr<InputBuffer>& input_buffer, DatabasePersistence& db,
+	                              std::ostream& out = std::cout) -> MetaCommandResults {
 	if (input_buffer -> get_buffer() == ".exit") {
-		std::cout << "Meta command executed. Exiting database." << std::endl;
+		db.flush();
+		out << "Meta command executed. Exiting database." << std::endl;
 		exit(EXIT_SUCCESS);
 	}
 
+	if (input_buffer -> get_buffer() == ".flush") {
+		db.flush();
+		out << "Dirty tables written to disk." << std::endl;
+		return MetaCommandResults::SUCCESS;
+	}
+
+	if (input_buffer -> get_buffer() == ".checkpoint") {
+		db.checkpoint();
+		out << "Checkpoint written, log truncated." << std::endl;
+		return MetaCommandResults::SUCCESS;
+	}
+
+	if (input_buffer -> get_buffer().starts_with(".parallelism")) {
+		// .parallelism [N]: threads one query may scan with (1 = serial).
+		auto& pool = WorkerPool::shared();
+		if (const auto argument = input_buffer -> get_buffer().substr(12); !argument.empty()) {
+			try {
+				pool.set_max_parallelism(std::stoul(argument));
+			} catch (const std::exception&) {
+				return MetaCommandResults::UNRECOGNIZED_COMMAND;
+			}
+		}
+		out << "Parallelism: " << pool.get_max_parallelism() << " thread(s) per query." << std::endl;
+		return MetaCommandResults::SUCCESS;
+	}
+
+	if (input_buffer -> get_buffer() == ".convert") {
+		for (const auto& table_name : db.list_tables()) {
+			if (db.convert_legacy_data(table_name)) {
+				out << "Converted " << table_name << " to the page format.\n";
+			}
+		}
+		return MetaCommandResults::SUCCESS;
+	}
+
 	return MetaCommandResults::UNRECOGNIZED_COMMAND;
 	}
 };
@@ -0,0 +1,96 @@
+#include "handlers/PlanCache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    // A value can be written bare when it lexes back as the same single word.
+    auto is_bare_word(const std::string& value) -> bool {
+        if (value.empty()) {
+            return false;
+        }
+        const auto tokens = SqlLexer::tokenize(value);
+        return tokens.size() == 1 && tokens[0].kind != TokenKind::STRING
+               && tokens[0].kind != TokenKind::PUNCTUATION && tokens[0].kind != TokenKind::PARAMETER
+               && tokens[0].text.size() == value.size();
+    }
+}
+
+auto PlanCache::normalize(const SqlTokens& tokens, size_t first) -> std::string {
+    std::string text;
+    for (auto i = first; i < tokens.size(); i++) {
+        if (i > first) {
+            text += ' ';
+        }
+        switch (tokens[i].kind) {
+            case TokenKind::KEYWORD: text += tokens[i].name(); break;
+            case TokenKind::STRING: text += '\'' + tokens[i].value() + '\''; break;
+            default: text += tokens[i].text; break;
+        }
+    }
+    return text;
+}
+
+auto PlanCache::render(const std::string& text, const std::vector<std::string>& arguments) -> std::string {
+    std::string statement;
+    for (const auto& token : SqlLexer::tokenize(text)) {
+        if (!statement.empty()) {
+            statement += ' ';
+        }
+        if (token.kind == TokenKind::STRING) {
+            statement += '\'' + token.value() + '\'';
+            continue;
+        }
+        const auto parameter = token.parameter_index();
+        if (!parameter) {
+            statement += token.text;
+            continue;
+        }
+
+        if (*parameter >= arguments.size()) {
+            throw std::runtime_error("Missing value for parameter " + token.value());
+        }
+        const auto& argument = arguments[*parameter];
+        if (is_bare_word(argument)) {
+            statement += argument;
+        } else if (argument.find('\'') == std::string::npos) {
+            statement += '\'' + argument + '\'';
+        } else {
+            throw std::runtime_error("Parameter values cannot contain a quote: " + argument);
+        }
+    }
+    return statement;
+}
+
+auto PlanCache::find(const std::string& text, uint64_t schema_version) const
+    -> std::shared_ptr<const StatementPlan> {
+    const auto it = plans.find(text);
+    return it == plans.end() || it->second->schema_version != schema_version ? nullptr : it->second;
+}
+
+auto PlanCache::store(std::shared_ptr<const StatementPlan> plan) -> void {
+    auto text = plan->text;
+    plans.insert_or_assign(std::move(text), std::move(plan));
+}
+
+auto PlanCache::invalidate(const std::string& table_name) -> void {
+    std::erase_if(plans, [&table_name](const auto& entry) {
+        return std::ranges::find(entry.second->tables, table_name) != entry.second->tables.end();
+    });
+}
+
+auto PlanCache::prepare(const std::string& name, std::string text) -> void {
+    prepared.insert_or_assign(name, std::move(text));
+}
+
+auto PlanCache::prepared_text(const std::string& name) const -> std::optional<std::string> {
+    const auto it = prepared.find(name);
+    if (it == prepared.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+auto PlanCache::deallocate(const std::string& name) -> bool {
+    return prepared.erase(name) > 0;
+}
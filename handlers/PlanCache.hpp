@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../class_definitions/AggregateCursor.hpp"
+#include "../class_definitions/Predicate.hpp"
+#include "SqlLexer.hpp"
+
+struct InsertPlan {
+    std::string table_name;
+    // One entry per column of each row: the value as written, or the
+    // parameter bound to it.
+    std::vector<std::string> values;
+    std::vector<std::optional<size_t>> parameters;
+    size_t row_width = 0; // values per row
+};
+
+// An entry of an aggregate query's select list: a GROUP BY column, or a call
+// such as SUM(PRICE) (with column `*` for COUNT(*)).
+struct SelectItem {
+    std::string column;
+    std::optional<AggregateFunction> function;
+};
+
+struct OrderBy {
+    std::string column; // output column name, e.g. COUNT(*) for an aggregate
+    bool descending = false;
+};
+
+// FROM table JOIN other ON table.x = other.y. Output columns of a join are
+// named TABLE.COLUMN; the plan's `where` holds the conditions on the FROM
+// table, this one those on the joined table.
+struct JoinPlan {
+    std::string table_name;
+    std::string left_column;  // of the FROM table
+    std::string right_column; // of the joined table
+    std::optional<Predicate> where;
+};
+
+struct SelectPlan {
+    std::string table_name;
+    std::vector<std::string> columns; // `*` already expanded
+    std::optional<Predicate> where;   // compiled against the table schema
+    // Aggregate queries only: the select list and the GROUP BY columns.
+    std::vector<SelectItem> select_list;
+    std::vector<std::string> group_by;
+    std::optional<JoinPlan> join;
+    std::optional<OrderBy> order_by;
+    RowLimit limit;                   // LIMIT / OFFSET
+};
+
+// A parsed statement. INSERT and SELECT are also bound to the schema of
+// their table; other statements keep only the normalized text and are
+// re-parsed from it on every execution.
+struct StatementPlan {
+    std::string text; // normalized, the cache key
+    std::vector<std::string> tables; // every table the plan is bound to
+    uint64_t schema_version = 0;     // DatabasePersistence::get_schema_version() when planned
+    size_t parameter_count = 0;
+    std::optional<InsertPlan> insert;
+    std::optional<SelectPlan> select;
+};
+
+// Plans of prepared statements keyed by normalized text, so statements that
+// differ only in spacing or keyword case share one plan. Plans bound to a
+// table (the FROM table or a joined one) are dropped when this session drops
+// or re-creates that table. A plan made before another session changed the
+// schema is not found any more; either way the next EXECUTE plans the
+// statement again.
+class PlanCache {
+    std::unordered_map<std::string, std::shared_ptr<const StatementPlan>> plans;
+    std::unordered_map<std::string, std::string> prepared; // name -> normalized text
+
+public:
+    // Canonical text of tokens[first..]: single spaces, upper-cased keywords,
+    // quoted string literals.
+    [[nodiscard]] static auto normalize(const SqlTokens& tokens, size_t first = 0) -> std::string;
+    // `text` with every $n replaced by arguments[n - 1], quoted when needed,
+    // as written to the log.
+    [[nodiscard]] static auto render(const std::string& text, const std::vector<std::string>& arguments) -> std::string;
+
+    // Only a plan made against `schema_version` is returned.
+    [[nodiscard]] auto find(const std::string& text, uint64_t schema_version) const
+        -> std::shared_ptr<const StatementPlan>;
+    auto store(std::shared_ptr<const StatementPlan> plan) -> void;
+    auto invalidate(const std::string& table_name) -> void;
+
+    auto prepare(const std::string& name, std::string text) -> void;
+    [[nodiscard]] auto prepared_text(const std::string& name) const -> std::optional<std::string>;
+    // Returns false when no statement has that name.
+    auto deallocate(const std::string& name) -> bool;
+};
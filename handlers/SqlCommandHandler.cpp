@@ -1,53 +1,292 @@
 #include "handlers/SqlCommandHandler.hpp"
-#include <sstream>
+#include "class_definitions/MappedFile.hpp"
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <numeric>
 #include <stdexcept>
 
-std::vector<std::string> SqlCommandHandler::tokenize(const std::string &query)
+SqlTokens SqlCommandHandler::tokenize(std::string_view statement)
 {
-    std::vector<std::string> tokens;
-    std::istringstream iss(query);
-    std::string token;
+    // Separators carry no meaning in this grammar: "SELECT A, B FROM T" and
+    // "SELECT A B FROM T" are the same statement. INSERT, also after
+    // PREPARE name AS, keeps its parentheses, which delimit the rows.
+    auto tokens = SqlLexer::tokenize(statement);
+    const size_t command = tokens.size() > 3 && tokens[0] == "PREPARE" ? 3 : 0;
+    const bool keep_parentheses = command < tokens.size() && tokens[command] == "INSERT";
+    std::erase_if(tokens, [keep_parentheses](const SqlToken &token) {
+        return token.kind == TokenKind::PUNCTUATION
+            && (token == "," || token == ";" || (!keep_parentheses && (token == "(" || token == ")")));
+    });
+    return tokens;
+}
 
-    while (iss >> token)
+auto SqlCommandHandler::exec_sql_command(const std::unique_ptr<InputBuffer>& input_buffer) -> SqlCommandResults
+{
+    current_statement = input_buffer->get_buffer();
+    const auto tokens = tokenize(current_statement);
+    if (tokens.empty())
     {
-        token.erase(std::ranges::remove(token, ',').begin(), token.end());
-        token.erase(std::ranges::remove(token, '(').begin(), token.end());
-        token.erase(std::ranges::remove(token, ')').begin(), token.end());
+        return SqlCommandResults::EMPTY_QUERY;
+    }
 
-        if (!token.empty())
-        {
-            to_upper(token);
-            tokens.push_back(token);
-        }
+    return run_statement([&] { return dispatch(tokens); }, needs_exclusive_latch(tokens));
+}
+
+SqlCommandHandler::~SqlCommandHandler()
+{
+    // An unfinished explicit transaction is lost.
+    if (transaction)
+    {
+        std::unique_lock lock(db->statement_latch());
+        db->abort_transaction(*transaction);
     }
-    
-    return tokens;
 }
 
-void SqlCommandHandler::to_upper(std::string &str)
+auto SqlCommandHandler::error_message(SqlCommandResults result) const -> std::string
 {
-    std::ranges::transform(str, str.begin(), ::toupper);
+    switch (result)
+    {
+        case SqlCommandResults::SUCCESS:
+            return "";
+        case SqlCommandResults::UNKNOWN_COMMAND:
+            return "Unknown command " + current_statement;
+        case SqlCommandResults::TABLE_NOT_FOUND:
+            return "Table not found";
+        case SqlCommandResults::TABLE_ALREADY_EXISTS:
+            return "Table already exists";
+        case SqlCommandResults::INCORRECT_EXPRESSION:
+            return "Incorrect SQL expression";
+        case SqlCommandResults::EMPTY_QUERY:
+            return "Empty query";
+        case SqlCommandResults::TABLE_DOES_NOT_EXIST:
+            return "Table does not exist";
+        case SqlCommandResults::EXECUTION_ERROR:
+            return last_error;
+        case SqlCommandResults::UNKNOWN_ERROR:
+        default:
+            return "Unknown error occurred";
+    }
 }
 
-auto SqlCommandHandler::exec_sql_command(const std::unique_ptr<InputBuffer>& input_buffer) -> SqlCommandResults
+bool SqlCommandHandler::needs_exclusive_latch(const SqlTokens &tokens) const
+{
+    const auto &command = tokens[0];
+    if (command == "SELECT" || command == "BEGIN" || command == "COMMIT" || command == "ROLLBACK")
+    {
+        return false;
+    }
+    if (command == "EXECUTE")
+    {
+        const auto text = tokens.size() > 1 ? plans.prepared_text(tokens[1].name()) : std::nullopt;
+        return !text || needs_exclusive_latch(tokenize(*text));
+    }
+
+    std::string table_name;
+    if ((command == "INSERT" || command == "DELETE") && tokens.size() > 2)
+    {
+        table_name = tokens[2].name();
+    }
+    else if ((command == "UPDATE" || command == "COPY") && tokens.size() > 1)
+    {
+        table_name = tokens[1].name();
+    }
+    else
+    {
+        return true;
+    }
+    return !in_explicit_transaction() && !db->fits_in_memory(table_name);
+}
+
+auto SqlCommandHandler::log_change(const std::string &table_name, std::optional<std::string_view> input) const
+    -> uint64_t
+{
+    // A NUL separates the statement from its input in the record (see
+    // recover()), so statements cannot contain one.
+    if (current_statement.find('\0') != std::string::npos)
+    {
+        throw std::runtime_error("Statements cannot contain NUL characters");
+    }
+    if (!input)
+    {
+        return db->log_change(*transaction, table_name, current_statement);
+    }
+    auto record = current_statement;
+    record += '\0';
+    record += *input;
+    return db->log_change(*transaction, table_name, record);
+}
+
+auto SqlCommandHandler::run_statement(const std::function<SqlCommandResults()> &body, bool exclusive_latch) -> SqlCommandResults
+{
+    // Held until the work after the statement is done (see
+    // DatabasePersistence::statement_latch).
+    std::shared_lock shared(db->statement_latch(), std::defer_lock);
+    std::unique_lock unique(db->statement_latch(), std::defer_lock);
+    if (exclusive_latch)
+    {
+        unique.lock();
+    }
+    else
+    {
+        shared.lock();
+    }
+    // keeps_resident() follows the latch taken, not what the tables have
+    // grown to since.
+    exclusive = exclusive_latch;
+
+    // Outside of BEGIN ... COMMIT every statement is a transaction of its own.
+    if (!transaction)
+    {
+        transaction = db->begin_transaction();
+    }
+
+    SqlCommandResults result;
+    try
+    {
+        result = body();
+    }
+    catch (const std::exception &e)
+    {
+        last_error = e.what();
+        result = SqlCommandResults::EXECUTION_ERROR;
+    }
+
+    // Inside BEGIN ... COMMIT a statement only adds to the open transaction;
+    // one that fails made no change and leaves the transaction open.
+    if (transaction && !transaction->get_explicit())
+    {
+        if (result == SqlCommandResults::SUCCESS)
+        {
+            db->commit_transaction(*transaction);
+        }
+        else
+        {
+            db->abort_transaction(*transaction);
+        }
+        transaction.reset();
+    }
+    db->end_statement();
+    return result;
+}
+
+auto SqlCommandHandler::prepare(const std::string &name, const std::string &statement) -> SqlCommandResults
 {
-    const auto tokens = tokenize(input_buffer->get_buffer());
+    const auto tokens = tokenize(statement);
     if (tokens.empty())
     {
         return SqlCommandResults::EMPTY_QUERY;
     }
+    try
+    {
+        // Planning reads the table's schema.
+        std::shared_lock lock(db->statement_latch());
+        return prepare_statement(SqlToken{TokenKind::IDENTIFIER, name}.name(), tokens, 0);
+    }
+    catch (const std::exception &e)
+    {
+        last_error = e.what();
+        return SqlCommandResults::EXECUTION_ERROR;
+    }
+}
+
+auto SqlCommandHandler::execute(const std::string &name, const std::vector<std::string> &arguments) -> SqlCommandResults
+{
+    const auto statement_name = SqlToken{TokenKind::IDENTIFIER, name}.name();
+    const auto text = plans.prepared_text(statement_name);
+    return run_statement([&] {
+        return execute_prepared(statement_name, arguments);
+    }, !text || needs_exclusive_latch(tokenize(*text)));
+}
+
+auto SqlCommandHandler::deallocate(const std::string &name) -> bool
+{
+    return plans.deallocate(SqlToken{TokenKind::IDENTIFIER, name}.name());
+}
+
+auto SqlCommandHandler::recover() -> size_t
+{
+    size_t replayed = 0;
+    for (const auto &record : db->committed_log_records())
+    {
+        // A COPY record carries the file it read after a NUL.
+        const std::string_view text = record.statement;
+        const auto input_start = text.find('\0');
+        const auto statement = text.substr(0, input_start);
+        const auto tokens = tokenize(statement);
+        if (tokens.empty())
+        {
+            continue;
+        }
+
+        // CREATE is redone only when the table is missing; everything else only
+        // when the table file does not contain the record yet.
+        const auto table_lsn = db->table_lsn(record.table_name);
+        const bool is_create = tokens[0] == "CREATE";
+        if (is_create ? table_lsn.has_value() : !table_lsn.has_value() || *table_lsn >= record.lsn)
+        {
+            continue;
+        }
+
+        current_statement = statement;
+        replay_input = input_start == std::string_view::npos ? std::nullopt
+                                                             : std::optional(text.substr(input_start + 1));
+        db->begin_replay(record.lsn);
+        transaction = db->begin_transaction();
+        try
+        {
+            dispatch(tokens);
+            db->commit_transaction(*transaction);
+            replayed++;
+        }
+        catch (const std::exception &e)
+        {
+            db->abort_transaction(*transaction);
+            std::cerr << "WARNING: Could not replay log record " << record.lsn << ": " << e.what() << "\n";
+        }
+        transaction.reset();
+        replay_input.reset();
+        db->end_replay();
+    }
+
+    // Once the replayed changes are in the table files the log can be cut.
+    if (replayed > 0)
+    {
+        db->checkpoint();
+    }
+    return replayed;
+}
+
+SqlCommandResults SqlCommandHandler::dispatch(const SqlTokens &tokens)
+{
+    const auto &command = tokens[0];
+    if (command == "BEGIN" || command == "COMMIT" || command == "ROLLBACK")
+    {
+        return handle_transaction(tokens);
+    }
+    // Table files are created and removed right away, which a rollback
+    // could not undo.
+    if ((command == "CREATE" || command == "DROP") && in_explicit_transaction())
+    {
+        throw std::runtime_error(command.value() + " cannot run inside a transaction");
+    }
 
-    if (const auto &command = tokens[0]; command == "CREATE")
+    if (command == "CREATE")
     {
+        if (tokens.size() > 1 && tokens[1] == "INDEX")
+        {
+            return handle_create_index(tokens);
+        }
         return handle_create_table(tokens);
     }
     else if (command == "INSERT")
     {
         return handle_insert(tokens);
     }
+    else if (command == "COPY")
+    {
+        return handle_copy(tokens);
+    }
     else if (command == "SELECT")
     {
         return handle_select(tokens);
@@ -62,226 +301,861 @@ auto SqlCommandHandler::exec_sql_command(const std::unique_ptr<InputBuffer>& inp
     }
     else if (command == "DROP")
     {
+        if (tokens.size() > 1 && tokens[1] == "INDEX")
+        {
+            return handle_drop_index(tokens);
+        }
         return handle_drop_table(tokens);
     }
+    else if (command == "PREPARE")
+    {
+        return handle_prepare(tokens);
+    }
+    else if (command == "EXECUTE")
+    {
+        return handle_execute(tokens);
+    }
+    else if (command == "DEALLOCATE")
+    {
+        return handle_deallocate(tokens);
+    }
     else
     {
         return SqlCommandResults::UNKNOWN_COMMAND;
     }
 }
 
-SqlCommandResults SqlCommandHandler::handle_create_table(const std::vector<std::string> &tokens)
+SqlCommandResults SqlCommandHandler::handle_transaction(const SqlTokens &tokens)
+{
+    if (tokens.size() != 1)
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    // BEGIN keeps the statement's transaction, and with it the snapshot
+    // taken just now, open until COMMIT or ROLLBACK.
+    if (tokens[0] == "BEGIN")
+    {
+        if (in_explicit_transaction())
+        {
+            throw std::runtime_error("A transaction is already in progress");
+        }
+        transaction->set_explicit(true);
+        return SqlCommandResults::SUCCESS;
+    }
+    if (!in_explicit_transaction())
+    {
+        throw std::runtime_error("No transaction in progress");
+    }
+    if (tokens[0] == "COMMIT")
+    {
+        db->commit_transaction(*transaction);
+    }
+    else
+    {
+        db->abort_transaction(*transaction);
+    }
+    transaction.reset();
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::handle_create_table(const SqlTokens &tokens)
 {
     if (tokens.size() < 4 || tokens[1] != "TABLE")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    const auto &table_name = tokens[2];
+    const auto table_name = tokens[2].name();
 
     if (auto tables = db->list_tables(); std::ranges::find(tables, table_name) != tables.end())
     {
         return SqlCommandResults::TABLE_ALREADY_EXISTS;
     }
 
-    size_t pos = 3;
     auto columns = parse_columns_definition(tokens, 3);
 
-    const auto table = std::make_unique<Table>(table_name);
+    const auto table = std::make_shared<Table>(table_name);
     for (const auto &col : columns)
     {
         table->add_column(col);
     }
 
-    db->save_table_schema(*table);
-    std::cout << table_name << " created successfuly \n";
+    table->set_lsn(log_change(table_name));
+    db->create_table(table);
+    plans.invalidate(table_name);
+    out << table_name << " created successfuly \n";
     return SqlCommandResults::SUCCESS;
 }
 
-SqlCommandResults SqlCommandHandler::handle_insert(const std::vector<std::string> &tokens) const {
+bool SqlCommandHandler::in_explicit_transaction() const
+{
+    return transaction && transaction->get_explicit();
+}
+
+bool SqlCommandHandler::keeps_resident(const std::string &table_name) const
+{
+    // Changes made in a transaction are buffered in the cached table.
+    return in_explicit_transaction() || !exclusive || db->fits_in_memory(table_name);
+}
+
+SqlCommandResults SqlCommandHandler::handle_insert(const SqlTokens &tokens) const {
+    InsertPlan plan;
+    if (const auto result = plan_insert(tokens, plan); result != SqlCommandResults::SUCCESS)
+    {
+        return result;
+    }
+    return run_insert(plan, {});
+}
+
+SqlCommandResults SqlCommandHandler::plan_insert(const SqlTokens &tokens, InsertPlan &plan) const {
     if (tokens.size() < 4 || tokens[1] != "INTO")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    const auto &table_name = tokens[2];
-    const auto table = db->load_table(table_name);
+    // INSERT INTO T [VALUES] (row), (row), ... or INSERT INTO T value ...
+    // for a single row. Every row must have the same number of values; that
+    // it is one per column is checked against the schema when the plan runs.
+    plan.table_name = tokens[2].name();
+    size_t pos = tokens[3] == "VALUES" ? 4 : 3;
+    if (pos == tokens.size())
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    const auto is_parenthesis = [&tokens](size_t i, std::string_view which) {
+        return tokens[i].kind == TokenKind::PUNCTUATION && tokens[i] == which;
+    };
+    const bool grouped = is_parenthesis(pos, "(");
+    while (pos < tokens.size())
+    {
+        if (grouped && !is_parenthesis(pos++, "("))
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        const auto first = plan.values.size();
+        for (; pos < tokens.size() && !is_parenthesis(pos, ")"); pos++)
+        {
+            if (is_parenthesis(pos, "("))
+            {
+                return SqlCommandResults::INCORRECT_EXPRESSION;
+            }
+            plan.values.push_back(tokens[pos].value());
+            plan.parameters.push_back(tokens[pos].parameter_index());
+        }
+        if (grouped ? pos++ == tokens.size() : pos != tokens.size())
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        const auto width = plan.values.size() - first;
+        if (width == 0 || (first > 0 && width != plan.row_width))
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        plan.row_width = width;
+    }
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::run_insert(const InsertPlan &plan, const std::vector<std::string> &arguments) const {
+    const auto &table_name = plan.table_name;
+    const bool resident = keeps_resident(table_name);
+    const std::shared_ptr<Table> table = resident ? db->get_table(table_name) : db->load_schema(table_name);
 
     const auto &columns = table->get_columns();
-    constexpr auto pos = 3;
+    if (plan.row_width != columns.size())
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    // All rows are validated in a batch first, so a bad row inserts nothing.
+    auto rows = table->empty_copy();
+    for (size_t first = 0; first < plan.values.size(); first += columns.size())
+    {
+        Row row;
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            const auto &parameter = plan.parameters[first + i];
+            if (parameter && *parameter >= arguments.size())
+            {
+                throw std::runtime_error("Missing value for parameter " + plan.values[first + i]);
+            }
+            row.data[columns[i].name] = parameter ? arguments[*parameter] : plan.values[first + i];
+        }
+        rows.insert_row(row);
+    }
 
-    if (const auto values_count = tokens.size() - pos; values_count != columns.size())
+    if (!resident)
+    {
+        db->append_batch(table_name, std::move(rows), log_change(table_name), *transaction);
+        return SqlCommandResults::SUCCESS;
+    }
+
+    table->append_rows(rows, *transaction);
+    const auto lsn = log_change(table_name);
+    table->set_lsn(lsn);
+    db->mark_appended(table_name, lsn);
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::handle_copy(const SqlTokens &tokens) const
+{
+    // COPY table FROM 'file.csv' [HEADER]
+    if (tokens.size() < 4 || tokens.size() > 5 || tokens[2] != "FROM" || tokens[3].kind != TokenKind::STRING
+        || (tokens.size() == 5 && tokens[4] != "HEADER"))
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    Row row;
-    for (size_t i = 0; i < columns.size(); i++)
+    const auto table_name = tokens[1].name();
+    const auto path = tokens[3].value();
+    const bool resident = keeps_resident(table_name);
+    const std::shared_ptr<Table> table = resident ? db->get_table(table_name) : db->load_schema(table_name);
+
+    // The contents of the file are logged with the statement, so recovery
+    // does not depend on the file still being there, or unchanged.
+    std::optional<MappedFile> file;
+    auto input = replay_input;
+    if (!input)
     {
-        row.data[columns[i].name] = tokens[pos + i];
+        file.emplace(path);
+        file->advise(MappedFile::AccessHint::SEQUENTIAL);
+        input = std::string_view(file->data(), file->size());
     }
 
-    table->insert_row(row);
-    db->save_table_data(*table);
+    auto rows = CsvReader::read(*input, path, *table, tokens.size() == 5);
+    const auto row_count = rows.get_row_count();
+    if (!resident)
+    {
+        db->append_batch(table_name, std::move(rows), log_change(table_name, input), *transaction);
+    }
+    else
+    {
+        table->append_rows(rows, *transaction);
+        const auto lsn = log_change(table_name, input);
+        table->set_lsn(lsn);
+        db->mark_appended(table_name, lsn);
+    }
+    out << row_count << " rows copied into " << table_name << "\n";
     return SqlCommandResults::SUCCESS;
 }
 
-SqlCommandResults SqlCommandHandler::handle_select(const std::vector<std::string>& tokens) {
+SqlCommandResults SqlCommandHandler::handle_select(const SqlTokens& tokens) {
+    SelectPlan plan;
+    if (const auto result = plan_select(tokens, plan); result != SqlCommandResults::SUCCESS) {
+        return result;
+    }
+    return run_select(plan, {});
+}
+
+std::optional<AggregateFunction> SqlCommandHandler::aggregate_function(const SqlToken& token) {
+    if (token.kind != TokenKind::KEYWORD) return std::nullopt;
+    if (token == "COUNT") return AggregateFunction::COUNT;
+    if (token == "SUM") return AggregateFunction::SUM;
+    if (token == "MIN") return AggregateFunction::MIN;
+    if (token == "MAX") return AggregateFunction::MAX;
+    if (token == "AVG") return AggregateFunction::AVG;
+    return std::nullopt;
+}
+
+SelectItem SqlCommandHandler::parse_select_item(const SqlTokens& tokens, size_t& pos) {
+    // Parentheses are dropped by tokenize(): COUNT(*) arrives as COUNT *.
+    const auto function = aggregate_function(tokens[pos]);
+    if (!function || pos + 1 >= tokens.size() || tokens[pos + 1] == "FROM") {
+        return {tokens[pos++].name(), std::nullopt};
+    }
+
+    const auto& argument = tokens[pos + 1];
+    pos += 2;
+    if (argument == "*") {
+        if (*function != AggregateFunction::COUNT) {
+            throw std::runtime_error("Only COUNT accepts *");
+        }
+        return {"*", AggregateFunction::COUNT_ROWS};
+    }
+    return {argument.name(), function};
+}
+
+std::string SqlCommandHandler::select_item_name(const SelectItem& item) {
+    return item.function ? AggregateCursor::call_name(*item.function, item.column) : item.column;
+}
+
+SqlCommandResults SqlCommandHandler::plan_select(const SqlTokens& tokens, SelectPlan& plan) const {
     if (tokens.size() < 4) {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    std::vector<std::string> columns;
     size_t pos = 1;
 
+    std::vector<SelectItem> items;
     if (tokens[pos] == "*") {
         pos++;
     } else {
-        columns = parse_column_list(tokens, pos);
-        pos += columns.size();
+        try {
+            while (pos < tokens.size() && tokens[pos] != "FROM") {
+                items.push_back(parse_select_item(tokens, pos));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
     }
 
     if (pos >= tokens.size() || tokens[pos] != "FROM") {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
     pos++;
+    if (pos >= tokens.size()) {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
 
-    const auto& table_name = tokens[pos++];
-    auto table = db->load_table(table_name);
+    plan.table_name = tokens[pos++].name();
+    const std::shared_ptr<Table> schema = db->fits_in_memory(plan.table_name)
+        ? db->get_table(plan.table_name)
+        : db->load_schema(plan.table_name);
+
+    if (pos < tokens.size() && (tokens[pos] == "JOIN" || tokens[pos] == "INNER")) {
+        return plan_join(tokens, pos, items, *schema, plan);
+    }
 
-    if (columns.empty()) {
-        for (const auto& col : table->get_columns()) {
-            columns.push_back(col.name);
+    for (const auto& item : items) {
+        if (item.function != AggregateFunction::COUNT_ROWS && !schema->column_index(item.column)) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
         }
     }
 
-    std::vector<Row> results;
     if (pos < tokens.size() && tokens[pos] == "WHERE") {
         pos++;
         try {
-            auto where = convert_to_where_clause(tokens, pos);
-            results = table->select_where(columns, where);
+            plan.where = convert_to_where_clause(tokens, pos, schema->get_columns());
         }
         catch (const std::runtime_error& e) {
             return SqlCommandResults::INCORRECT_EXPRESSION;
         }
+    }
+
+    // [GROUP BY column ...]
+    if (pos < tokens.size() && tokens[pos] == "GROUP") {
+        if (pos + 2 >= tokens.size() || tokens[pos + 1] != "BY") {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        for (pos += 2; pos < tokens.size() && tokens[pos].kind != TokenKind::KEYWORD; pos++) {
+            if (!schema->column_index(tokens[pos].name())) {
+                return SqlCommandResults::INCORRECT_EXPRESSION;
+            }
+            plan.group_by.push_back(tokens[pos].name());
+        }
+        if (plan.group_by.empty()) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+    }
+
+    const bool aggregate = !plan.group_by.empty()
+        || std::ranges::any_of(items, [](const SelectItem& item) { return item.function.has_value(); });
+    if (aggregate) {
+        if (items.empty()) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        for (const auto& item : items) {
+            // Plain columns must be grouped on; SUM and AVG need numbers.
+            if (!item.function && std::ranges::find(plan.group_by, item.column) == plan.group_by.end()) {
+                return SqlCommandResults::INCORRECT_EXPRESSION;
+            }
+            if ((item.function == AggregateFunction::SUM || item.function == AggregateFunction::AVG)
+                && schema->get_columns()[*schema->column_index(item.column)].type == ColumnType::TEXT) {
+                return SqlCommandResults::INCORRECT_EXPRESSION;
+            }
+        }
+        plan.select_list = std::move(items);
+    } else if (items.empty()) {
+        for (const auto& col : schema->get_columns()) {
+            plan.columns.push_back(col.name);
+        }
     } else {
-        results = table->select(columns);
+        for (auto& item : items) {
+            plan.columns.push_back(std::move(item.column));
+        }
     }
-    if (results.empty()) {
-        std::cout << "Brak wyników.\n";
-        return SqlCommandResults::SUCCESS;
+
+    const auto order_key = [&](const SelectItem& key) -> std::optional<std::string> {
+        const auto name = select_item_name(key);
+        const bool valid = aggregate
+            ? std::ranges::any_of(plan.select_list, [&name](const SelectItem& item) { return select_item_name(item) == name; })
+            : !key.function && schema->column_index(name).has_value();
+        return valid ? std::optional(name) : std::nullopt;
+    };
+    return parse_order_and_limit(tokens, pos, order_key, plan);
+}
+
+SqlCommandResults SqlCommandHandler::parse_order_and_limit(
+    const SqlTokens& tokens, size_t pos, const std::function<std::optional<std::string>(const SelectItem&)>& order_key,
+    SelectPlan& plan) {
+    // [ORDER BY column [ASC | DESC]]; an aggregate query sorts its output.
+    if (pos < tokens.size() && tokens[pos] == "ORDER") {
+        if (pos + 2 >= tokens.size() || tokens[pos + 1] != "BY") {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        pos += 2;
+        std::optional<std::string> key;
+        try {
+            key = order_key(parse_select_item(tokens, pos));
+        }
+        catch (const std::runtime_error& e) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        if (!key) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        plan.order_by = OrderBy{*key};
+        if (pos < tokens.size() && (tokens[pos] == "ASC" || tokens[pos] == "DESC")) {
+            plan.order_by->descending = tokens[pos] == "DESC";
+            pos++;
+        }
     }
 
-    std::unordered_map<std::string, size_t> col_widths;
-    for (const auto &col : columns)
-    {
-        col_widths[col] = col.length();
+    // [LIMIT count] [OFFSET count], in either order.
+    while (pos + 1 < tokens.size() && (tokens[pos] == "LIMIT" || tokens[pos] == "OFFSET")) {
+        const auto& count = tokens[pos + 1];
+        if (count.kind != TokenKind::INTEGER || count.text.front() == '-') {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        const auto value = static_cast<size_t>(ColumnVector::parse_integer(count.text));
+        (tokens[pos] == "LIMIT" ? plan.limit.count : plan.limit.offset) = value;
+        pos += 2;
     }
+    if (pos != tokens.size()) {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    return SqlCommandResults::SUCCESS;
+}
 
-    for (const auto &row : results)
-    {
-        for (const auto &[col, val] : row.data)
-        {
-            if (col_widths.contains(col))
-            {
-                col_widths[col] = std::max(col_widths[col], val.length());
+SqlCommandResults SqlCommandHandler::plan_join(const SqlTokens& tokens, size_t pos, const std::vector<SelectItem>& items,
+                                               const Table& left, SelectPlan& plan) const {
+    // [INNER] JOIN table ON column = column
+    if (tokens[pos] == "INNER") {
+        pos++;
+    }
+    if (pos + 6 > tokens.size() || tokens[pos] != "JOIN" || tokens[pos + 2] != "ON" || tokens[pos + 4] != "=") {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    auto& join = plan.join.emplace();
+    join.table_name = tokens[pos + 1].name();
+    if (join.table_name == plan.table_name) {
+        return SqlCommandResults::INCORRECT_EXPRESSION; // no aliases to tell the two sides apart
+    }
+    const std::shared_ptr<Table> right = db->fits_in_memory(join.table_name)
+        ? db->get_table(join.table_name)
+        : db->load_schema(join.table_name);
+
+    // A reference is TABLE.COLUMN, or a column name only one side has.
+    // Resolved to the side (true for the joined table) and the bare name.
+    const auto resolve = [&](const std::string& reference) -> std::optional<std::pair<bool, std::string>> {
+        if (const auto dot = reference.find('.'); dot != std::string::npos) {
+            const auto table = reference.substr(0, dot);
+            auto column = reference.substr(dot + 1);
+            if (table == plan.table_name && left.column_index(column)) {
+                return std::pair{false, std::move(column)};
+            }
+            if (table == join.table_name && right->column_index(column)) {
+                return std::pair{true, std::move(column)};
             }
+            return std::nullopt;
         }
+        const bool in_left = left.column_index(reference).has_value();
+        if (in_left == right->column_index(reference).has_value()) {
+            return std::nullopt; // unknown or ambiguous
+        }
+        return std::pair{!in_left, reference};
+    };
+    const auto qualified = [&](const std::pair<bool, std::string>& column) {
+        return (column.first ? join.table_name : plan.table_name) + "." + column.second;
+    };
+
+    const auto first = resolve(tokens[pos + 3].name());
+    const auto second = resolve(tokens[pos + 5].name());
+    if (!first || !second || first->first == second->first) {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
     }
+    const auto& left_key = first->first ? *second : *first;
+    const auto& right_key = first->first ? *first : *second;
+    if (left.get_columns()[*left.column_index(left_key.second)].type
+        != right->get_columns()[*right->column_index(right_key.second)].type) {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    join.left_column = left_key.second;
+    join.right_column = right_key.second;
+    pos += 6;
 
-    for (const auto &col : columns)
-    {
-        std::cout << "| " << std::setw(col_widths[col]) << col << " ";
+    if (items.empty()) {
+        for (const auto& column : left.get_columns()) {
+            plan.columns.push_back(plan.table_name + "." + column.name);
+        }
+        for (const auto& column : right->get_columns()) {
+            plan.columns.push_back(join.table_name + "." + column.name);
+        }
+    }
+    for (const auto& item : items) {
+        const auto column = resolve(item.column);
+        if (item.function || !column) {
+            return SqlCommandResults::INCORRECT_EXPRESSION; // no aggregates over joins
+        }
+        plan.columns.push_back(qualified(*column));
     }
-    std::cout << "|\n";
 
-    for (const auto &col : columns)
-    {
-        std::cout << "+-" << std::string(col_widths[col], '-') << "-";
+    // Every condition goes below the join, to the side its column is on. An
+    // OR can only be pushed down when all its conditions are on one side.
+    if (pos < tokens.size() && tokens[pos] == "WHERE") {
+        pos++;
+        try {
+            auto where = parse_where_conditions(tokens, pos);
+            WhereClause sides[2];
+            sides[0].is_and = sides[1].is_and = where.is_and;
+            for (auto& condition : where.conditions) {
+                const auto column = resolve(condition.column);
+                if (!column) {
+                    return SqlCommandResults::INCORRECT_EXPRESSION;
+                }
+                condition.column = column->second;
+                sides[column->first].conditions.push_back(std::move(condition));
+            }
+            if (!where.is_and && !sides[0].conditions.empty() && !sides[1].conditions.empty()) {
+                return SqlCommandResults::INCORRECT_EXPRESSION;
+            }
+            if (!sides[0].conditions.empty()) {
+                plan.where = Predicate::compile(std::move(sides[0]), left.get_columns());
+            }
+            if (!sides[1].conditions.empty()) {
+                join.where = Predicate::compile(std::move(sides[1]), right->get_columns());
+            }
+        }
+        catch (const std::runtime_error& e) {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
     }
-    std::cout << "+\n";
 
-    for (const auto &[data] : results)
-    {
-        for (const auto &col : columns)
-        {
-            auto it = data.find(col);
-            std::string val = (it != data.end()) ? it->second : "";
-            std::cout << "| " << std::setw(col_widths[col]) << val << " ";
+    const auto order_key = [&](const SelectItem& key) -> std::optional<std::string> {
+        const auto column = resolve(key.column);
+        if (key.function || !column) {
+            return std::nullopt;
+        }
+        return qualified(*column);
+    };
+    return parse_order_and_limit(tokens, pos, order_key, plan);
+}
+
+SqlCommandResults SqlCommandHandler::run_select(const SelectPlan& plan, const std::vector<std::string>& arguments) {
+    std::unique_ptr<Cursor> cursor;
+    try {
+        std::optional<Predicate> where = plan.where;
+        if (where) {
+            where->bind(arguments);
         }
-        std::cout << "|\n";
+        if (plan.join) {
+            std::optional<Predicate> join_where = plan.join->where;
+            if (join_where) {
+                join_where->bind(arguments);
+            }
+            cursor = open_join(plan, std::move(where), std::move(join_where));
+        } else if (!plan.select_list.empty()) {
+            cursor = open_aggregate(plan, std::move(where));
+        } else if (!plan.order_by) {
+            cursor = db->open_cursor(plan.table_name, plan.columns, std::move(where), snapshot(), plan.limit);
+        } else {
+            // The sort key is scanned along with the selected columns and
+            // dropped again on output; the limit applies after sorting.
+            auto columns = plan.columns;
+            auto key = std::ranges::find(columns, plan.order_by->column) - columns.begin();
+            if (key == std::ssize(columns)) {
+                columns.push_back(plan.order_by->column);
+            }
+            cursor = std::make_unique<SortCursor>(db->open_cursor(plan.table_name, columns, std::move(where), snapshot()), key,
+                                                  plan.order_by->descending, plan.columns.size(), plan.limit,
+                                                  db->get_temp_directory(), db->get_sort_budget());
+        }
+    }
+    catch (const std::runtime_error& e) {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
     }
+    print_rows(*cursor);
     return SqlCommandResults::SUCCESS;
 }
 
-SqlCommandResults SqlCommandHandler:: handle_update(const std::vector<std::string> &tokens)
+std::unique_ptr<Cursor> SqlCommandHandler::open_join(const SelectPlan& plan, std::optional<Predicate> left_where,
+                                                     std::optional<Predicate> right_where) const {
+    const auto& join = *plan.join;
+    auto outputs = plan.columns;
+    if (plan.order_by && std::ranges::find(outputs, plan.order_by->column) == outputs.end()) {
+        outputs.push_back(plan.order_by->column); // sort key, dropped after sorting
+    }
+
+    // Each side scans its join key and the columns it contributes.
+    std::vector<std::string> inputs[2] = {{join.left_column}, {join.right_column}};
+    std::vector<HashJoinCursor::Output> columns;
+    const auto left_prefix = plan.table_name + ".";
+    for (const auto& name : outputs) {
+        const bool is_right = !name.starts_with(left_prefix);
+        const auto column = name.substr(is_right ? join.table_name.size() + 1 : left_prefix.size());
+        auto& side = inputs[is_right];
+        const auto position = std::ranges::find(side, column) - side.begin();
+        if (position == std::ssize(side)) {
+            side.push_back(column);
+        }
+        columns.push_back({is_right, static_cast<size_t>(position), name});
+    }
+
+    // Row counts come from metadata; the filters below the join are not
+    // taken into account.
+    const bool build_right = db->row_count(join.table_name, snapshot()) <= db->row_count(plan.table_name, snapshot());
+    for (auto& column : columns) {
+        column.is_build = column.is_build == build_right;
+    }
+    auto left = db->open_cursor(plan.table_name, inputs[0], std::move(left_where), snapshot());
+    auto right = db->open_cursor(join.table_name, inputs[1], std::move(right_where), snapshot());
+    std::unique_ptr<Cursor> cursor = build_right
+        ? std::make_unique<HashJoinCursor>(std::move(right), 0, std::move(left), 0, std::move(columns))
+        : std::make_unique<HashJoinCursor>(std::move(left), 0, std::move(right), 0, std::move(columns));
+
+    if (plan.order_by) {
+        const auto key = std::ranges::find(outputs, plan.order_by->column) - outputs.begin();
+        return std::make_unique<SortCursor>(std::move(cursor), key, plan.order_by->descending, plan.columns.size(),
+                                            plan.limit, db->get_temp_directory(), db->get_sort_budget());
+    }
+    return std::make_unique<LimitCursor>(std::move(cursor), plan.limit);
+}
+
+std::unique_ptr<Cursor> SqlCommandHandler::open_aggregate(const SelectPlan& plan, std::optional<Predicate> where) const {
+    std::unique_ptr<Cursor> cursor;
+    const bool rows_only = std::ranges::all_of(plan.select_list, [](const SelectItem& item) {
+        return item.function == AggregateFunction::COUNT_ROWS;
+    });
+    if (rows_only && plan.group_by.empty() && !where) {
+        // COUNT(*) of a whole table comes from its metadata.
+        Value count;
+        count.is_null = false;
+        count.integer = static_cast<int64_t>(db->row_count(plan.table_name, snapshot()));
+        std::vector<Column> columns(plan.select_list.size(), Column{select_item_name(plan.select_list[0]), ColumnType::INTEGER});
+        cursor = std::make_unique<ValuesCursor>(std::move(columns), std::vector<Tuple>{Tuple(plan.select_list.size(), count)});
+    } else {
+        // Only the grouped columns and the arguments of the calls are scanned.
+        auto inputs = plan.group_by;
+        std::vector<size_t> group_columns(plan.group_by.size());
+        std::iota(group_columns.begin(), group_columns.end(), 0);
+        std::vector<AggregateCall> calls;
+        std::vector<AggregateOutput> outputs;
+        for (const auto& item : plan.select_list) {
+            if (!item.function) {
+                const auto group = std::ranges::find(plan.group_by, item.column) - plan.group_by.begin();
+                outputs.push_back({false, static_cast<size_t>(group)});
+                continue;
+            }
+
+            AggregateCall call{*item.function};
+            if (call.function != AggregateFunction::COUNT_ROWS) {
+                const auto input = std::ranges::find(inputs, item.column);
+                call.column = input - inputs.begin();
+                if (input == inputs.end()) {
+                    inputs.push_back(item.column);
+                }
+            }
+            calls.push_back(call);
+            outputs.push_back({true, calls.size() - 1});
+        }
+        cursor = std::make_unique<AggregateCursor>(db->open_cursor(plan.table_name, inputs, std::move(where), snapshot()),
+                                                   std::move(group_columns), std::move(calls), std::move(outputs));
+    }
+
+    if (plan.order_by) {
+        const auto& columns = cursor->get_columns();
+        const auto key = std::ranges::find(columns, plan.order_by->column, &Column::name) - columns.begin();
+        const auto visible = columns.size();
+        return std::make_unique<SortCursor>(std::move(cursor), key, plan.order_by->descending, visible, plan.limit,
+                                            db->get_temp_directory(), db->get_sort_budget());
+    }
+    return std::make_unique<LimitCursor>(std::move(cursor), plan.limit);
+}
+
+void SqlCommandHandler::print_rows(Cursor& cursor) const {
+    const auto& columns = cursor.get_columns();
+
+    // Column widths come from the first rows only; the rest is streamed as
+    // it is produced and a longer value just widens its own line.
+    std::vector<Tuple> sample;
+    std::vector<size_t> widths;
+    for (const auto& column : columns) {
+        widths.push_back(column.name.length());
+    }
+    Tuple row;
+    while (sample.size() < WIDTH_SAMPLE_ROWS && cursor.next(row)) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            widths[i] = std::max(widths[i], row[i].to_string(columns[i].type).length());
+        }
+        sample.push_back(std::move(row));
+    }
+
+    if (sample.empty()) {
+        out << "Brak wyników.\n";
+        return;
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        out << "| " << std::setw(widths[i]) << columns[i].name << " ";
+    }
+    out << "|\n";
+
+    for (const auto width : widths) {
+        out << "+-" << std::string(width, '-') << "-";
+    }
+    out << "+\n";
+
+    const auto print = [&](const Tuple& values) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            out << "| " << std::setw(widths[i]) << values[i].to_string(columns[i].type) << " ";
+        }
+        out << "|\n";
+    };
+    for (const auto& values : sample) {
+        print(values);
+    }
+    while (cursor.next(row)) {
+        print(row);
+    }
+}
+
+SqlCommandResults SqlCommandHandler:: handle_update(const SqlTokens &tokens)
 {
     if (tokens.size() < 5)
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    const auto &table_name = tokens[1];
-    auto table = db->load_table(table_name);
+    const auto table_name = tokens[1].name();
 
     if (tokens[2] != "SET")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    auto pos = 3;
-    const auto &column = tokens[pos++];
+    size_t pos = 3;
+    const auto column = tokens[pos++].name();
     if (pos >= tokens.size() || tokens[pos] != "=")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
     pos++;
-    const auto &value = tokens[pos++];
+    const auto value = tokens[pos++].value();
+
+    const bool resident = keeps_resident(table_name);
+    const std::shared_ptr<Table> table = resident ? db->get_table(table_name) : db->load_schema(table_name);
 
-    std::string where_condition;
+    std::optional<Predicate> where;
     if (pos < tokens.size() && tokens[pos] == "WHERE")
     {
         pos++;
-        auto [condition, _] = parse_where_clause(tokens, pos);
-        where_condition = condition;
+        try
+        {
+            where = convert_to_where_clause(tokens, pos, table->get_columns());
+        }
+        catch (const std::runtime_error &e)
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+    }
+    if (pos < tokens.size())
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    table->update(column, value, where_condition);
-    db->save_table_data(*table);
+    if (!resident)
+    {
+        update_streaming(table_name, column, value, where ? &*where : nullptr, log_change(table_name));
+        return SqlCommandResults::SUCCESS;
+    }
+
+    table->update(column, value, where ? &*where : nullptr, *transaction);
+    const auto lsn = log_change(table_name);
+    table->set_lsn(lsn);
+    db->mark_dirty(table_name, lsn);
     return SqlCommandResults::SUCCESS;
 }
 
-SqlCommandResults SqlCommandHandler::handle_delete(const std::vector<std::string> &tokens)
+SqlCommandResults SqlCommandHandler::handle_delete(const SqlTokens &tokens)
 {
     if (tokens.size() < 3 || tokens[1] != "FROM")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    const auto &table_name = tokens[2];
-    const auto table = db->load_table(table_name);
+    const auto table_name = tokens[2].name();
+    const bool resident = keeps_resident(table_name);
+    const std::shared_ptr<Table> table = resident ? db->get_table(table_name) : db->load_schema(table_name);
 
-    std::string where_condition;
-    if (auto pos = 3; pos < tokens.size() && tokens[pos] == "WHERE")
+    std::optional<Predicate> where;
+    size_t pos = 3;
+    if (pos < tokens.size() && tokens[pos] == "WHERE")
     {
         pos++;
-        auto [condition, _] = parse_where_clause(tokens, pos);
-        where_condition = condition;
+        try
+        {
+            where = convert_to_where_clause(tokens, pos, table->get_columns());
+        }
+        catch (const std::runtime_error &e)
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+    }
+    if (pos < tokens.size())
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    if (!resident)
+    {
+        db->rewrite_rows(table_name, where ? &*where : nullptr, [](Row &) { return false; },
+                         log_change(table_name), *transaction);
+        return SqlCommandResults::SUCCESS;
     }
 
-    table->delete_rows(where_condition);
-    db->save_table_data(*table);
+    table->delete_rows(where ? &*where : nullptr, *transaction);
+    const auto lsn = log_change(table_name);
+    table->set_lsn(lsn);
+    db->mark_dirty(table_name, lsn);
     return SqlCommandResults::SUCCESS;
 }
 
-SqlCommandResults SqlCommandHandler::handle_drop_table(const std::vector<std::string> &tokens) const {
+void SqlCommandHandler::update_streaming(const std::string &table_name, const std::string &column,
+                                         const std::string &value, const Predicate *where, uint64_t lsn) const
+{
+    // Same rules as Table::update, applied page by page. Key uniqueness cannot be
+    // checked without the whole table, so primary keys stay read-only here.
+    const auto schema = db->load_schema(table_name);
+    const auto &columns = schema->get_columns();
+    const auto it = std::ranges::find_if(columns, [&column](const Column &col) { return col.name == column; });
+    if (it == columns.end())
+    {
+        throw std::runtime_error("Kolumna nie istnieje: " + column);
+    }
+    if (column == schema->get_primary_key_column())
+    {
+        throw std::runtime_error("Cannot update the primary key of a table larger than memory: " + table_name);
+    }
+
+    if (!Table::validate_value(value, it->type))
+    {
+        throw std::runtime_error("Invalid value for column " + column + ": " + value);
+    }
+
+    db->rewrite_rows(table_name, where, [&](Row &row) {
+        row.data[column] = value;
+        return true;
+    }, lsn, *transaction);
+}
+
+SqlCommandResults SqlCommandHandler::handle_drop_table(const SqlTokens &tokens) {
     if (tokens.size() < 3 || tokens[1] != "TABLE")
     {
         return SqlCommandResults::INCORRECT_EXPRESSION;
     }
 
-    const auto &table_name = tokens[2];
+    const auto table_name = tokens[2].name();
 
     // Sprawdź czy tabela istnieje przed usunięciem
     auto tables = db->list_tables();
@@ -290,12 +1164,200 @@ SqlCommandResults SqlCommandHandler::handle_drop_table(const std::vector<std::st
         return SqlCommandResults::TABLE_DOES_NOT_EXIST;
     }
 
+    log_change(table_name);
     db->delete_table(table_name);
-    std::cout << "Usunięto tabelę '" << table_name << "'\n";
+    plans.invalidate(table_name);
+    out << "Usunięto tabelę '" << table_name << "'\n";
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::handle_create_index(const SqlTokens &tokens) const
+{
+    // CREATE INDEX name ON table (column)
+    if (tokens.size() != 6 || tokens[3] != "ON")
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    const auto index_name = tokens[2].name();
+    const auto table_name = tokens[4].name();
+    const auto column_name = tokens[5].name();
+    if (auto tables = db->list_tables(); std::ranges::find(tables, table_name) == tables.end())
+    {
+        return SqlCommandResults::TABLE_DOES_NOT_EXIST;
+    }
+
+    db->create_index(index_name, table_name, column_name);
+    out << "Index " << index_name << " created on " << table_name << "(" << column_name << ")\n";
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::handle_drop_index(const SqlTokens &tokens) const
+{
+    if (tokens.size() != 3)
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    const auto index_name = tokens[2].name();
+    if (!db->drop_index(index_name))
+    {
+        throw std::runtime_error("Index does not exist: " + index_name);
+    }
+    out << "Index " << index_name << " dropped\n";
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::handle_prepare(const SqlTokens &tokens)
+{
+    // PREPARE name AS statement
+    if (tokens.size() < 4 || tokens[2] != "AS")
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    return prepare_statement(tokens[1].name(), tokens, 3);
+}
+
+SqlCommandResults SqlCommandHandler::handle_execute(const SqlTokens &tokens)
+{
+    // EXECUTE name (argument, ...)
+    if (tokens.size() < 2)
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    std::vector<std::string> arguments;
+    for (size_t i = 2; i < tokens.size(); i++)
+    {
+        arguments.push_back(tokens[i].value());
+    }
+    return execute_prepared(tokens[1].name(), arguments);
+}
+
+SqlCommandResults SqlCommandHandler::handle_deallocate(const SqlTokens &tokens)
+{
+    if (tokens.size() != 2)
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+    if (!plans.deallocate(tokens[1].name()))
+    {
+        throw std::runtime_error("Prepared statement does not exist: " + tokens[1].name());
+    }
     return SqlCommandResults::SUCCESS;
 }
 
-std::vector<Column> SqlCommandHandler::parse_columns_definition(const std::vector<std::string> &tokens, int position)
+SqlCommandResults SqlCommandHandler::prepare_statement(const std::string &name, const SqlTokens &tokens, size_t first)
+{
+    const auto command = tokens[first];
+    if (command == "PREPARE" || command == "EXECUTE" || command == "DEALLOCATE")
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    auto text = PlanCache::normalize(tokens, first);
+    if (!plans.find(text, db->get_schema_version()))
+    {
+        std::shared_ptr<const StatementPlan> plan;
+        if (const auto result = build_plan(text, plan); result != SqlCommandResults::SUCCESS)
+        {
+            return result;
+        }
+        plans.store(plan);
+    }
+    plans.prepare(name, std::move(text));
+    out << "Statement " << name << " prepared\n";
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::build_plan(const std::string &text, std::shared_ptr<const StatementPlan> &out) const
+{
+    const auto tokens = tokenize(text);
+    auto plan = std::make_shared<StatementPlan>();
+    plan->text = text;
+    plan->schema_version = db->get_schema_version();
+    for (const auto &token : tokens)
+    {
+        if (const auto parameter = token.parameter_index())
+        {
+            plan->parameter_count = std::max(plan->parameter_count, *parameter + 1);
+        }
+    }
+
+    if (tokens[0] == "INSERT")
+    {
+        InsertPlan insert;
+        if (const auto result = plan_insert(tokens, insert); result != SqlCommandResults::SUCCESS)
+        {
+            return result;
+        }
+        if (insert.row_width != db->load_schema(insert.table_name)->get_columns().size())
+        {
+            return SqlCommandResults::INCORRECT_EXPRESSION;
+        }
+        plan->tables = {insert.table_name};
+        plan->insert = std::move(insert);
+    }
+    else if (tokens[0] == "SELECT")
+    {
+        SelectPlan select;
+        if (const auto result = plan_select(tokens, select); result != SqlCommandResults::SUCCESS)
+        {
+            return result;
+        }
+        plan->tables = {select.table_name};
+        if (select.join)
+        {
+            plan->tables.push_back(select.join->table_name);
+        }
+        plan->select = std::move(select);
+    }
+
+    out = std::move(plan);
+    return SqlCommandResults::SUCCESS;
+}
+
+SqlCommandResults SqlCommandHandler::execute_prepared(const std::string &name, const std::vector<std::string> &arguments)
+{
+    const auto text = plans.prepared_text(name);
+    if (!text)
+    {
+        throw std::runtime_error("Prepared statement does not exist: " + name);
+    }
+
+    // Plans of dropped or re-created tables, by this session or another
+    // one, are not found; plan again.
+    auto plan = plans.find(*text, db->get_schema_version());
+    if (!plan)
+    {
+        if (const auto result = build_plan(*text, plan); result != SqlCommandResults::SUCCESS)
+        {
+            return result;
+        }
+        plans.store(plan);
+    }
+    if (arguments.size() != plan->parameter_count)
+    {
+        return SqlCommandResults::INCORRECT_EXPRESSION;
+    }
+
+    if (plan->select)
+    {
+        return run_select(*plan->select, arguments);
+    }
+
+    // Changes are logged as the statement with its arguments filled in, so
+    // recovery does not depend on prepared state.
+    current_statement = PlanCache::render(plan->text, arguments);
+    if (plan->insert)
+    {
+        return run_insert(*plan->insert, arguments);
+    }
+    const auto tokens = tokenize(current_statement);
+    return dispatch(tokens);
+}
+
+std::vector<Column> SqlCommandHandler::parse_columns_definition(const SqlTokens &tokens, size_t position)
 {
     std::vector<Column> columns;
 
@@ -305,11 +1367,11 @@ std::vector<Column> SqlCommandHandler::parse_columns_definition(const std::vecto
 
         if (position >= tokens.size())
             break;
-        col.name = tokens[position++];
+        col.name = tokens[position++].name();
 
         if (position >= tokens.size())
             break;
-        col.type = DatabasePersistence::string_to_column_type(tokens[position++]);
+        col.type = DatabasePersistence::string_to_column_type(tokens[position++].name());
 
         col.is_primary_key = false;
         col.is_nullable = true;
@@ -348,39 +1410,12 @@ std::vector<Column> SqlCommandHandler::parse_columns_definition(const std::vecto
     return columns;
 }
 
-std::vector<std::string> SqlCommandHandler::parse_column_list(const std::vector<std::string> &tokens, int position)
-{
-    std::vector<std::string> columns;
-    
-    while (position < tokens.size() && tokens[position] != "FROM" && tokens[position] != "WHERE") {
-        if (tokens[position] != ",") {
-            columns.push_back(tokens[position]);
-        }
-        position++;
-    }
-    
-    if (columns.empty()) {
-        throw std::runtime_error("No columns specified in SELECT statement");
-    }
-    
-    return columns;
-}
-
-std::pair<std::string, std::vector<std::string>> SqlCommandHandler::parse_where_clause(const std::vector<std::string> &tokens, int position)
-{
-    std::string condition;
-    std::vector<std::string> params;
-
-    while (position < tokens.size())
-    {
-        condition += tokens[position] + " ";
-        position++;
-    }
-
-    return {condition, params};
+Predicate SqlCommandHandler::convert_to_where_clause(const SqlTokens& tokens, size_t& pos,
+                                                    const std::vector<Column>& columns) const {
+    return Predicate::compile(parse_where_conditions(tokens, pos), columns);
 }
 
-WhereClause SqlCommandHandler::convert_to_where_clause(const std::vector<std::string>& tokens, size_t& pos) const {
+WhereClause SqlCommandHandler::parse_where_conditions(const SqlTokens& tokens, size_t& pos) {
     WhereClause where;
     where.is_and = true;  // domyślnie AND
 
@@ -390,9 +1425,12 @@ WhereClause SqlCommandHandler::convert_to_where_clause(const std::vector<std::st
         }
 
         WhereCondition condition;
-        condition.column = tokens[pos++];
+        condition.column = tokens[pos++].name();
 
         const auto& op = tokens[pos++];
+        if (op.kind != TokenKind::PUNCTUATION) {
+            throw std::runtime_error("Invalid operator in WHERE clause");
+        }
         if (op == "=") condition.op = WhereOperator::EQUALS;
         else if (op == ">") condition.op = WhereOperator::GREATER;
         else if (op == "<") condition.op = WhereOperator::LESS;
@@ -400,7 +1438,8 @@ WhereClause SqlCommandHandler::convert_to_where_clause(const std::vector<std::st
         else if (op == "<=") condition.op = WhereOperator::LESS_EQ;
         else throw std::runtime_error("Invalid operator in WHERE clause");
 
-        condition.value = tokens[pos++];
+        condition.parameter = tokens[pos].parameter_index();
+        condition.value = tokens[pos++].value();
         where.conditions.push_back(condition);
 
         // Sprawdź czy jest kolejny warunek (AND/OR)
@@ -1,32 +1,128 @@
 #pragma once
 
+#include <functional>
+#include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include "../class_definitions/DatabasePersistence.hpp"
 #include "../class_definitions/InputBuffer.hpp"
+#include "../class_definitions/AggregateCursor.hpp"
+#include "../class_definitions/CsvReader.hpp"
+#include "../class_definitions/HashJoinCursor.hpp"
+#include "../class_definitions/Predicate.hpp"
+#include "../class_definitions/SortCursor.hpp"
+#include "PlanCache.hpp"
+#include "SqlLexer.hpp"
 #include "../types/enums.hpp"
 
 class SqlCommandHandler {
     std::shared_ptr<DatabasePersistence> db;
+    std::ostream& out; // results and messages of the statements
+    // Open while a statement runs, and from BEGIN to COMMIT / ROLLBACK.
+    std::unique_ptr<Transaction> transaction;
+    std::string current_statement;
+    std::string last_error;
+    PlanCache plans;
+    // Whether the running statement holds the statement latch exclusively;
+    // recovery runs alone.
+    bool exclusive = true;
+    // While a COPY is replayed, the file contents it logged.
+    std::optional<std::string_view> replay_input;
 
-    static std::vector<std::string> tokenize(const std::string& query);
-    static void to_upper(std::string& str);
+    static constexpr size_t WIDTH_SAMPLE_ROWS = 1000;
 
-    SqlCommandResults handle_create_table(const std::vector<std::string>& tokens);
-    SqlCommandResults handle_insert(const std::vector<std::string>& tokens) const;
-    SqlCommandResults handle_select(const std::vector<std::string>& tokens);
-    SqlCommandResults handle_update(const std::vector<std::string>& tokens);
-    SqlCommandResults handle_delete(const std::vector<std::string>& tokens);
-    SqlCommandResults handle_drop_table(const std::vector<std::string>& tokens) const;
+    static SqlTokens tokenize(std::string_view statement);
 
-    static std::vector<Column> parse_columns_definition(const std::vector<std::string>& tokens, int position);
-    static std::vector<std::string> parse_column_list(const std::vector<std::string>& tokens, int position);
-    std::pair<std::string, std::vector<std::string>> parse_where_clause(const std::vector<std::string>& tokens, int position);
+    SqlCommandResults dispatch(const SqlTokens& tokens);
+    // Commits the statement's log records when `body` succeeds, aborts otherwise.
+    // Unless `exclusive_latch`, the statement runs side by side with those of
+    // other sessions.
+    auto run_statement(const std::function<SqlCommandResults()>& body, bool exclusive_latch) -> SqlCommandResults;
+    // CREATE, DROP and changes streamed through the file of a table too large
+    // for memory (see DatabasePersistence::statement_latch).
+    [[nodiscard]] bool needs_exclusive_latch(const SqlTokens& tokens) const;
+    SqlCommandResults handle_transaction(const SqlTokens& tokens);
+    [[nodiscard]] bool in_explicit_transaction() const;
+    [[nodiscard]] const Snapshot& snapshot() const { return transaction->get_snapshot(); }
+    // Logs the current statement as a change to the table in the transaction,
+    // followed by the `input` it read, if any.
+    auto log_change(const std::string& table_name, std::optional<std::string_view> input = std::nullopt) const
+        -> uint64_t;
+    SqlCommandResults handle_create_table(const SqlTokens& tokens);
+    // Whether a change to the table goes through the cached table rather than
+    // straight to its data file. Always when the statement shares the latch.
+    [[nodiscard]] bool keeps_resident(const std::string& table_name) const;
+    SqlCommandResults handle_insert(const SqlTokens& tokens) const;
+    SqlCommandResults plan_insert(const SqlTokens& tokens, InsertPlan& plan) const;
+    SqlCommandResults run_insert(const InsertPlan& plan, const std::vector<std::string>& arguments) const;
+    SqlCommandResults handle_copy(const SqlTokens& tokens) const;
+    SqlCommandResults handle_select(const SqlTokens& tokens);
+    SqlCommandResults plan_select(const SqlTokens& tokens, SelectPlan& plan) const;
+    // The rest of a SELECT after `FROM table`, from [INNER] JOIN on.
+    SqlCommandResults plan_join(const SqlTokens& tokens, size_t pos, const std::vector<SelectItem>& items,
+                                const Table& left, SelectPlan& plan) const;
+    // [ORDER BY ...] [LIMIT ...] [OFFSET ...] up to the end of the statement.
+    // `order_key` names the output column to sort on, nullopt when invalid.
+    static SqlCommandResults parse_order_and_limit(
+        const SqlTokens& tokens, size_t pos,
+        const std::function<std::optional<std::string>(const SelectItem&)>& order_key, SelectPlan& plan);
+    SqlCommandResults run_select(const SelectPlan& plan, const std::vector<std::string>& arguments);
+    // Cursor over the groups of an aggregate query, sorted and limited.
+    std::unique_ptr<Cursor> open_aggregate(const SelectPlan& plan, std::optional<Predicate> where) const;
+    // Hash join of the two tables of a JOIN, building on the one with fewer rows.
+    std::unique_ptr<Cursor> open_join(const SelectPlan& plan, std::optional<Predicate> left_where,
+                                      std::optional<Predicate> right_where) const;
+    // Prints the cursor's rows as a table, streaming them after the first
+    // WIDTH_SAMPLE_ROWS that set the column widths.
+    void print_rows(Cursor& cursor) const;
+    SqlCommandResults handle_update(const SqlTokens& tokens);
+    SqlCommandResults handle_delete(const SqlTokens& tokens);
+    SqlCommandResults handle_drop_table(const SqlTokens& tokens);
+    SqlCommandResults handle_create_index(const SqlTokens& tokens) const;
+    SqlCommandResults handle_drop_index(const SqlTokens& tokens) const;
+    SqlCommandResults handle_prepare(const SqlTokens& tokens);
+    SqlCommandResults handle_execute(const SqlTokens& tokens);
+    SqlCommandResults handle_deallocate(const SqlTokens& tokens);
+    SqlCommandResults prepare_statement(const std::string& name, const SqlTokens& tokens, size_t first);
+    SqlCommandResults build_plan(const std::string& text, std::shared_ptr<const StatementPlan>& out) const;
+    SqlCommandResults execute_prepared(const std::string& name, const std::vector<std::string>& arguments);
+    void update_streaming(const std::string& table_name, const std::string& column,
+                          const std::string& value, const Predicate* where, uint64_t lsn) const;
 
-    WhereClause convert_to_where_clause(const std::vector<std::string> &tokens, size_t &pos) const;
+    static std::vector<Column> parse_columns_definition(const SqlTokens& tokens, size_t position);
+    static std::optional<AggregateFunction> aggregate_function(const SqlToken& token);
+    // A column name or an aggregate call; advances `pos` past it.
+    static SelectItem parse_select_item(const SqlTokens& tokens, size_t& pos);
+    static std::string select_item_name(const SelectItem& item);
+
+    // Parses the conditions after WHERE and compiles them against `columns`.
+    Predicate convert_to_where_clause(const SqlTokens &tokens, size_t &pos,
+                                      const std::vector<Column> &columns) const;
+    static WhereClause parse_where_conditions(const SqlTokens& tokens, size_t& pos);
 
 public:
-    explicit SqlCommandHandler(std::shared_ptr<DatabasePersistence> database) : db(std::move(database)) {}
+    // One handler per session. Output goes to `output`, e.g. a client's
+    // connection instead of the console.
+    explicit SqlCommandHandler(std::shared_ptr<DatabasePersistence> database, std::ostream& output = std::cout)
+        : db(std::move(database)), out(output) {}
+    ~SqlCommandHandler();
+    SqlCommandHandler(const SqlCommandHandler&) = delete;
+    SqlCommandHandler& operator=(const SqlCommandHandler&) = delete;
     auto exec_sql_command(const std::unique_ptr<InputBuffer>& input_buffer) -> SqlCommandResults;
+    // Replays committed write-ahead log records that are missing from the
+    // table files. Returns the number of statements redone.
+    auto recover() -> size_t;
+    [[nodiscard]] auto get_last_error() const -> const std::string& { return last_error; }
+    // What went wrong with the last statement, for a result other than SUCCESS.
+    [[nodiscard]] auto error_message(SqlCommandResults result) const -> std::string;
+
+    // Prepared statements, the API form of PREPARE name AS ... / EXECUTE name (...).
+    // Placeholders are $1, $2, ...; execute() runs as one statement like exec_sql_command().
+    auto prepare(const std::string& name, const std::string& statement) -> SqlCommandResults;
+    auto execute(const std::string& name, const std::vector<std::string>& arguments) -> SqlCommandResults;
+    // Returns false when no statement has that name.
+    auto deallocate(const std::string& name) -> bool;
 }; 
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "handlers/SqlLexer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+    constexpr std::string_view KEYWORDS[] = {
+        "AND", "AS", "ASC", "AVG", "BEGIN", "BOOLEAN", "BY", "COMMIT",
+        "COPY", "COUNT", "CREATE", "DEALLOCATE", "DELETE", "DESC", "DROP", "EXECUTE",
+        "FALSE", "FROM", "GROUP", "HEADER", "INDEX", "INNER", "INSERT", "INTEGER",
+        "INTO", "JOIN", "KEY", "LIMIT", "MAX", "MIN", "NOT", "NULL",
+        "OFFSET", "ON", "OR", "ORDER", "PREPARE", "PRIMARY", "ROLLBACK", "SELECT",
+        "SET", "SUM", "TABLE", "TEXT", "TRUE", "UPDATE", "VALUES", "WHERE",
+    };
+
+    constexpr auto SHORTEST_KEYWORD = std::ranges::min(KEYWORDS, {}, &std::string_view::size).size();
+    constexpr auto LONGEST_KEYWORD = std::ranges::max(KEYWORDS, {}, &std::string_view::size).size();
+
+    auto upper(char c) -> char {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+
+    auto equals_ignore_case(std::string_view a, std::string_view b) -> bool {
+        return a.size() == b.size() && std::ranges::equal(a, b, [](char x, char y) { return upper(x) == upper(y); });
+    }
+
+    enum CharClass : uint8_t { WORD, SPACE, PUNCTUATION, QUOTE };
+
+    // One table lookup per character instead of isspace() and a switch.
+    constexpr auto CHAR_CLASSES = [] {
+        std::array<CharClass, 256> classes{};
+        for (const unsigned char c : std::string_view(" \t\n\r\f\v")) classes[c] = SPACE;
+        for (const unsigned char c : std::string_view(",();*=<>!")) classes[c] = PUNCTUATION;
+        classes[static_cast<unsigned char>('\'')] = QUOTE;
+        return classes;
+    }();
+
+    auto char_class(char c) -> CharClass {
+        return CHAR_CLASSES[static_cast<unsigned char>(c)];
+    }
+
+    auto is_digit(char c) -> bool {
+        return c >= '0' && c <= '9';
+    }
+
+    auto is_parameter(std::string_view word) -> bool {
+        return word.size() > 1 && word.front() == '$' && std::ranges::all_of(word.substr(1), is_digit);
+    }
+
+    auto is_integer(std::string_view word) -> bool {
+        if (!word.empty() && (word.front() == '-' || word.front() == '+')) {
+            word.remove_prefix(1);
+        }
+        return !word.empty() && std::ranges::all_of(word, is_digit);
+    }
+}
+
+auto SqlToken::operator==(std::string_view other) const -> bool {
+    return kind != TokenKind::STRING && equals_ignore_case(text, other);
+}
+
+auto SqlToken::name() const -> std::string {
+    std::string result(text);
+    std::ranges::transform(result, result.begin(), upper);
+    return result;
+}
+
+auto SqlToken::parameter_index() const -> std::optional<size_t> {
+    if (kind != TokenKind::PARAMETER) {
+        return std::nullopt;
+    }
+    size_t number = 0;
+    std::from_chars(text.data() + 1, text.data() + text.size(), number);
+    if (number == 0) {
+        throw std::runtime_error("Parameters are numbered from $1");
+    }
+    return number - 1;
+}
+
+auto SqlLexer::is_keyword(std::string_view word) -> bool {
+    if (word.size() < SHORTEST_KEYWORD || word.size() > LONGEST_KEYWORD) {
+        return false;
+    }
+    return std::ranges::any_of(KEYWORDS, [word](std::string_view keyword) {
+        return equals_ignore_case(keyword, word);
+    });
+}
+
+auto SqlLexer::tokenize(std::string_view statement, SqlTokens& tokens) -> void {
+    size_t pos = 0;
+    const auto size = statement.size();
+
+    while (pos < size) {
+        const auto c = statement[pos];
+        const auto type = char_class(c);
+        if (type == SPACE) {
+            pos++;
+            continue;
+        }
+
+        if (type == QUOTE) {
+            const auto end = statement.find('\'', pos + 1);
+            if (end == std::string_view::npos) {
+                throw std::runtime_error("Unterminated string literal");
+            }
+            tokens.push_back({TokenKind::STRING, statement.substr(pos + 1, end - pos - 1)});
+            pos = end + 1;
+            continue;
+        }
+
+        if (type == PUNCTUATION) {
+            // <=, >=, <> and != are one token.
+            const bool two = pos + 1 < size && statement[pos + 1] == '='
+                             && (c == '<' || c == '>' || c == '!');
+            const bool not_equal = c == '<' && pos + 1 < size && statement[pos + 1] == '>';
+            const size_t length = two || not_equal ? 2 : 1;
+            tokens.push_back({TokenKind::PUNCTUATION, statement.substr(pos, length)});
+            pos += length;
+            continue;
+        }
+
+        const auto start = pos;
+        while (pos < size && char_class(statement[pos]) == WORD) {
+            pos++;
+        }
+        const auto word = statement.substr(start, pos - start);
+        const auto kind = is_integer(word) ? TokenKind::INTEGER
+                        : is_parameter(word) ? TokenKind::PARAMETER
+                        : is_keyword(word) ? TokenKind::KEYWORD
+                        : TokenKind::IDENTIFIER;
+        tokens.push_back({kind, word});
+    }
+}
+
+auto SqlLexer::tokenize(std::string_view statement) -> SqlTokens {
+    SqlTokens tokens;
+    tokenize(statement, tokens);
+    return tokens;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class TokenKind {
+    KEYWORD,
+    IDENTIFIER,
+    INTEGER,
+    STRING,
+    PUNCTUATION,
+    PARAMETER // $1, $2, ... in a prepared statement
+};
+
+// One lexeme of a statement. `text` points into the statement the lexer was
+// given (for STRING literals, without the quotes), so tokens are only valid
+// while that statement is.
+struct SqlToken {
+    TokenKind kind;
+    std::string_view text;
+
+    // Keywords, names and punctuation compare case-insensitively; a quoted
+    // literal never equals a keyword, so 'WHERE' stays a value.
+    [[nodiscard]] auto operator==(std::string_view other) const -> bool;
+    // Table, column and index names are stored upper-cased.
+    [[nodiscard]] auto name() const -> std::string;
+    // A value exactly as written.
+    [[nodiscard]] auto value() const -> std::string { return std::string(text); }
+    // Zero-based argument position of a PARAMETER token.
+    [[nodiscard]] auto parameter_index() const -> std::optional<size_t>;
+};
+
+using SqlTokens = std::vector<SqlToken>;
+
+// Single-pass hand-written lexer. Words are runs of characters up to
+// whitespace, a quote or punctuation; a word of digits (with an optional sign)
+// is an INTEGER, $ followed by digits a PARAMETER and a reserved word a
+// KEYWORD. No token allocates.
+class SqlLexer {
+public:
+    // Throws on an unterminated string literal.
+    static auto tokenize(std::string_view statement, SqlTokens& tokens) -> void;
+    [[nodiscard]] static auto tokenize(std::string_view statement) -> SqlTokens;
+    [[nodiscard]] static auto is_keyword(std::string_view word) -> bool;
+};
@@ -15,7 +15,8 @@ enum class SqlCommandResults
 	TABLE_DOES_NOT_EXIST,
 	TABLE_ALREADY_EXISTS,
 	INCORRECT_EXPRESSION,
-	EMPTY_QUERY
+	EMPTY_QUERY,
+	EXECUTION_ERROR
 };
 
 enum class ColumnType
@@ -23,4 +24,17 @@ enum class ColumnType
 	INTEGER,
 	TEXT,
 	BOOLEAN,
-};
\ No newline at end of file
+};
+
+enum class FlushPolicy
+{
+	PER_STATEMENT,
+	PERIODIC,
+	ON_EXIT,
+};
+
+enum class ReadMode
+{
+	BUFFERED,
+	MAPPED,
+};